@@ -2,6 +2,8 @@
 #include <rai/blockstore.hpp>
 #include <rai/versioning.hpp>
 
+#include <fstream>
+
 namespace
 {
 /**
@@ -239,8 +241,295 @@ rai::store_iterator rai::block_store::vote_end ()
 	return rai::store_iterator (nullptr);
 }
 
-rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs) :
-environment (error_a, path_a, lmdb_max_dbs),
+namespace
+{
+size_t unchecked_size (rai::block const & block_a)
+{
+	size_t result (sizeof (rai::block_type));
+	switch (block_a.type ())
+	{
+		case rai::block_type::send:
+			result += rai::send_block::size;
+			break;
+		case rai::block_type::receive:
+			result += rai::receive_block::size;
+			break;
+		case rai::block_type::open:
+			result += rai::open_block::size;
+			break;
+		case rai::block_type::change:
+			result += rai::change_block::size;
+			break;
+		case rai::block_type::state:
+			result += rai::state_block::size;
+			break;
+		default:
+			assert (false);
+			break;
+	}
+	return result;
+}
+
+// Arrival times are stored as wall clock seconds since the steady clock doesn't carry across restarts
+uint64_t unchecked_arrival_seconds (std::chrono::steady_clock::time_point const & arrival_a)
+{
+	auto arrival (std::chrono::system_clock::now () - std::chrono::duration_cast<std::chrono::system_clock::duration> (std::chrono::steady_clock::now () - arrival_a));
+	return std::chrono::duration_cast<std::chrono::seconds> (arrival.time_since_epoch ()).count ();
+}
+
+std::chrono::steady_clock::time_point unchecked_arrival_time (uint64_t seconds_a)
+{
+	auto age (std::chrono::system_clock::now () - std::chrono::system_clock::time_point (std::chrono::seconds (seconds_a)));
+	return std::chrono::steady_clock::now () - std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::max (age, std::chrono::system_clock::duration (0)));
+}
+
+// Returns true if the entry was found in the cache and removed
+bool unchecked_cache_erase (std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> & cache_a, rai::unchecked_info const & info_a)
+{
+	auto result (false);
+	auto range (cache_a.equal_range (info_a.dependency));
+	for (auto i (range.first); i != range.second && !result;)
+	{
+		if (i->second->hash () == info_a.hash)
+		{
+			cache_a.erase (i);
+			result = true;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	return result;
+}
+}
+
+namespace
+{
+void bulk_write_field (std::ostream & stream_a, std::vector<uint8_t> const & field_a)
+{
+	uint32_t size (field_a.size ());
+	stream_a.write (reinterpret_cast<char const *> (&size), sizeof (size));
+	stream_a.write (reinterpret_cast<char const *> (field_a.data ()), field_a.size ());
+}
+
+// Returns true at the end of the run
+bool bulk_read_field (std::istream & stream_a, std::vector<uint8_t> & field_a)
+{
+	uint32_t size (0);
+	stream_a.read (reinterpret_cast<char *> (&size), sizeof (size));
+	if (!stream_a.fail ())
+	{
+		field_a.resize (size);
+		stream_a.read (reinterpret_cast<char *> (field_a.data ()), field_a.size ());
+	}
+	return stream_a.fail ();
+}
+}
+
+constexpr size_t rai::bulk_loader::run_max_default;
+
+rai::bulk_loader::bulk_loader (MDB_dbi database_a, bool dupsort_a, size_t run_max_a) :
+database (database_a),
+dupsort (dupsort_a),
+run_max (run_max_a),
+run_bytes (0),
+count (0),
+error (false)
+{
+}
+
+rai::bulk_loader::~bulk_loader ()
+{
+	for (auto & i : runs)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove (i, ec);
+	}
+}
+
+void rai::bulk_loader::add (MDB_val const & key_a, MDB_val const & value_a)
+{
+	auto key (reinterpret_cast<uint8_t const *> (key_a.mv_data));
+	auto value (reinterpret_cast<uint8_t const *> (value_a.mv_data));
+	run.push_back (std::make_pair (std::vector<uint8_t> (key, key + key_a.mv_size), std::vector<uint8_t> (value, value + value_a.mv_size)));
+	run_bytes += key_a.mv_size + value_a.mv_size;
+	++count;
+	if (run_bytes >= run_max)
+	{
+		spill ();
+	}
+}
+
+void rai::bulk_loader::spill ()
+{
+	// Byte wise ordering of key then value matches the default LMDB key and duplicate comparison
+	std::sort (run.begin (), run.end ());
+	auto path (boost::filesystem::temp_directory_path () / boost::filesystem::unique_path ("rai_bulk_%%%%-%%%%-%%%%-%%%%"));
+	std::ofstream stream (path.string (), std::ios::binary | std::ios::trunc);
+	for (auto & i : run)
+	{
+		bulk_write_field (stream, i.first);
+		bulk_write_field (stream, i.second);
+	}
+	stream.close ();
+	error |= stream.fail ();
+	runs.push_back (path);
+	run.clear ();
+	run_bytes = 0;
+}
+
+bool rai::bulk_loader::commit (MDB_txn * transaction_a)
+{
+	std::sort (run.begin (), run.end ());
+	using entry = std::pair<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>, size_t>;
+	auto compare ([](entry const & lhs, entry const & rhs) { return rhs.first < lhs.first; });
+	// Merge the spilled runs and the in memory run, the source index of the in memory run is runs.size ()
+	std::priority_queue<entry, std::vector<entry>, decltype (compare)> heads (compare);
+	std::vector<std::unique_ptr<std::ifstream>> files;
+	size_t position (0);
+	auto next ([this, &heads, &files, &position](size_t source_a) {
+		if (source_a < files.size ())
+		{
+			entry head;
+			head.second = source_a;
+			if (!bulk_read_field (*files[source_a], head.first.first) && !bulk_read_field (*files[source_a], head.first.second))
+			{
+				heads.push (std::move (head));
+			}
+		}
+		else if (position < run.size ())
+		{
+			heads.push (entry (std::move (run[position]), source_a));
+			++position;
+		}
+	});
+	for (auto & i : runs)
+	{
+		files.push_back (std::unique_ptr<std::ifstream> (new std::ifstream (i.string (), std::ios::binary)));
+		error |= files.back ()->fail ();
+	}
+	for (size_t i (0); i <= files.size (); ++i)
+	{
+		next (i);
+	}
+	auto result (error);
+	std::vector<uint8_t> previous;
+	auto first (true);
+	while (!result && !heads.empty ())
+	{
+		auto head (heads.top ());
+		heads.pop ();
+		auto same_key (!first && head.first.first == previous);
+		result = same_key && !dupsort;
+		if (!result)
+		{
+			auto status (mdb_put (transaction_a, database, rai::mdb_val (head.first.first.size (), head.first.first.data ()), rai::mdb_val (head.first.second.size (), head.first.second.data ()), same_key ? MDB_APPENDDUP : MDB_APPEND));
+			result = status != 0;
+			previous.swap (head.first.first);
+			first = false;
+		}
+		next (head.second);
+	}
+	run.clear ();
+	run_bytes = 0;
+	return result;
+}
+
+rai::unchecked_info::unchecked_info (rai::block_hash const & dependency_a, rai::block_hash const & hash_a, size_t size_a, std::chrono::steady_clock::time_point const & arrival_a) :
+dependency (dependency_a),
+hash (hash_a),
+size (size_a),
+arrival (arrival_a)
+{
+}
+
+rai::unchecked_key::unchecked_key (rai::block_hash const & dependency_a, rai::block_hash const & hash_a) :
+dependency (dependency_a),
+hash (hash_a)
+{
+}
+
+rai::mdb_val rai::unchecked_key::val () const
+{
+	static_assert (sizeof (dependency) + sizeof (hash) == sizeof (*this), "Packed class");
+	return rai::mdb_val (sizeof (*this), const_cast<rai::unchecked_key *> (this));
+}
+
+constexpr size_t rai::unchecked_index::max_count_default;
+constexpr std::chrono::seconds rai::unchecked_index::cutoff_default;
+
+rai::unchecked_index::unchecked_index () :
+bytes (0),
+evictions (0),
+max_count (max_count_default),
+cutoff (cutoff_default)
+{
+}
+
+bool rai::unchecked_index::insert (rai::block_hash const & dependency_a, rai::block_hash const & hash_a, size_t size_a, std::chrono::steady_clock::time_point const & arrival_a)
+{
+	auto result (!entries.get<0> ().push_back (rai::unchecked_info (dependency_a, hash_a, size_a, arrival_a)).second);
+	if (!result)
+	{
+		bytes += size_a;
+	}
+	return result;
+}
+
+void rai::unchecked_index::erase (rai::block_hash const & dependency_a, rai::block_hash const & hash_a)
+{
+	auto & index (entries.get<1> ());
+	auto existing (index.find (std::make_tuple (dependency_a, hash_a)));
+	if (existing != index.end ())
+	{
+		bytes -= existing->size;
+		index.erase (existing);
+	}
+}
+
+bool rai::unchecked_index::exists (rai::block_hash const & dependency_a, rai::block_hash const & hash_a)
+{
+	auto & index (entries.get<1> ());
+	return index.find (std::make_tuple (dependency_a, hash_a)) != index.end ();
+}
+
+std::chrono::steady_clock::time_point rai::unchecked_index::arrival (rai::block_hash const & dependency_a, rai::block_hash const & hash_a)
+{
+	auto result (std::chrono::steady_clock::now ());
+	auto & index (entries.get<1> ());
+	auto existing (index.find (std::make_tuple (dependency_a, hash_a)));
+	if (existing != index.end ())
+	{
+		result = existing->arrival;
+	}
+	return result;
+}
+
+void rai::unchecked_index::clear ()
+{
+	entries.clear ();
+	bytes = 0;
+}
+
+std::vector<rai::unchecked_info> rai::unchecked_index::evict (std::chrono::steady_clock::time_point const & now_a)
+{
+	std::vector<rai::unchecked_info> result;
+	auto & index (entries.get<0> ());
+	while (!index.empty () && (index.size () > max_count || now_a - index.front ().arrival > cutoff))
+	{
+		result.push_back (index.front ());
+		bytes -= index.front ().size;
+		index.pop_front ();
+		++evictions;
+	}
+	return result;
+}
+
+rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs, rai::lmdb_config const & lmdb_config_a, bool sorted_indexes_a) :
+sorted_indexes (sorted_indexes_a),
+environment (error_a, path_a, lmdb_max_dbs, lmdb_config_a),
+votes (error_a, boost::filesystem::path (path_a).replace_extension (".votes")),
 frontiers (0),
 accounts (0),
 send_blocks (0),
@@ -248,9 +537,14 @@ receive_blocks (0),
 open_blocks (0),
 change_blocks (0),
 pending (0),
+pending_summaries (0),
 blocks_info (0),
 representation (0),
+delegators (0),
+balances (0),
+weights (0),
 unchecked (0),
+unchecked_arrival (0),
 unsynced (0),
 checksum (0)
 {
@@ -265,9 +559,14 @@ checksum (0)
 		error_a |= mdb_dbi_open (transaction, "change", MDB_CREATE, &change_blocks) != 0;
 		error_a |= mdb_dbi_open (transaction, "state", MDB_CREATE, &state_blocks) != 0;
 		error_a |= mdb_dbi_open (transaction, "pending", MDB_CREATE, &pending) != 0;
+		error_a |= mdb_dbi_open (transaction, "pending_summaries", MDB_CREATE, &pending_summaries) != 0;
 		error_a |= mdb_dbi_open (transaction, "blocks_info", MDB_CREATE, &blocks_info) != 0;
 		error_a |= mdb_dbi_open (transaction, "representation", MDB_CREATE, &representation) != 0;
+		error_a |= mdb_dbi_open (transaction, "delegators", MDB_CREATE | MDB_DUPSORT, &delegators) != 0;
+		error_a |= mdb_dbi_open (transaction, "balances", MDB_CREATE, &balances) != 0;
+		error_a |= mdb_dbi_open (transaction, "weights", MDB_CREATE, &weights) != 0;
 		error_a |= mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &unchecked) != 0;
+		error_a |= mdb_dbi_open (transaction, "unchecked_arrival", MDB_CREATE, &unchecked_arrival) != 0;
 		error_a |= mdb_dbi_open (transaction, "unsynced", MDB_CREATE, &unsynced) != 0;
 		error_a |= mdb_dbi_open (transaction, "checksum", MDB_CREATE, &checksum) != 0;
 		error_a |= mdb_dbi_open (transaction, "vote", MDB_CREATE, &vote) != 0;
@@ -275,7 +574,10 @@ checksum (0)
 		if (!error_a)
 		{
 			do_upgrades (transaction);
+			sorted_indexes_open (transaction);
 			checksum_put (transaction, 0, 0, 0);
+			unchecked_index_load (transaction);
+			error_a |= vote_import (transaction);
 		}
 	}
 }
@@ -330,6 +632,12 @@ void rai::block_store::do_upgrades (MDB_txn * transaction_a)
 		case 9:
 			upgrade_v9_to_v10 (transaction_a);
 		case 10:
+			upgrade_v10_to_v11 (transaction_a);
+		case 11:
+			upgrade_v11_to_v12 (transaction_a);
+		case 12:
+			upgrade_v12_to_v13 (transaction_a);
+		case 13:
 			break;
 		default:
 			assert (false);
@@ -374,6 +682,7 @@ void rai::block_store::upgrade_v2_to_v3 (MDB_txn * transaction_a)
 {
 	version_put (transaction_a, 3);
 	mdb_drop (transaction_a, representation, 0);
+	std::unordered_map<rai::account, rai::uint128_t> weights;
 	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
 	{
 		rai::account account_l (i->first.uint256 ());
@@ -383,8 +692,18 @@ void rai::block_store::upgrade_v2_to_v3 (MDB_txn * transaction_a)
 		assert (!visitor.result.is_zero ());
 		info.rep_block = visitor.result;
 		mdb_cursor_put (i.cursor, rai::mdb_val (account_l), info.val (), MDB_CURRENT);
-		representation_add (transaction_a, visitor.result, info.balance.number ());
+		auto block (block_get (transaction_a, visitor.result));
+		assert (block != nullptr);
+		weights[block->representative ()] += info.balance.number ();
+	}
+	rai::bulk_loader loader (representation);
+	for (auto & i : weights)
+	{
+		rai::uint128_union weight (i.second);
+		loader.add (rai::mdb_val (i.first), rai::mdb_val (weight));
 	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 }
 
 void rai::block_store::upgrade_v3_to_v4 (MDB_txn * transaction_a)
@@ -398,11 +717,14 @@ void rai::block_store::upgrade_v3_to_v4 (MDB_txn * transaction_a)
 		items.push (std::make_pair (rai::pending_key (info.destination, hash), rai::pending_info (info.source, info.amount)));
 	}
 	mdb_drop (transaction_a, pending, 0);
+	rai::bulk_loader loader (pending);
 	while (!items.empty ())
 	{
-		pending_put (transaction_a, items.front ().first, items.front ().second);
+		loader.add (items.front ().first.val (), items.front ().second.val ());
 		items.pop ();
 	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 }
 
 void rai::block_store::upgrade_v4_to_v5 (MDB_txn * transaction_a)
@@ -448,10 +770,15 @@ void rai::block_store::upgrade_v5_to_v6 (MDB_txn * transaction_a)
 		rai::account_info info (info_old.head, info_old.rep_block, info_old.open_block, info_old.balance, info_old.modified, block_count);
 		headers.push_back (std::make_pair (account, info));
 	}
+	// Every account is rewritten so replace the table rather than updating in place
+	mdb_drop (transaction_a, accounts, 0);
+	rai::bulk_loader loader (accounts);
 	for (auto i (headers.begin ()), n (headers.end ()); i != n; ++i)
 	{
-		account_put (transaction_a, i->first, i->second);
+		loader.add (rai::mdb_val (i->first), i->second.val ());
 	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 }
 
 void rai::block_store::upgrade_v6_to_v7 (MDB_txn * transaction_a)
@@ -475,6 +802,7 @@ void rai::block_store::upgrade_v8_to_v9 (MDB_txn * transaction_a)
 	rai::genesis genesis;
 	std::shared_ptr<rai::block> block (std::move (genesis.open));
 	rai::keypair junk;
+	rai::bulk_loader loader (vote);
 	for (rai::store_iterator i (transaction_a, sequence), n (nullptr); i != n; ++i)
 	{
 		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
@@ -487,10 +815,11 @@ void rai::block_store::upgrade_v8_to_v9 (MDB_txn * transaction_a)
 			rai::vectorstream stream (vector);
 			dummy->serialize (stream);
 		}
-		auto status1 (mdb_put (transaction_a, vote, i->first, rai::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status1 == 0);
+		loader.add (i->first, rai::mdb_val (vector.size (), vector.data ()));
 		assert (!error);
 	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 	mdb_drop (transaction_a, sequence, 1);
 }
 
@@ -498,6 +827,9 @@ void rai::block_store::upgrade_v9_to_v10 (MDB_txn * transaction_a)
 {
 	//std::cerr << boost::str (boost::format ("Performing database upgrade to version 10...\n"));
 	version_put (transaction_a, 10);
+	// blocks_info is fully derived from the chains so it's rebuilt from scratch
+	mdb_drop (transaction_a, blocks_info, 0);
+	rai::bulk_loader loader (blocks_info);
 	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
 	{
 		rai::account_info info (i->second);
@@ -515,16 +847,37 @@ void rai::block_store::upgrade_v9_to_v10 (MDB_txn * transaction_a)
 					block_info.account = account;
 					rai::amount balance (block_balance (transaction_a, hash));
 					block_info.balance = balance;
-					block_info_put (transaction_a, hash, block_info);
+					loader.add (rai::mdb_val (hash), block_info.val ());
 				}
 				hash = block_successor (transaction_a, hash);
 				++block_count;
 			}
 		}
 	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 	//std::cerr << boost::str (boost::format ("Database upgrade is completed\n"));
 }
 
+void rai::block_store::upgrade_v10_to_v11 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 11);
+	delegators_rebuild (transaction_a);
+}
+
+void rai::block_store::upgrade_v11_to_v12 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 12);
+	pending_summary_rebuild (transaction_a);
+}
+
+void rai::block_store::upgrade_v12_to_v13 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 13);
+	// Arrival times were keyed by block hash only, the entries start aging again from the next load
+	mdb_drop (transaction_a, unchecked_arrival, 0);
+}
+
 void rai::block_store::clear (MDB_dbi db_a)
 {
 	rai::transaction transaction (environment, nullptr, true);
@@ -548,6 +901,158 @@ void rai::block_store::representation_add (MDB_txn * transaction_a, rai::block_h
 	representation_put (transaction_a, source_rep, source_previous + amount_a);
 }
 
+void rai::block_store::delegator_put (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_put (transaction_a, delegators, rai::mdb_val (representative_a), rai::mdb_val (account_a), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::delegator_del (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_del (transaction_a, delegators, rai::mdb_val (representative_a), rai::mdb_val (account_a)));
+	assert (status == 0);
+}
+
+rai::store_iterator rai::block_store::delegators_begin (MDB_txn * transaction_a, rai::account const & representative_a)
+{
+	rai::store_iterator result (transaction_a, delegators, rai::mdb_val (representative_a));
+	if (result != rai::store_iterator (nullptr) && rai::account (result->first.uint256 ()) != representative_a)
+	{
+		result = rai::store_iterator (nullptr);
+	}
+	return result;
+}
+
+rai::store_iterator rai::block_store::delegators_end ()
+{
+	rai::store_iterator result (nullptr);
+	return result;
+}
+
+uint64_t rai::block_store::delegators_count (MDB_txn * transaction_a, rai::account const & representative_a)
+{
+	uint64_t result (0);
+	auto i (delegators_begin (transaction_a, representative_a));
+	if (i != delegators_end ())
+	{
+		size_t count;
+		auto status (mdb_cursor_count (i.cursor, &count));
+		assert (status == 0);
+		result = count;
+	}
+	return result;
+}
+
+void rai::block_store::delegators_rebuild (MDB_txn * transaction_a)
+{
+	auto status (mdb_drop (transaction_a, delegators, 0));
+	assert (status == 0);
+	rai::bulk_loader loader (delegators, true);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		auto block (block_get (transaction_a, info.rep_block));
+		assert (block != nullptr);
+		loader.add (rai::mdb_val (block->representative ()), i->first);
+	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
+}
+
+void rai::block_store::balance_index_put (MDB_txn * transaction_a, rai::account const & account_a, rai::amount const & balance_a)
+{
+	if (sorted_indexes)
+	{
+		auto status (mdb_put (transaction_a, balances, rai::amount_key (balance_a, account_a).val (), rai::mdb_val (0, nullptr), 0));
+		assert (status == 0);
+	}
+}
+
+void rai::block_store::balance_index_del (MDB_txn * transaction_a, rai::account const & account_a, rai::amount const & balance_a)
+{
+	if (sorted_indexes)
+	{
+		auto status (mdb_del (transaction_a, balances, rai::amount_key (balance_a, account_a).val (), nullptr));
+		assert (status == 0);
+	}
+}
+
+rai::store_iterator rai::block_store::balances_begin (MDB_txn * transaction_a)
+{
+	rai::store_iterator result (transaction_a, balances);
+	return result;
+}
+
+rai::store_iterator rai::block_store::balances_end ()
+{
+	rai::store_iterator result (nullptr);
+	return result;
+}
+
+rai::store_iterator rai::block_store::weights_begin (MDB_txn * transaction_a)
+{
+	rai::store_iterator result (transaction_a, weights);
+	return result;
+}
+
+rai::store_iterator rai::block_store::weights_end ()
+{
+	rai::store_iterator result (nullptr);
+	return result;
+}
+
+void rai::block_store::sorted_indexes_open (MDB_txn * transaction_a)
+{
+	rai::uint256_union sorted_key (2);
+	rai::mdb_val value;
+	auto status (mdb_get (transaction_a, meta, rai::mdb_val (sorted_key), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	auto built (status == 0);
+	if (sorted_indexes && !built)
+	{
+		sorted_indexes_rebuild (transaction_a);
+		auto status2 (mdb_put (transaction_a, meta, rai::mdb_val (sorted_key), rai::mdb_val (rai::uint256_union (1)), 0));
+		assert (status2 == 0);
+	}
+	else if (!sorted_indexes && built)
+	{
+		// Writes made while disabled aren't indexed so the tables are dropped and rebuilt when enabled again
+		auto status2 (mdb_drop (transaction_a, balances, 0));
+		assert (status2 == 0);
+		auto status3 (mdb_drop (transaction_a, weights, 0));
+		assert (status3 == 0);
+		auto status4 (mdb_del (transaction_a, meta, rai::mdb_val (sorted_key), nullptr));
+		assert (status4 == 0);
+	}
+}
+
+void rai::block_store::sorted_indexes_rebuild (MDB_txn * transaction_a)
+{
+	auto status (mdb_drop (transaction_a, balances, 0));
+	assert (status == 0);
+	auto status2 (mdb_drop (transaction_a, weights, 0));
+	assert (status2 == 0);
+	rai::bulk_loader balances_loader (balances);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		balances_loader.add (rai::amount_key (info.balance, i->first.uint256 ()).val (), rai::mdb_val (0, nullptr));
+	}
+	auto error1 (balances_loader.commit (transaction_a));
+	assert (!error1);
+	rai::bulk_loader weights_loader (weights);
+	for (auto i (representation_begin (transaction_a)), n (representation_end ()); i != n; ++i)
+	{
+		rai::uint128_union weight;
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto error (rai::read (stream, weight));
+		assert (!error);
+		weights_loader.add (rai::amount_key (weight, i->first.uint256 ()).val (), rai::mdb_val (0, nullptr));
+	}
+	auto error2 (weights_loader.commit (transaction_a));
+	assert (!error2);
+}
+
 MDB_dbi rai::block_store::block_database (rai::block_type type_a)
 {
 	MDB_dbi result;
@@ -899,14 +1404,84 @@ void rai::block_store::account_put (MDB_txn * transaction_a, rai::account const
 
 void rai::block_store::pending_put (MDB_txn * transaction_a, rai::pending_key const & key_a, rai::pending_info const & pending_a)
 {
+	auto summary (pending_summary_get (transaction_a, key_a.account));
+	rai::pending_info existing;
+	if (!pending_get (transaction_a, key_a, existing))
+	{
+		summary.amount = summary.amount.number () - existing.amount.number ();
+		--summary.count;
+	}
+	summary.amount = summary.amount.number () + pending_a.amount.number ();
+	++summary.count;
 	auto status (mdb_put (transaction_a, pending, key_a.val (), pending_a.val (), 0));
 	assert (status == 0);
+	auto status2 (mdb_put (transaction_a, pending_summaries, rai::mdb_val (key_a.account), summary.val (), 0));
+	assert (status2 == 0);
 }
 
 void rai::block_store::pending_del (MDB_txn * transaction_a, rai::pending_key const & key_a)
 {
+	rai::pending_info existing;
+	auto error (pending_get (transaction_a, key_a, existing));
+	assert (!error);
+	auto summary (pending_summary_get (transaction_a, key_a.account));
+	assert (summary.count > 0);
+	summary.amount = summary.amount.number () - existing.amount.number ();
+	--summary.count;
 	auto status (mdb_del (transaction_a, pending, key_a.val (), nullptr));
 	assert (status == 0);
+	if (summary.count > 0)
+	{
+		auto status2 (mdb_put (transaction_a, pending_summaries, rai::mdb_val (key_a.account), summary.val (), 0));
+		assert (status2 == 0);
+	}
+	else
+	{
+		auto status2 (mdb_del (transaction_a, pending_summaries, rai::mdb_val (key_a.account), nullptr));
+		assert (status2 == 0);
+	}
+}
+
+rai::pending_summary rai::block_store::pending_summary_get (MDB_txn * transaction_a, rai::account const & account_a)
+{
+	rai::pending_summary result;
+	rai::mdb_val value;
+	auto status (mdb_get (transaction_a, pending_summaries, rai::mdb_val (account_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == 0)
+	{
+		result = rai::pending_summary (value);
+	}
+	return result;
+}
+
+void rai::block_store::pending_summary_rebuild (MDB_txn * transaction_a)
+{
+	auto status (mdb_drop (transaction_a, pending_summaries, 0));
+	assert (status == 0);
+	// Pending keys are ordered by destination account so each summary is complete once the account changes
+	rai::bulk_loader loader (pending_summaries);
+	rai::account current (0);
+	rai::pending_summary summary;
+	for (auto i (pending_begin (transaction_a)), n (pending_end ()); i != n; ++i)
+	{
+		rai::pending_key key (i->first);
+		rai::pending_info info (i->second);
+		if (key.account != current && summary.count > 0)
+		{
+			loader.add (rai::mdb_val (current), summary.val ());
+			summary = rai::pending_summary ();
+		}
+		current = key.account;
+		summary.amount = summary.amount.number () + info.amount.number ();
+		++summary.count;
+	}
+	if (summary.count > 0)
+	{
+		loader.add (rai::mdb_val (current), summary.val ());
+	}
+	auto error (loader.commit (transaction_a));
+	assert (!error);
 }
 
 bool rai::block_store::pending_exists (MDB_txn * transaction_a, rai::pending_key const & key_a)
@@ -1021,6 +1596,23 @@ rai::uint128_t rai::block_store::representation_get (MDB_txn * transaction_a, ra
 void rai::block_store::representation_put (MDB_txn * transaction_a, rai::account const & account_a, rai::uint128_t const & representation_a)
 {
 	rai::uint128_union rep (representation_a);
+	if (sorted_indexes)
+	{
+		rai::mdb_val previous;
+		auto status (mdb_get (transaction_a, representation, rai::mdb_val (account_a), previous));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		if (status == 0)
+		{
+			rai::uint128_union weight;
+			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (previous.data ()), previous.size ());
+			auto error (rai::read (stream, weight));
+			assert (!error);
+			auto status2 (mdb_del (transaction_a, weights, rai::amount_key (weight, account_a).val (), nullptr));
+			assert (status2 == 0);
+		}
+		auto status3 (mdb_put (transaction_a, weights, rai::amount_key (rep, account_a).val (), rai::mdb_val (0, nullptr), 0));
+		assert (status3 == 0);
+	}
 	auto status (mdb_put (transaction_a, representation, rai::mdb_val (account_a), rai::mdb_val (rep), 0));
 	assert (status == 0);
 }
@@ -1029,41 +1621,30 @@ void rai::block_store::unchecked_clear (MDB_txn * transaction_a)
 {
 	auto status (mdb_drop (transaction_a, unchecked, 0));
 	assert (status == 0);
+	auto status2 (mdb_drop (transaction_a, unchecked_arrival, 0));
+	assert (status2 == 0);
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	unchecked_cache.clear ();
+	unchecked_index.clear ();
+	unchecked_evicted.clear ();
 }
 
 void rai::block_store::unchecked_put (MDB_txn * transaction_a, rai::block_hash const & hash_a, std::shared_ptr<rai::block> const & block_a)
 {
-	// Checking if same unchecked block is already in database
-	bool exists (false);
-	auto block_hash (block_a->hash ());
-	auto cached (unchecked_get (transaction_a, hash_a));
-	for (auto i (cached.begin ()), n (cached.end ()); i != n && !exists; ++i)
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	// The index covers the cache and the table so duplicates are rejected without deserializing existing entries
+	if (!unchecked_index.insert (hash_a, block_a->hash (), unchecked_size (*block_a)))
 	{
-		if ((*i)->hash () == block_hash)
+		unchecked_cache.insert (std::make_pair (hash_a, block_a));
+		// Evicted entries still in the cache are dropped now, flushed ones are deleted on the next flush
+		for (auto & i : unchecked_index.evict (std::chrono::steady_clock::now ()))
 		{
-			exists = true;
+			if (!unchecked_cache_erase (unchecked_cache, i))
+			{
+				unchecked_evicted.push_back (i);
+			}
 		}
 	}
-	// Inserting block if it wasn't found in database
-	if (!exists)
-	{
-		std::lock_guard<std::mutex> lock (cache_mutex);
-		unchecked_cache.insert (std::make_pair (hash_a, block_a));
-	}
-}
-
-std::shared_ptr<rai::vote> rai::block_store::vote_get (MDB_txn * transaction_a, rai::account const & account_a)
-{
-	std::shared_ptr<rai::vote> result;
-	rai::mdb_val value;
-	auto status (mdb_get (transaction_a, vote, rai::mdb_val (account_a), value));
-	assert (status == 0 || status == MDB_NOTFOUND);
-	if (status == 0)
-	{
-		result = std::make_shared<rai::vote> (value);
-		assert (result != nullptr);
-	}
-	return result;
 }
 
 std::vector<std::shared_ptr<rai::block>> rai::block_store::unchecked_get (MDB_txn * transaction_a, rai::block_hash const & hash_a)
@@ -1088,6 +1669,7 @@ void rai::block_store::unchecked_del (MDB_txn * transaction_a, rai::block_hash c
 {
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
+		unchecked_index.erase (hash_a, block_a.hash ());
 		for (auto i (unchecked_cache.find (hash_a)), n (unchecked_cache.end ()); i != n && i->first == hash_a;)
 		{
 			if (*i->second == block_a)
@@ -1107,6 +1689,8 @@ void rai::block_store::unchecked_del (MDB_txn * transaction_a, rai::block_hash c
 	}
 	auto status (mdb_del (transaction_a, unchecked, rai::mdb_val (hash_a), rai::mdb_val (vector.size (), vector.data ())));
 	assert (status == 0 || status == MDB_NOTFOUND);
+	auto status2 (mdb_del (transaction_a, unchecked_arrival, rai::unchecked_key (hash_a, block_a.hash ()).val (), nullptr));
+	assert (status2 == 0 || status2 == MDB_NOTFOUND);
 }
 
 size_t rai::block_store::unchecked_count (MDB_txn * transaction_a)
@@ -1118,6 +1702,82 @@ size_t rai::block_store::unchecked_count (MDB_txn * transaction_a)
 	return result;
 }
 
+void rai::block_store::unchecked_evict (MDB_txn * transaction_a)
+{
+	// Held while deleting so an entry put again after it was evicted isn't deleted from under the index
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	for (auto & i : unchecked_index.evict (std::chrono::steady_clock::now ()))
+	{
+		if (!unchecked_cache_erase (unchecked_cache, i))
+		{
+			unchecked_evicted.push_back (i);
+		}
+	}
+	for (auto & i : unchecked_evicted)
+	{
+		// Skipped if it was put again since, the next flush rewrites it
+		if (!unchecked_index.exists (i.dependency, i.hash))
+		{
+			for (auto j (unchecked_begin (transaction_a, i.dependency)), n (unchecked_end ()); j != n && rai::block_hash (j->first.uint256 ()) == i.dependency; j.next_dup ())
+			{
+				rai::bufferstream stream (reinterpret_cast<uint8_t const *> (j->second.data ()), j->second.size ());
+				auto block (rai::deserialize_block (stream));
+				if (block->hash () == i.hash)
+				{
+					auto status (mdb_cursor_del (j.cursor, 0));
+					assert (status == 0);
+					break;
+				}
+			}
+			auto status (mdb_del (transaction_a, unchecked_arrival, rai::unchecked_key (i.dependency, i.hash).val (), nullptr));
+			assert (status == 0 || status == MDB_NOTFOUND);
+		}
+	}
+	unchecked_evicted.clear ();
+}
+
+void rai::block_store::unchecked_index_load (MDB_txn * transaction_a)
+{
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	unchecked_index.clear ();
+	auto now (std::chrono::steady_clock::now ());
+	std::vector<rai::unchecked_info> loaded;
+	for (auto i (unchecked_begin (transaction_a)), n (unchecked_end ()); i != n; ++i)
+	{
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto block (rai::deserialize_block (stream));
+		assert (block != nullptr);
+		auto hash (block->hash ());
+		rai::block_hash dependency (i->first.uint256 ());
+		// Entries written before arrival times were kept start aging now
+		auto arrival (now);
+		rai::mdb_val value;
+		if (mdb_get (transaction_a, unchecked_arrival, rai::unchecked_key (dependency, hash).val (), value) == 0)
+		{
+			uint64_t seconds;
+			rai::bufferstream arrival_stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+			if (!rai::read (arrival_stream, seconds))
+			{
+				arrival = unchecked_arrival_time (seconds);
+			}
+		}
+		loaded.push_back (rai::unchecked_info (dependency, hash, i->second.size (), arrival));
+	}
+	// Eviction takes entries from the front so they're indexed oldest first
+	std::stable_sort (loaded.begin (), loaded.end (), [](rai::unchecked_info const & lhs, rai::unchecked_info const & rhs) {
+		return lhs.arrival < rhs.arrival;
+	});
+	for (auto & i : loaded)
+	{
+		unchecked_index.insert (i.dependency, i.hash, i.size, i.arrival);
+	}
+	// Entries that aged out while the node was down are deleted on the next flush
+	for (auto & i : unchecked_index.evict (now))
+	{
+		unchecked_evicted.push_back (i);
+	}
+}
+
 void rai::block_store::unsynced_put (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
 	auto status (mdb_put (transaction_a, unsynced, rai::mdb_val (hash_a), rai::mdb_val (0, nullptr), 0));
@@ -1191,13 +1851,17 @@ void rai::block_store::checksum_del (MDB_txn * transaction_a, uint64_t prefix, u
 
 void rai::block_store::flush (MDB_txn * transaction_a)
 {
-	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> sequence_cache_l;
 	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache_l;
+	std::vector<uint64_t> arrivals;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		sequence_cache_l.swap (vote_cache);
 		unchecked_cache_l.swap (unchecked_cache);
+		for (auto & i : unchecked_cache_l)
+		{
+			arrivals.push_back (unchecked_arrival_seconds (unchecked_index.arrival (i.first, i.second->hash ())));
+		}
 	}
+	auto arrival (arrivals.begin ());
 	for (auto & i : unchecked_cache_l)
 	{
 		std::vector<uint8_t> vector;
@@ -1207,57 +1871,36 @@ void rai::block_store::flush (MDB_txn * transaction_a)
 		}
 		auto status (mdb_put (transaction_a, unchecked, rai::mdb_val (i.first), rai::mdb_val (vector.size (), vector.data ()), 0));
 		assert (status == 0);
-	}
-	for (auto i (sequence_cache_l.begin ()), n (sequence_cache_l.end ()); i != n; ++i)
-	{
-		std::vector<uint8_t> vector;
+		std::vector<uint8_t> seconds;
 		{
-			rai::vectorstream stream (vector);
-			i->second->serialize (stream);
+			rai::vectorstream stream (seconds);
+			rai::write (stream, *arrival);
 		}
-		auto status1 (mdb_put (transaction_a, vote, rai::mdb_val (i->first), rai::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status1 == 0);
+		auto status2 (mdb_put (transaction_a, unchecked_arrival, rai::unchecked_key (i.first, i.second->hash ()).val (), rai::mdb_val (seconds.size (), seconds.data ()), 0));
+		assert (status2 == 0);
+		++arrival;
 	}
+	unchecked_evict (transaction_a);
 }
-std::shared_ptr<rai::vote> rai::block_store::vote_current (MDB_txn * transaction_a, rai::account const & account_a)
+bool rai::block_store::vote_import (MDB_txn * transaction_a)
 {
-	assert (!cache_mutex.try_lock ());
-	std::shared_ptr<rai::vote> result;
-	auto existing (vote_cache.find (account_a));
-	if (existing != vote_cache.end ())
+	auto result (false);
+	auto imported (false);
+	for (auto i (vote_begin (transaction_a)), n (vote_end ()); i != n; ++i)
 	{
-		result = existing->second;
+		votes.import (std::make_shared<rai::vote> (i->second));
+		imported = true;
 	}
-	else
-	{
-		result = vote_get (transaction_a, account_a);
-	}
-	return result;
-}
-
-std::shared_ptr<rai::vote> rai::block_store::vote_generate (MDB_txn * transaction_a, rai::account const & account_a, rai::raw_key const & key_a, std::shared_ptr<rai::block> block_a)
-{
-	std::lock_guard<std::mutex> lock (cache_mutex);
-	auto result (vote_current (transaction_a, account_a));
-	uint64_t sequence ((result ? result->sequence : 0) + 1);
-	result = std::make_shared<rai::vote> (account_a, key_a, sequence, block_a);
-	vote_cache[account_a] = result;
-	return result;
-}
-
-std::shared_ptr<rai::vote> rai::block_store::vote_max (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a)
-{
-	std::lock_guard<std::mutex> lock (cache_mutex);
-	auto current (vote_current (transaction_a, vote_a->account));
-	auto result (vote_a);
-	if (current != nullptr)
+	if (imported)
 	{
-		if (current->sequence > result->sequence)
+		// The table is only cleared once its votes are safely in the log
+		result = votes.flush ();
+		if (!result)
 		{
-			result = current;
+			auto status (mdb_drop (transaction_a, vote, 0));
+			assert (status == 0);
 		}
 	}
-	vote_cache[vote_a->account] = result;
 	return result;
 }
 
@@ -1,6 +1,15 @@
 #pragma once
 
 #include <rai/common.hpp>
+#include <rai/votestore.hpp>
+
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+
+#include <chrono>
 
 namespace rai
 {
@@ -40,13 +49,91 @@ public:
 	rai::store_entry current;
 };
 
+// Key of unchecked_arrival, every dependent of the same missing block keeps its own arrival time
+class unchecked_key
+{
+public:
+	unchecked_key (rai::block_hash const &, rai::block_hash const &);
+	rai::mdb_val val () const;
+	rai::block_hash dependency;
+	rai::block_hash hash;
+};
+
+class unchecked_info
+{
+public:
+	unchecked_info (rai::block_hash const &, rai::block_hash const &, size_t, std::chrono::steady_clock::time_point const &);
+	rai::block_hash dependency;
+	rai::block_hash hash;
+	size_t size;
+	std::chrono::steady_clock::time_point arrival;
+};
+
+/**
+ * In memory index of every unchecked entry, both cached and stored
+ * Answers duplicate checks without reading the table and picks the oldest entries for eviction once the count or age limits are passed
+ */
+class unchecked_index
+{
+public:
+	unchecked_index ();
+	// Returns true if the entry was already indexed
+	bool insert (rai::block_hash const &, rai::block_hash const &, size_t, std::chrono::steady_clock::time_point const & = std::chrono::steady_clock::now ());
+	void erase (rai::block_hash const &, rai::block_hash const &);
+	bool exists (rai::block_hash const &, rai::block_hash const &);
+	// When the entry arrived, now if it isn't indexed
+	std::chrono::steady_clock::time_point arrival (rai::block_hash const &, rai::block_hash const &);
+	void clear ();
+	// Removes and returns entries over the limits, oldest first
+	std::vector<rai::unchecked_info> evict (std::chrono::steady_clock::time_point const &);
+	boost::multi_index_container<
+	rai::unchecked_info,
+	boost::multi_index::indexed_by<
+	boost::multi_index::sequenced<>,
+	boost::multi_index::hashed_unique<boost::multi_index::composite_key<
+	rai::unchecked_info,
+	boost::multi_index::member<rai::unchecked_info, rai::block_hash, &rai::unchecked_info::dependency>,
+	boost::multi_index::member<rai::unchecked_info, rai::block_hash, &rai::unchecked_info::hash>>>>>
+	entries;
+	size_t bytes;
+	uint64_t evictions;
+	size_t max_count;
+	std::chrono::seconds cutoff;
+	static size_t constexpr max_count_default = 1024 * 1024;
+	static std::chrono::seconds constexpr cutoff_default = std::chrono::hours (24);
+};
+
+/**
+ * Writes large numbers of entries to a table with MDB_APPEND instead of random puts
+ * Entries are sorted in memory, runs over the memory limit are spilled to temporary files and merged in key order on commit
+ */
+class bulk_loader
+{
+public:
+	bulk_loader (MDB_dbi, bool = false, size_t = run_max_default);
+	~bulk_loader ();
+	void add (MDB_val const &, MDB_val const &);
+	// Returns true on error, every key must sort after the last key already in the table and be unique unless the table is dupsort
+	bool commit (MDB_txn *);
+	void spill ();
+	MDB_dbi database;
+	bool dupsort;
+	size_t run_max;
+	size_t run_bytes;
+	uint64_t count;
+	bool error;
+	std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> run;
+	std::vector<boost::filesystem::path> runs;
+	static size_t constexpr run_max_default = 256 * 1024 * 1024;
+};
+
 /**
  * Manages block storage and iteration
  */
 class block_store
 {
 public:
-	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128);
+	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128, rai::lmdb_config const & = rai::lmdb_config (), bool sorted_indexes = false);
 
 	MDB_dbi block_database (rai::block_type);
 	void block_put_raw (MDB_txn *, MDB_dbi, rai::block_hash const &, MDB_val);
@@ -81,6 +168,9 @@ public:
 	rai::store_iterator pending_begin (MDB_txn *, rai::pending_key const &);
 	rai::store_iterator pending_begin (MDB_txn *);
 	rai::store_iterator pending_end ();
+	// Total and count of an account's pending entries, kept up to date by pending_put and pending_del
+	rai::pending_summary pending_summary_get (MDB_txn *, rai::account const &);
+	void pending_summary_rebuild (MDB_txn *);
 
 	void block_info_put (MDB_txn *, rai::block_hash const &, rai::block_info const &);
 	void block_info_del (MDB_txn *, rai::block_hash const &);
@@ -98,6 +188,29 @@ public:
 	rai::store_iterator representation_begin (MDB_txn *);
 	rai::store_iterator representation_end ();
 
+	void delegator_put (MDB_txn *, rai::account const &, rai::account const &);
+	void delegator_del (MDB_txn *, rai::account const &, rai::account const &);
+	// Iterates the accounts delegating to a representative, advance with next_dup
+	rai::store_iterator delegators_begin (MDB_txn *, rai::account const &);
+	rai::store_iterator delegators_end ();
+	uint64_t delegators_count (MDB_txn *, rai::account const &);
+	// Replaces the delegators table with one derived from every account's representative
+	void delegators_rebuild (MDB_txn *);
+
+	// Balance and weight indexes are only maintained when sorted_indexes is set, these are no-ops otherwise
+	void balance_index_put (MDB_txn *, rai::account const &, rai::amount const &);
+	void balance_index_del (MDB_txn *, rai::account const &, rai::amount const &);
+	// Iterates accounts by descending balance, keys are amount_key
+	rai::store_iterator balances_begin (MDB_txn *);
+	rai::store_iterator balances_end ();
+	// Iterates representatives by descending weight, keys are amount_key
+	rai::store_iterator weights_begin (MDB_txn *);
+	rai::store_iterator weights_end ();
+	// Builds the sorted indexes if they were enabled since the last open or drops them if they were disabled
+	void sorted_indexes_open (MDB_txn *);
+	void sorted_indexes_rebuild (MDB_txn *);
+	bool sorted_indexes;
+
 	void unchecked_clear (MDB_txn *);
 	void unchecked_put (MDB_txn *, rai::block_hash const &, std::shared_ptr<rai::block> const &);
 	std::vector<std::shared_ptr<rai::block>> unchecked_get (MDB_txn *, rai::block_hash const &);
@@ -106,7 +219,14 @@ public:
 	rai::store_iterator unchecked_begin (MDB_txn *, rai::block_hash const &);
 	rai::store_iterator unchecked_end ();
 	size_t unchecked_count (MDB_txn *);
+	// Deletes entries the index has evicted
+	void unchecked_evict (MDB_txn *);
+	void unchecked_index_load (MDB_txn *);
 	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache;
+	// Guarded by cache_mutex
+	rai::unchecked_index unchecked_index;
+	// Evicted entries that were already flushed and still need to be deleted from the table
+	std::vector<rai::unchecked_info> unchecked_evicted;
 
 	void unsynced_put (MDB_txn *, rai::block_hash const &);
 	void unsynced_del (MDB_txn *, rai::block_hash const &);
@@ -119,19 +239,13 @@ public:
 	bool checksum_get (MDB_txn *, uint64_t, uint8_t, rai::checksum &);
 	void checksum_del (MDB_txn *, uint64_t, uint8_t);
 
-	// Return latest vote for an account from store
-	std::shared_ptr<rai::vote> vote_get (MDB_txn *, rai::account const &);
-	// Populate vote with the next sequence number
-	std::shared_ptr<rai::vote> vote_generate (MDB_txn *, rai::account const &, rai::raw_key const &, std::shared_ptr<rai::block>);
-	// Return either vote or the stored vote with a higher sequence number
-	std::shared_ptr<rai::vote> vote_max (MDB_txn *, std::shared_ptr<rai::vote>);
-	// Return latest vote for an account considering the vote cache
-	std::shared_ptr<rai::vote> vote_current (MDB_txn *, rai::account const &);
 	void flush (MDB_txn *);
+	// Votes left in the vote table by older versions
 	rai::store_iterator vote_begin (MDB_txn *);
 	rai::store_iterator vote_end ();
+	// Moves the vote table into the vote store, returns true on error
+	bool vote_import (MDB_txn *);
 	std::mutex cache_mutex;
-	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> vote_cache;
 
 	void version_put (MDB_txn *, int);
 	int version_get (MDB_txn *);
@@ -145,10 +259,15 @@ public:
 	void upgrade_v7_to_v8 (MDB_txn *);
 	void upgrade_v8_to_v9 (MDB_txn *);
 	void upgrade_v9_to_v10 (MDB_txn *);
+	void upgrade_v10_to_v11 (MDB_txn *);
+	void upgrade_v11_to_v12 (MDB_txn *);
+	void upgrade_v12_to_v13 (MDB_txn *);
 
 	void clear (MDB_dbi);
 
 	rai::mdb_env environment;
+	// Latest vote per account, kept outside of the ledger in its own log
+	rai::vote_store votes;
 	// block_hash -> account                                        // Maps head blocks to owning account
 	MDB_dbi frontiers;
 	// account -> block_hash, representative, balance, timestamp    // Account to head block, representative, balance, last_change
@@ -165,17 +284,27 @@ public:
 	MDB_dbi state_blocks;
 	// block_hash -> sender, amount, destination                    // Pending blocks to sender account, amount, destination account
 	MDB_dbi pending;
+	// account -> amount, count                                     // Sum and number of pending entries per destination account
+	MDB_dbi pending_summaries;
 	// block_hash -> account, balance                               // Blocks info
 	MDB_dbi blocks_info;
 	// account -> weight                                            // Representation
 	MDB_dbi representation;
+	// account -> account                                           // Representative to each account delegating to it, dupsort
+	MDB_dbi delegators;
+	// (~balance, account) ->                                       // Accounts ordered by descending balance, optional
+	MDB_dbi balances;
+	// (~weight, account) ->                                        // Representatives ordered by descending weight, optional
+	MDB_dbi weights;
 	// block_hash -> block                                          // Unchecked bootstrap blocks
 	MDB_dbi unchecked;
+	// (block_hash, block_hash) -> uint64_t                         // Seconds since epoch an unchecked block arrived, keyed by dependency and block, kept so the age cutoff spans restarts
+	MDB_dbi unchecked_arrival;
 	// block_hash ->                                                // Blocks that haven't been broadcast
 	MDB_dbi unsynced;
 	// (uint56_t, uint8_t) -> block_hash                            // Mapping of region to checksum
 	MDB_dbi checksum;
-	// account -> uint64_t											// Highest vote observed for account
+	// account -> uint64_t											// Highest vote observed for account, only read when importing into the vote store
 	MDB_dbi vote;
 	// uint256_union -> ?											// Meta information about block store
 	MDB_dbi meta;
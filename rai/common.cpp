@@ -113,23 +113,23 @@ id (block_a->root ())
 	rep_votes.insert (std::make_pair (rai::not_an_account, block_a));
 }
 
-rai::tally_result rai::votes::vote (std::shared_ptr<rai::vote> vote_a)
+rai::tally_result rai::votes::vote (rai::account const & account_a, std::shared_ptr<rai::block> block_a)
 {
 	rai::tally_result result;
-	auto existing (rep_votes.find (vote_a->account));
+	auto existing (rep_votes.find (account_a));
 	if (existing == rep_votes.end ())
 	{
 		// Vote on this block hasn't been seen from rep before
 		result = rai::tally_result::vote;
-		rep_votes.insert (std::make_pair (vote_a->account, vote_a->block));
+		rep_votes.insert (std::make_pair (account_a, block_a));
 	}
 	else
 	{
-		if (!(*existing->second == *vote_a->block))
+		if (!(*existing->second == *block_a))
 		{
 			// Rep changed their vote
 			result = rai::tally_result::changed;
-			existing->second = vote_a->block;
+			existing->second = block_a;
 		}
 		else
 		{
@@ -343,6 +343,47 @@ rai::mdb_val rai::pending_key::val () const
 	return rai::mdb_val (sizeof (*this), const_cast<rai::pending_key *> (this));
 }
 
+rai::pending_summary::pending_summary () :
+amount (0),
+count (0)
+{
+}
+
+rai::pending_summary::pending_summary (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (amount) + sizeof (count) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+rai::mdb_val rai::pending_summary::val () const
+{
+	return rai::mdb_val (sizeof (*this), const_cast<rai::pending_summary *> (this));
+}
+
+rai::amount_key::amount_key (rai::amount const & amount_a, rai::account const & account_a) :
+complement (~amount_a.number ()),
+account (account_a)
+{
+}
+
+rai::amount_key::amount_key (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (complement) + sizeof (account) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+rai::amount rai::amount_key::amount () const
+{
+	return ~complement.number ();
+}
+
+rai::mdb_val rai::amount_key::val () const
+{
+	return rai::mdb_val (sizeof (*this), const_cast<rai::amount_key *> (this));
+}
+
 rai::block_info::block_info () :
 account (0),
 balance (0)
@@ -388,9 +429,13 @@ rai::mdb_val rai::block_info::val () const
 	return rai::mdb_val (sizeof (*this), const_cast<rai::block_info *> (this));
 }
 
+size_t constexpr rai::vote::max_hashes;
+std::string const rai::vote::hash_prefix = "vote ";
+
 bool rai::vote::operator== (rai::vote const & other_a) const
 {
-	return sequence == other_a.sequence && *block == *other_a.block && account == other_a.account && signature == other_a.signature;
+	auto blocks_equal (block == nullptr ? other_a.block == nullptr : other_a.block != nullptr && *block == *other_a.block);
+	return sequence == other_a.sequence && blocks_equal && hashes == other_a.hashes && account == other_a.account && signature == other_a.signature;
 }
 
 bool rai::vote::operator!= (rai::vote const & other_a) const
@@ -405,11 +450,67 @@ std::string rai::vote::to_json () const
 	tree.put ("account", account.to_account ());
 	tree.put ("signature", signature.number ());
 	tree.put ("sequence", std::to_string (sequence));
-	tree.put ("block", block->to_json ());
+	if (block != nullptr)
+	{
+		tree.put ("block", block->to_json ());
+	}
+	else
+	{
+		boost::property_tree::ptree hashes_l;
+		for (auto & i : hashes)
+		{
+			boost::property_tree::ptree entry;
+			entry.put ("", i.to_string ());
+			hashes_l.push_back (std::make_pair ("", entry));
+		}
+		tree.add_child ("hashes", hashes_l);
+	}
 	boost::property_tree::write_json (stream, tree);
 	return stream.str ();
 }
 
+std::vector<rai::block_hash> rai::vote::block_hashes () const
+{
+	std::vector<rai::block_hash> result;
+	if (block != nullptr)
+	{
+		result.push_back (block->hash ());
+	}
+	else
+	{
+		result = hashes;
+	}
+	return result;
+}
+
+std::string rai::vote::hashes_string () const
+{
+	std::string result;
+	for (auto & i : block_hashes ())
+	{
+		if (!result.empty ())
+		{
+			result += ", ";
+		}
+		result += i.to_string ();
+	}
+	return result;
+}
+
+bool rai::vote::deserialize_hashes (rai::stream & stream_a)
+{
+	uint8_t count;
+	auto result (rai::read (stream_a, count));
+	result = result || count == 0 || count > max_hashes;
+	for (auto i (0); !result && i < count; ++i)
+	{
+		rai::block_hash hash;
+		result = rai::read (stream_a, hash);
+		hashes.push_back (hash);
+	}
+	return result;
+}
+
 rai::amount_visitor::amount_visitor (MDB_txn * transaction_a, rai::block_store & store_a) :
 transaction (transaction_a),
 store (store_a)
@@ -597,6 +698,7 @@ void rai::representative_visitor::state_block (rai::state_block const & block_a)
 rai::vote::vote (rai::vote const & other_a) :
 sequence (other_a.sequence),
 block (other_a.block),
+hashes (other_a.hashes),
 account (other_a.account),
 signature (other_a.signature)
 {
@@ -615,8 +717,20 @@ rai::vote::vote (bool & error_a, rai::stream & stream_a)
 				error_a = rai::read (stream_a, sequence);
 				if (!error_a)
 				{
-					block = rai::deserialize_block (stream_a);
-					error_a = block == nullptr;
+					rai::block_type type;
+					error_a = rai::read (stream_a, type);
+					if (!error_a)
+					{
+						if (type == rai::block_type::not_a_block)
+						{
+							error_a = deserialize_hashes (stream_a);
+						}
+						else
+						{
+							block = rai::deserialize_block (stream_a, type);
+							error_a = block == nullptr;
+						}
+					}
 				}
 			}
 		}
@@ -636,8 +750,15 @@ rai::vote::vote (bool & error_a, rai::stream & stream_a, rai::block_type type_a)
 				error_a = rai::read (stream_a, sequence);
 				if (!error_a)
 				{
-					block = rai::deserialize_block (stream_a, type_a);
-					error_a = block == nullptr;
+					if (type_a == rai::block_type::not_a_block)
+					{
+						error_a = deserialize_hashes (stream_a);
+					}
+					else
+					{
+						block = rai::deserialize_block (stream_a, type_a);
+						error_a = block == nullptr;
+					}
 				}
 			}
 		}
@@ -652,6 +773,15 @@ signature (rai::sign_message (prv_a, account_a, hash ()))
 {
 }
 
+rai::vote::vote (rai::account const & account_a, rai::raw_key const & prv_a, uint64_t sequence_a, std::vector<rai::block_hash> const & hashes_a) :
+sequence (sequence_a),
+hashes (hashes_a),
+account (account_a)
+{
+	assert (!hashes.empty () && hashes.size () <= max_hashes);
+	signature = rai::sign_message (prv_a, account_a, hash ());
+}
+
 rai::vote::vote (MDB_val const & value_a)
 {
 	rai::bufferstream stream (reinterpret_cast<uint8_t const *> (value_a.mv_data), value_a.mv_size);
@@ -661,8 +791,19 @@ rai::vote::vote (MDB_val const & value_a)
 	assert (!error);
 	error = rai::read (stream, sequence);
 	assert (!error);
-	block = rai::deserialize_block (stream);
-	assert (block != nullptr);
+	rai::block_type type;
+	error = rai::read (stream, type);
+	assert (!error);
+	if (type == rai::block_type::not_a_block)
+	{
+		error = deserialize_hashes (stream);
+		assert (!error);
+	}
+	else
+	{
+		block = rai::deserialize_block (stream, type);
+		assert (block != nullptr);
+	}
 }
 
 rai::uint256_union rai::vote::hash () const
@@ -670,7 +811,19 @@ rai::uint256_union rai::vote::hash () const
 	rai::uint256_union result;
 	blake2b_state hash;
 	blake2b_init (&hash, sizeof (result.bytes));
-	blake2b_update (&hash, block->hash ().bytes.data (), sizeof (result.bytes));
+	if (block != nullptr)
+	{
+		blake2b_update (&hash, block->hash ().bytes.data (), sizeof (result.bytes));
+	}
+	else
+	{
+		// The prefix keeps a vote by hash from being reinterpreted as a vote for a full block
+		blake2b_update (&hash, hash_prefix.data (), hash_prefix.size ());
+		for (auto & i : hashes)
+		{
+			blake2b_update (&hash, i.bytes.data (), sizeof (i.bytes));
+		}
+	}
 	union
 	{
 		uint64_t qword;
@@ -687,7 +840,18 @@ void rai::vote::serialize (rai::stream & stream_a, rai::block_type)
 	write (stream_a, account);
 	write (stream_a, signature);
 	write (stream_a, sequence);
-	block->serialize (stream_a);
+	if (block != nullptr)
+	{
+		block->serialize (stream_a);
+	}
+	else
+	{
+		write (stream_a, static_cast<uint8_t> (hashes.size ()));
+		for (auto & i : hashes)
+		{
+			write (stream_a, i);
+		}
+	}
 }
 
 void rai::vote::serialize (rai::stream & stream_a)
@@ -695,7 +859,19 @@ void rai::vote::serialize (rai::stream & stream_a)
 	write (stream_a, account);
 	write (stream_a, signature);
 	write (stream_a, sequence);
-	rai::serialize_block (stream_a, *block);
+	if (block != nullptr)
+	{
+		rai::serialize_block (stream_a, *block);
+	}
+	else
+	{
+		write (stream_a, rai::block_type::not_a_block);
+		write (stream_a, static_cast<uint8_t> (hashes.size ()));
+		for (auto & i : hashes)
+		{
+			write (stream_a, i);
+		}
+	}
 }
 
 rai::genesis::genesis ()
@@ -715,6 +891,8 @@ void rai::genesis::initialize (MDB_txn * transaction_a, rai::block_store & store
 	store_a.block_put (transaction_a, hash_l, *open);
 	store_a.account_put (transaction_a, genesis_account, { hash_l, open->hash (), open->hash (), std::numeric_limits<rai::uint128_t>::max (), rai::seconds_since_epoch (), 1 });
 	store_a.representation_put (transaction_a, genesis_account, std::numeric_limits<rai::uint128_t>::max ());
+	store_a.delegator_put (transaction_a, open->representative (), genesis_account);
+	store_a.balance_index_put (transaction_a, genesis_account, std::numeric_limits<rai::uint128_t>::max ());
 	store_a.checksum_put (transaction_a, 0, 0, hash_l);
 	store_a.frontier_put (transaction_a, hash_l, genesis_account);
 }
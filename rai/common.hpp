@@ -151,6 +151,31 @@ public:
 	rai::account account;
 	rai::block_hash hash;
 };
+/**
+ * Sum and number of the pending entries of an account
+ */
+class pending_summary
+{
+public:
+	pending_summary ();
+	pending_summary (MDB_val const &);
+	rai::mdb_val val () const;
+	rai::amount amount;
+	uint64_t count;
+};
+/**
+ * Orders accounts by descending amount, the amount is stored complemented so iteration starts from the largest
+ */
+class amount_key
+{
+public:
+	amount_key (rai::amount const &, rai::account const &);
+	amount_key (MDB_val const &);
+	rai::amount amount () const;
+	rai::mdb_val val () const;
+	rai::amount complement;
+	rai::account account;
+};
 class block_info
 {
 public:
@@ -183,8 +208,12 @@ public:
 	vote (bool &, rai::stream &);
 	vote (bool &, rai::stream &, rai::block_type);
 	vote (rai::account const &, rai::raw_key const &, uint64_t, std::shared_ptr<rai::block>);
+	vote (rai::account const &, rai::raw_key const &, uint64_t, std::vector<rai::block_hash> const &);
 	vote (MDB_val const &);
 	rai::uint256_union hash () const;
+	// Hashes of every block this vote is for
+	std::vector<rai::block_hash> block_hashes () const;
+	std::string hashes_string () const;
 	bool operator== (rai::vote const &) const;
 	bool operator!= (rai::vote const &) const;
 	void serialize (rai::stream &, rai::block_type);
@@ -192,11 +221,18 @@ public:
 	std::string to_json () const;
 	// Vote round sequence number
 	uint64_t sequence;
+	// The block voted for, null if the vote is by hash
 	std::shared_ptr<rai::block> block;
+	// Blocks voted for by hash, one signature covers all of them
+	std::vector<rai::block_hash> hashes;
 	// Account that's voting
 	rai::account account;
-	// Signature of sequence + block hash
+	// Signature of sequence + block hash, or of the prefix + hashes + sequence for votes by hash
 	rai::signature signature;
+	// Reads the hash count and hashes of a vote by hash, returns true on error
+	bool deserialize_hashes (rai::stream &);
+	static size_t constexpr max_hashes = 12;
+	static std::string const hash_prefix;
 };
 enum class vote_code
 {
@@ -247,7 +283,7 @@ class votes
 {
 public:
 	votes (std::shared_ptr<rai::block>);
-	rai::tally_result vote (std::shared_ptr<rai::vote>);
+	rai::tally_result vote (rai::account const &, std::shared_ptr<rai::block>);
 	// Root block of fork
 	rai::block_hash id;
 	// All votes received by account
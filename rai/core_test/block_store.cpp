@@ -139,6 +139,34 @@ TEST (block_store, pending_iterator)
 	ASSERT_EQ (rai::amount (3), pending.amount);
 }
 
+TEST (block_store, pending_summary)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	ASSERT_EQ (0, store.pending_summary_get (transaction, 1).count);
+	store.pending_put (transaction, rai::pending_key (1, 2), { 2, 3 });
+	store.pending_put (transaction, rai::pending_key (1, 3), { 2, 4 });
+	store.pending_put (transaction, rai::pending_key (2, 3), { 2, 5 });
+	auto summary1 (store.pending_summary_get (transaction, 1));
+	ASSERT_EQ (rai::amount (7), summary1.amount);
+	ASSERT_EQ (2, summary1.count);
+	// Overwriting an entry replaces its amount
+	store.pending_put (transaction, rai::pending_key (1, 3), { 2, 10 });
+	auto summary2 (store.pending_summary_get (transaction, 1));
+	ASSERT_EQ (rai::amount (13), summary2.amount);
+	ASSERT_EQ (2, summary2.count);
+	store.pending_del (transaction, rai::pending_key (1, 2));
+	auto summary3 (store.pending_summary_get (transaction, 1));
+	ASSERT_EQ (rai::amount (10), summary3.amount);
+	ASSERT_EQ (1, summary3.count);
+	store.pending_del (transaction, rai::pending_key (1, 3));
+	ASSERT_EQ (0, store.pending_summary_get (transaction, 1).count);
+	ASSERT_EQ (rai::amount (0), store.pending_summary_get (transaction, 1).amount);
+	ASSERT_EQ (rai::amount (5), store.pending_summary_get (transaction, 2).amount);
+}
+
 TEST (block_store, genesis)
 {
 	bool init (false);
@@ -226,6 +254,258 @@ TEST (unchecked, double_put)
 	ASSERT_EQ (block3.size (), 1);
 }
 
+TEST (unchecked, index)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<rai::send_block> (5, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.unchecked_put (transaction, block1->source (), block1);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	ASSERT_EQ (2, store.unchecked_index.entries.size ());
+	ASSERT_EQ (2 * (1 + rai::send_block::size), store.unchecked_index.bytes);
+	ASSERT_TRUE (store.unchecked_index.exists (block1->previous (), block1->hash ()));
+	store.flush (transaction);
+	store.unchecked_index_load (transaction);
+	ASSERT_EQ (2, store.unchecked_index.entries.size ());
+	store.unchecked_del (transaction, block1->source (), *block1);
+	ASSERT_FALSE (store.unchecked_index.exists (block1->source (), block1->hash ()));
+	ASSERT_EQ (1 + rai::send_block::size, store.unchecked_index.bytes);
+	store.unchecked_put (transaction, block2->previous (), block2);
+	ASSERT_EQ (2, store.unchecked_index.entries.size ());
+}
+
+TEST (unchecked, evict_count)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	store.unchecked_index.max_count = 2;
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<rai::send_block> (5, 1, 2, rai::keypair ().prv, 4, 5));
+	auto block3 (std::make_shared<rai::send_block> (6, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	store.unchecked_put (transaction, block2->previous (), block2);
+	store.unchecked_put (transaction, block3->previous (), block3);
+	ASSERT_EQ (2, store.unchecked_index.entries.size ());
+	ASSERT_EQ (1, store.unchecked_index.evictions);
+	store.flush (transaction);
+	ASSERT_TRUE (store.unchecked_get (transaction, block1->previous ()).empty ());
+	ASSERT_EQ (2, store.unchecked_count (transaction));
+}
+
+TEST (unchecked, evict_age)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	ASSERT_EQ (1, store.unchecked_count (transaction));
+	store.unchecked_index.cutoff = std::chrono::seconds (0);
+	std::this_thread::sleep_for (std::chrono::milliseconds (10));
+	store.flush (transaction);
+	ASSERT_EQ (0, store.unchecked_count (transaction));
+	ASSERT_TRUE (store.unchecked_index.entries.empty ());
+	ASSERT_EQ (0, store.unchecked_index.bytes);
+	ASSERT_EQ (1, store.unchecked_index.evictions);
+}
+
+TEST (unchecked, evict_age_reload)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	store.unchecked_index_load (transaction);
+	ASSERT_EQ (1, store.unchecked_index.entries.size ());
+	// Stored as having arrived two days ago in an earlier run
+	std::vector<uint8_t> seconds;
+	{
+		rai::vectorstream stream (seconds);
+		rai::write (stream, static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::seconds> ((std::chrono::system_clock::now () - std::chrono::hours (48)).time_since_epoch ()).count ()));
+	}
+	ASSERT_EQ (0, mdb_put (transaction, store.unchecked_arrival, rai::unchecked_key (block1->previous (), block1->hash ()).val (), rai::mdb_val (seconds.size (), seconds.data ()), 0));
+	store.unchecked_index_load (transaction);
+	ASSERT_TRUE (store.unchecked_index.entries.empty ());
+	ASSERT_EQ (1, store.unchecked_index.evictions);
+	store.flush (transaction);
+	ASSERT_EQ (0, store.unchecked_count (transaction));
+}
+
+TEST (unchecked, arrival_per_dependency)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	// The same block waiting on two different missing blocks
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.unchecked_put (transaction, 6, block1);
+	store.flush (transaction);
+	std::vector<uint8_t> seconds;
+	{
+		rai::vectorstream stream (seconds);
+		rai::write (stream, static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::seconds> ((std::chrono::system_clock::now () - std::chrono::hours (48)).time_since_epoch ()).count ()));
+	}
+	ASSERT_EQ (0, mdb_put (transaction, store.unchecked_arrival, rai::unchecked_key (6, block1->hash ()).val (), rai::mdb_val (seconds.size (), seconds.data ()), 0));
+	store.unchecked_index_load (transaction);
+	ASSERT_EQ (1, store.unchecked_index.evictions);
+	ASSERT_TRUE (store.unchecked_index.exists (block1->previous (), block1->hash ()));
+	ASSERT_FALSE (store.unchecked_index.exists (6, block1->hash ()));
+	store.flush (transaction);
+	ASSERT_EQ (1, store.unchecked_count (transaction));
+	ASSERT_EQ (1, store.unchecked_get (transaction, block1->previous ()).size ());
+}
+
+TEST (unchecked, evict_put_again)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<rai::send_block> (5, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	// Evicts the flushed block1, its row is deleted on the next flush
+	store.unchecked_index.max_count = 1;
+	store.unchecked_put (transaction, block2->previous (), block2);
+	ASSERT_EQ (1, store.unchecked_index.evictions);
+	store.unchecked_index.max_count = rai::unchecked_index::max_count_default;
+	// Put again before that flush, the row it writes has to survive the deletion
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	ASSERT_EQ (2, store.unchecked_count (transaction));
+	ASSERT_EQ (1, store.unchecked_get (transaction, block1->previous ()).size ());
+	ASSERT_TRUE (store.unchecked_index.exists (block1->previous (), block1->hash ()));
+}
+
+TEST (block_store, upgrade_v12_v13)
+{
+	auto path (rai::unique_path ());
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		uint64_t seconds (0);
+		ASSERT_EQ (0, mdb_put (transaction, store.unchecked_arrival, rai::mdb_val (rai::block_hash (1)), rai::mdb_val (sizeof (seconds), &seconds), 0));
+		store.version_put (transaction, 12);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (12, store.version_get (transaction));
+	MDB_stat stats;
+	ASSERT_EQ (0, mdb_stat (transaction, store.unchecked_arrival, &stats));
+	ASSERT_EQ (0, stats.ms_entries);
+}
+
+TEST (block_store, write_map)
+{
+	rai::lmdb_config config;
+	config.write_map = true;
+	config.map_async = true;
+	config.no_read_ahead = true;
+	config.max_readers = 512;
+	bool init (false);
+	rai::block_store store (init, rai::unique_path (), 128, config);
+	ASSERT_TRUE (!init);
+	rai::open_block block (0, 1, 0, rai::keypair ().prv, 0, 0);
+	auto hash (block.hash ());
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		store.block_put (transaction, hash, block);
+	}
+	ASSERT_EQ (0, mdb_env_sync (store.environment, 1));
+	MDB_envinfo info;
+	ASSERT_EQ (0, mdb_env_info (store.environment, &info));
+	ASSERT_EQ (512, info.me_maxreaders);
+	rai::transaction transaction (store.environment, nullptr, false);
+	auto block2 (store.block_get (transaction, hash));
+	ASSERT_NE (nullptr, block2);
+	ASSERT_EQ (block, *block2);
+}
+
+TEST (bulk_loader, unsorted)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	// A tiny run limit forces every few entries to spill to disk and be merged back
+	rai::bulk_loader loader (store.representation, false, 64);
+	for (auto i (100); i > 0; --i)
+	{
+		rai::account account (i * 7919);
+		rai::uint128_union weight (i);
+		loader.add (rai::mdb_val (account), rai::mdb_val (weight));
+	}
+	ASSERT_LT (1, loader.runs.size ());
+	ASSERT_FALSE (loader.commit (transaction));
+	size_t count (0);
+	rai::account previous (0);
+	for (auto i (store.representation_begin (transaction)), n (store.representation_end ()); i != n; ++i)
+	{
+		rai::account account (i->first.uint256 ());
+		ASSERT_LT (previous, account);
+		ASSERT_EQ (account.number () / 7919, store.representation_get (transaction, account));
+		previous = account;
+		++count;
+	}
+	ASSERT_EQ (100, count);
+}
+
+TEST (bulk_loader, duplicate_key)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::bulk_loader loader (store.representation);
+	rai::account account (1);
+	rai::uint128_union weight1 (1);
+	rai::uint128_union weight2 (2);
+	loader.add (rai::mdb_val (account), rai::mdb_val (weight1));
+	loader.add (rai::mdb_val (account), rai::mdb_val (weight2));
+	ASSERT_TRUE (loader.commit (transaction));
+}
+
+TEST (bulk_loader, dupsort)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	auto block1 (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	auto block2 (std::make_shared<rai::send_block> (5, 1, 2, rai::keypair ().prv, 4, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::bulk_loader loader (store.unchecked, true);
+	for (auto & block : { block2, block1 })
+	{
+		std::vector<uint8_t> vector;
+		{
+			rai::vectorstream stream (vector);
+			rai::serialize_block (stream, *block);
+		}
+		loader.add (rai::mdb_val (rai::block_hash (1)), rai::mdb_val (vector.size (), vector.data ()));
+	}
+	ASSERT_FALSE (loader.commit (transaction));
+	ASSERT_EQ (2, store.unchecked_get (transaction, 1).size ());
+}
+
 TEST (checksum, simple)
 {
 	bool init (false);
@@ -608,24 +888,23 @@ TEST (block_store, sequence_increment)
 	rai::keypair key1;
 	rai::keypair key2;
 	auto block1 (std::make_shared<rai::open_block> (0, 1, 0, rai::keypair ().prv, 0, 0));
-	rai::transaction transaction (store.environment, nullptr, true);
-	auto vote1 (store.vote_generate (transaction, key1.pub, key1.prv, block1));
+	auto vote1 (store.votes.generate (key1.pub, key1.prv, block1));
 	ASSERT_EQ (1, vote1->sequence);
-	auto vote2 (store.vote_generate (transaction, key1.pub, key1.prv, block1));
+	auto vote2 (store.votes.generate (key1.pub, key1.prv, block1));
 	ASSERT_EQ (2, vote2->sequence);
-	auto vote3 (store.vote_generate (transaction, key2.pub, key2.prv, block1));
+	auto vote3 (store.votes.generate (key2.pub, key2.prv, block1));
 	ASSERT_EQ (1, vote3->sequence);
-	auto vote4 (store.vote_generate (transaction, key2.pub, key2.prv, block1));
+	auto vote4 (store.votes.generate (key2.pub, key2.prv, block1));
 	ASSERT_EQ (2, vote4->sequence);
 	vote1->sequence = 20;
-	auto seq5 (store.vote_max (transaction, vote1));
+	auto seq5 (store.votes.max (vote1));
 	ASSERT_EQ (20, seq5->sequence);
 	vote3->sequence = 30;
-	auto seq6 (store.vote_max (transaction, vote3));
+	auto seq6 (store.votes.max (vote3));
 	ASSERT_EQ (30, seq6->sequence);
-	auto vote5 (store.vote_generate (transaction, key1.pub, key1.prv, block1));
+	auto vote5 (store.votes.generate (key1.pub, key1.prv, block1));
 	ASSERT_EQ (21, vote5->sequence);
-	auto vote6 (store.vote_generate (transaction, key2.pub, key2.prv, block1));
+	auto vote6 (store.votes.generate (key2.pub, key2.prv, block1));
 	ASSERT_EQ (31, vote6->sequence);
 }
 
@@ -827,6 +1106,7 @@ TEST (block_store, change_dupsort)
 	ASSERT_EQ (0, mdb_drop (transaction, store.unchecked, 0));
 	mdb_dbi_close (store.environment, store.unchecked);
 	ASSERT_EQ (0, mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &store.unchecked));
+	store.unchecked_index_load (transaction);
 	store.unchecked_put (transaction, send1->hash (), send1);
 	store.unchecked_put (transaction, send1->hash (), send2);
 	store.flush (transaction);
@@ -837,6 +1117,7 @@ TEST (block_store, change_dupsort)
 	}
 	ASSERT_EQ (0, mdb_drop (transaction, store.unchecked, 1));
 	ASSERT_EQ (0, mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &store.unchecked));
+	store.unchecked_index_load (transaction);
 	store.unchecked_put (transaction, send1->hash (), send1);
 	store.unchecked_put (transaction, send1->hash (), send2);
 	store.flush (transaction);
@@ -881,18 +1162,86 @@ TEST (block_store, upgrade_v7_v8)
 TEST (block_store, sequence_flush)
 {
 	auto path (rai::unique_path ());
+	rai::keypair key1;
+	std::shared_ptr<rai::vote> vote1;
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		auto send1 (std::make_shared<rai::send_block> (0, 0, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+		vote1 = store.votes.generate (key1.pub, key1.prv, send1);
+		ASSERT_EQ (1, store.votes.dirty.size ());
+		ASSERT_FALSE (store.votes.flush ());
+		ASSERT_TRUE (store.votes.dirty.empty ());
+		ASSERT_EQ (1, store.votes.entries);
+	}
 	bool init (false);
 	rai::block_store store (init, path);
 	ASSERT_FALSE (init);
-	rai::transaction transaction (store.environment, nullptr, true);
+	auto seq2 (store.votes.current (vote1->account));
+	ASSERT_NE (nullptr, seq2);
+	ASSERT_EQ (*vote1, *seq2);
+}
+
+// Votes signed after the last flush are lost, sequences read back from the log skip past them
+TEST (block_store, sequence_recovery)
+{
+	auto path (rai::unique_path ());
 	rai::keypair key1;
+	rai::keypair key2;
 	auto send1 (std::make_shared<rai::send_block> (0, 0, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
-	auto vote1 (store.vote_generate (transaction, key1.pub, key1.prv, send1));
-	auto seq2 (store.vote_get (transaction, vote1->account));
-	ASSERT_EQ (nullptr, seq2);
-	store.flush (transaction);
-	auto seq3 (store.vote_get (transaction, vote1->account));
-	ASSERT_EQ (*seq3, *vote1);
+	boost::filesystem::path log;
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		log = store.votes.path;
+		store.votes.generate (key1.pub, key1.prv, send1);
+		store.votes.generate (key2.pub, key2.prv, send1);
+		ASSERT_FALSE (store.votes.flush ());
+		// Never persisted
+		store.votes.generate (key1.pub, key1.prv, send1);
+	}
+	{
+		// A record cut short while being appended
+		std::ofstream stream (log.string (), std::ios::binary | std::ios::app);
+		uint32_t size (1000);
+		stream.write (reinterpret_cast<char const *> (&size), sizeof (size));
+		stream.write ("torn", 4);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	ASSERT_EQ (1, store.votes.current (key1.pub)->sequence);
+	ASSERT_EQ (2, store.votes.entries);
+	auto vote1 (store.votes.generate (key1.pub, key1.prv, send1));
+	ASSERT_EQ (2 + rai::vote_store::sequence_margin, vote1->sequence);
+	// Only the first vote after a restart skips ahead
+	auto vote2 (store.votes.generate (key1.pub, key1.prv, send1));
+	ASSERT_EQ (vote1->sequence + 1, vote2->sequence);
+	auto vote3 (store.votes.generate (key2.pub, key2.prv, send1));
+	ASSERT_EQ (2 + rai::vote_store::sequence_margin, vote3->sequence);
+}
+
+TEST (block_store, sequence_compact_synced)
+{
+	auto path (rai::unique_path ());
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (0, 0, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	for (auto i (0); i <= rai::vote_store::compact_ratio; ++i)
+	{
+		store.votes.generate (key1.pub, key1.prv, send1);
+		ASSERT_FALSE (store.votes.flush ());
+	}
+	// Compaction replaced the log with the synced temporary file
+	ASSERT_EQ (1, store.votes.entries);
+	ASSERT_FALSE (boost::filesystem::exists (store.votes.path.string () + ".tmp"));
+	ASSERT_FALSE (rai::sync_path (store.votes.path));
+	ASSERT_FALSE (rai::sync_path (store.votes.path.parent_path ()));
+	ASSERT_TRUE (rai::sync_path (store.votes.path.string () + ".missing"));
 }
 
 // Upgrading tracking block sequence numbers to whole vote.
@@ -915,9 +1264,11 @@ TEST (block_store, upgrade_v8_v9)
 	ASSERT_FALSE (init);
 	rai::transaction transaction (store.environment, nullptr, false);
 	ASSERT_LT (8, store.version_get (transaction));
-	auto vote (store.vote_get (transaction, key.pub));
+	auto vote (store.votes.current (key.pub));
 	ASSERT_NE (nullptr, vote);
 	ASSERT_EQ (10, vote->sequence);
+	// Moved out of the ledger
+	ASSERT_EQ (store.vote_end (), store.vote_begin (transaction));
 }
 
 TEST (block_store, upgrade_v9_v10)
@@ -964,6 +1315,59 @@ TEST (block_store, upgrade_v9_v10)
 	ASSERT_EQ (block_info.balance.number (), rai::genesis_amount - rai::Gxrb_ratio * 31);
 }
 
+TEST (block_store, upgrade_v10_v11)
+{
+	auto path (rai::unique_path ());
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		rai::genesis genesis;
+		genesis.initialize (transaction, store);
+		store.version_put (transaction, 10);
+		ASSERT_EQ (0, mdb_drop (transaction, store.delegators, 0));
+		ASSERT_EQ (0, store.delegators_count (transaction, rai::genesis_account));
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (10, store.version_get (transaction));
+	ASSERT_EQ (1, store.delegators_count (transaction, rai::genesis_account));
+	auto i (store.delegators_begin (transaction, rai::genesis_account));
+	ASSERT_NE (store.delegators_end (), i);
+	ASSERT_EQ (rai::genesis_account, rai::account (i->second.uint256 ()));
+}
+
+TEST (block_store, upgrade_v11_v12)
+{
+	auto path (rai::unique_path ());
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		store.pending_put (transaction, rai::pending_key (1, 2), { 2, 3 });
+		store.pending_put (transaction, rai::pending_key (1, 3), { 2, 4 });
+		store.pending_put (transaction, rai::pending_key (3, 3), { 2, 5 });
+		store.version_put (transaction, 11);
+		ASSERT_EQ (0, mdb_drop (transaction, store.pending_summaries, 0));
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (11, store.version_get (transaction));
+	auto summary1 (store.pending_summary_get (transaction, 1));
+	ASSERT_EQ (rai::amount (7), summary1.amount);
+	ASSERT_EQ (2, summary1.count);
+	ASSERT_EQ (0, store.pending_summary_get (transaction, 2).count);
+	auto summary3 (store.pending_summary_get (transaction, 3));
+	ASSERT_EQ (rai::amount (5), summary3.amount);
+	ASSERT_EQ (1, summary3.count);
+}
+
 TEST (block_store, state_block)
 {
 	bool error (false);
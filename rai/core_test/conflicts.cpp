@@ -75,3 +75,41 @@ TEST (conflicts, add_two)
 	}
 	ASSERT_EQ (2, node1.active.roots.size ());
 }
+
+TEST (conflicts, priority)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	ASSERT_EQ (rai::process_result::progress, node1.process (*send1).code);
+	rai::keypair key2;
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key2.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	ASSERT_EQ (rai::process_result::progress, node1.process (*send2).code);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.active.start (transaction, send1);
+		node1.active.start (transaction, send2);
+	}
+	auto difficulty1 (rai::work_value (send1->root (), send1->block_work ()));
+	auto difficulty2 (rai::work_value (send2->root (), send2->block_work ()));
+	{
+		std::lock_guard<std::mutex> lock (node1.active.mutex);
+		auto & sorted (node1.active.roots.get<1> ());
+		ASSERT_EQ (2, sorted.size ());
+		// The election with more work behind it is announced first
+		ASSERT_EQ (std::max (difficulty1, difficulty2), sorted.begin ()->difficulty);
+		ASSERT_EQ (difficulty1 > difficulty2 ? send1->root () : send2->root (), sorted.begin ()->root);
+		for (auto & i : sorted)
+		{
+			i.election->confirmed = true;
+		}
+	}
+	// Confirmed elections are dropped on the next round and recorded in the duration histogram
+	node1.active.announce_votes ();
+	std::lock_guard<std::mutex> lock (node1.active.mutex);
+	ASSERT_TRUE (node1.active.roots.empty ());
+	ASSERT_EQ (2, node1.active.elections_finished);
+	ASSERT_EQ (2, node1.active.durations[0]);
+}
@@ -85,11 +85,11 @@ TEST (gap_cache, two_dependencies)
 	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key.pub, 0, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ())));
 	auto open (std::make_shared<rai::open_block> (send1->hash (), key.pub, key.pub, key.prv, key.pub, system.work.generate (key.pub)));
 	ASSERT_EQ (0, system.nodes[0]->gap_cache.blocks.size ());
-	system.nodes[0]->block_processor.process_receive_many (rai::block_processor_item (send2));
+	system.nodes[0]->block_processor.add (rai::block_processor_item (send2), rai::block_priority::local).wait ();
 	ASSERT_EQ (1, system.nodes[0]->gap_cache.blocks.size ());
-	system.nodes[0]->block_processor.process_receive_many (rai::block_processor_item (open));
+	system.nodes[0]->block_processor.add (rai::block_processor_item (open), rai::block_priority::local).wait ();
 	ASSERT_EQ (2, system.nodes[0]->gap_cache.blocks.size ());
-	system.nodes[0]->block_processor.process_receive_many (rai::block_processor_item (send1));
+	system.nodes[0]->block_processor.add (rai::block_processor_item (send1), rai::block_priority::local).wait ();
 	ASSERT_EQ (0, system.nodes[0]->gap_cache.blocks.size ());
 	rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
 	ASSERT_TRUE (system.nodes[0]->store.block_exists (transaction, send1->hash ()));
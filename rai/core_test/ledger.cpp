@@ -322,6 +322,108 @@ TEST (ledger, rollback_representation)
 	ASSERT_EQ (0, ledger.weight (transaction, key3.pub));
 }
 
+TEST (ledger, delegators)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::ledger ledger (store);
+	rai::genesis genesis;
+	ledger.state_block_parse_canary = genesis.hash ();
+	rai::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	ASSERT_EQ (1, store.delegators_count (transaction, rai::genesis_account));
+	rai::keypair rep1;
+	rai::change_block change1 (genesis.hash (), rep1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, change1).code);
+	ASSERT_EQ (0, store.delegators_count (transaction, rai::genesis_account));
+	ASSERT_EQ (1, store.delegators_count (transaction, rep1.pub));
+	rai::keypair key1;
+	rai::send_block send1 (change1.hash (), key1.pub, 50, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send1).code);
+	rai::open_block open1 (send1.hash (), rep1.pub, key1.pub, key1.prv, key1.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open1).code);
+	ASSERT_EQ (2, store.delegators_count (transaction, rep1.pub));
+	std::set<rai::account> delegators;
+	for (auto i (store.delegators_begin (transaction, rep1.pub)), n (store.delegators_end ()); i != n; i.next_dup ())
+	{
+		delegators.insert (rai::account (i->second.uint256 ()));
+	}
+	ASSERT_EQ ((std::set<rai::account>{ rai::genesis_account, key1.pub }), delegators);
+	rai::keypair rep2;
+	rai::state_block change2 (key1.pub, open1.hash (), rep2.pub, rai::genesis_amount - 50, 0, key1.prv, key1.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, change2).code);
+	ASSERT_EQ (1, store.delegators_count (transaction, rep1.pub));
+	ASSERT_EQ (1, store.delegators_count (transaction, rep2.pub));
+	ledger.rollback (transaction, change2.hash ());
+	ASSERT_EQ (2, store.delegators_count (transaction, rep1.pub));
+	ASSERT_EQ (0, store.delegators_count (transaction, rep2.pub));
+	ledger.rollback (transaction, open1.hash ());
+	ASSERT_EQ (1, store.delegators_count (transaction, rep1.pub));
+	ledger.rollback (transaction, change1.hash ());
+	ASSERT_EQ (0, store.delegators_count (transaction, rep1.pub));
+	ASSERT_EQ (1, store.delegators_count (transaction, rai::genesis_account));
+	ASSERT_EQ (store.delegators_end (), store.delegators_begin (transaction, rep1.pub));
+}
+
+TEST (ledger, sorted_indexes)
+{
+	auto path (rai::unique_path ());
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair rep1;
+	auto balances ([](rai::block_store & store_a, MDB_txn * transaction_a) {
+		std::vector<std::pair<rai::account, rai::uint128_t>> result;
+		for (auto i (store_a.balances_begin (transaction_a)), n (store_a.balances_end ()); i != n; ++i)
+		{
+			rai::amount_key key (i->first);
+			result.push_back (std::make_pair (key.account, key.amount ().number ()));
+		}
+		return result;
+	});
+	{
+		bool init (false);
+		rai::block_store store (init, path, 128, rai::lmdb_config (), true);
+		ASSERT_FALSE (init);
+		rai::ledger ledger (store);
+		rai::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		rai::send_block send1 (genesis.hash (), key1.pub, 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send1).code);
+		rai::open_block open1 (send1.hash (), rep1.pub, key1.pub, key1.prv, key1.pub, 0);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open1).code);
+		auto balances1 (balances (store, transaction));
+		ASSERT_EQ (2, balances1.size ());
+		ASSERT_EQ (key1.pub, balances1[0].first);
+		ASSERT_EQ (rai::genesis_amount - 100, balances1[0].second);
+		ASSERT_EQ (rai::genesis_account, balances1[1].first);
+		ASSERT_EQ (100, balances1[1].second);
+		auto i (store.weights_begin (transaction));
+		ASSERT_NE (store.weights_end (), i);
+		ASSERT_EQ (rep1.pub, rai::amount_key (i->first).account);
+		ASSERT_EQ (rai::genesis_amount - 100, rai::amount_key (i->first).amount ().number ());
+		ledger.rollback (transaction, open1.hash ());
+		auto balances2 (balances (store, transaction));
+		ASSERT_EQ (1, balances2.size ());
+		ASSERT_EQ (rai::genesis_account, balances2[0].first);
+	}
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_FALSE (init);
+		rai::transaction transaction (store.environment, nullptr, false);
+		ASSERT_EQ (store.balances_end (), store.balances_begin (transaction));
+		ASSERT_EQ (store.weights_end (), store.weights_begin (transaction));
+	}
+	bool init (false);
+	rai::block_store store (init, path, 128, rai::lmdb_config (), true);
+	ASSERT_FALSE (init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	auto balances3 (balances (store, transaction));
+	ASSERT_EQ (1, balances3.size ());
+	ASSERT_EQ (100, balances3[0].second);
+}
+
 TEST (ledger, receive_rollback)
 {
 	bool init (false);
@@ -974,6 +1076,35 @@ TEST (votes, add_cooldown)
 	ASSERT_EQ (*send1, *winner.second);
 }
 
+// A single vote by hash is counted in the election of each block it lists
+TEST (votes, add_hashes)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	auto open1 (std::make_shared<rai::open_block> (send1->hash (), key1.pub, key1.pub, key1.prv, key1.pub, 0));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *send1).code);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *open1).code);
+		node1.active.start (transaction, send1);
+		node1.active.start (transaction, open1);
+	}
+	auto election1 (node1.active.roots.find (send1->root ())->election);
+	auto election2 (node1.active.roots.find (open1->root ())->election);
+	std::vector<rai::block_hash> hashes{ send1->hash (), open1->hash (), rai::block_hash (1) };
+	auto vote1 (std::make_shared<rai::vote> (rai::test_genesis_key.pub, rai::test_genesis_key.prv, 1, hashes));
+	ASSERT_FALSE (node1.active.vote (vote1));
+	ASSERT_EQ (2, election1->votes.rep_votes.size ());
+	ASSERT_EQ (*send1, *election1->votes.rep_votes[rai::test_genesis_key.pub]);
+	ASSERT_EQ (2, election2->votes.rep_votes.size ());
+	ASSERT_EQ (*open1, *election2->votes.rep_votes[rai::test_genesis_key.pub]);
+	// Resending it is a replay in every election
+	ASSERT_TRUE (node1.active.vote (vote1));
+}
+
 // Query for block successor
 TEST (ledger, successor)
 {
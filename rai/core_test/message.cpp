@@ -54,8 +54,8 @@ TEST (message, publish_serialization)
 	ASSERT_EQ (8, bytes.size ());
 	ASSERT_EQ (0x52, bytes[0]);
 	ASSERT_EQ (0x41, bytes[1]);
-	ASSERT_EQ (0x07, bytes[2]);
-	ASSERT_EQ (0x07, bytes[3]);
+	ASSERT_EQ (0x08, bytes[2]);
+	ASSERT_EQ (0x08, bytes[3]);
 	ASSERT_EQ (0x01, bytes[4]);
 	ASSERT_EQ (static_cast<uint8_t> (rai::message_type::publish), bytes[5]);
 	ASSERT_EQ (0x02, bytes[6]);
@@ -68,8 +68,8 @@ TEST (message, publish_serialization)
 	std::bitset<16> extensions;
 	ASSERT_FALSE (rai::message::read_header (stream, version_max, version_using, version_min, type, extensions));
 	ASSERT_EQ (0x01, version_min);
-	ASSERT_EQ (0x07, version_using);
-	ASSERT_EQ (0x07, version_max);
+	ASSERT_EQ (0x08, version_using);
+	ASSERT_EQ (0x08, version_max);
 	ASSERT_EQ (rai::message_type::publish, type);
 }
 
@@ -89,3 +89,30 @@ TEST (message, confirm_ack_serialization)
 	ASSERT_FALSE (error);
 	ASSERT_EQ (con1, con2);
 }
+
+TEST (message, confirm_ack_hash_serialization)
+{
+	rai::keypair key1;
+	std::vector<rai::block_hash> hashes;
+	for (auto i (0); i < rai::vote::max_hashes; ++i)
+	{
+		hashes.push_back (rai::block_hash (i));
+	}
+	auto vote (std::make_shared<rai::vote> (key1.pub, key1.prv, 0, hashes));
+	rai::confirm_ack con1 (vote);
+	ASSERT_EQ (rai::block_type::not_a_block, con1.block_type ());
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream1 (bytes);
+		con1.serialize (stream1);
+	}
+	// Header, account, signature, sequence, count and the hashes
+	ASSERT_EQ (8 + 32 + 64 + 8 + 1 + 32 * rai::vote::max_hashes, bytes.size ());
+	rai::bufferstream stream2 (bytes.data (), bytes.size ());
+	bool error;
+	rai::confirm_ack con2 (error, stream2);
+	ASSERT_FALSE (error);
+	ASSERT_EQ (con1, con2);
+	ASSERT_EQ (hashes, con2.vote->block_hashes ());
+	ASSERT_FALSE (rai::validate_message (key1.pub, con2.vote->hash (), con2.vote->signature));
+}
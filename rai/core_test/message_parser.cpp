@@ -107,6 +107,32 @@ TEST (message_parser, exact_confirm_req_size)
 	ASSERT_NE (parser.status, rai::message_parser::parse_status::success);
 }
 
+TEST (message_parser, exact_confirm_req_hash_size)
+{
+	rai::system system (24000, 1);
+	test_visitor visitor;
+	rai::message_parser parser (visitor, system.work);
+	std::vector<std::pair<rai::block_hash, rai::block_hash>> roots_hashes;
+	for (auto i (0); i < rai::confirm_req::roots_hashes_max; ++i)
+	{
+		roots_hashes.push_back (std::make_pair (rai::block_hash (i), rai::block_hash (i + 1)));
+	}
+	rai::confirm_req message (roots_hashes);
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		message.serialize (stream);
+	}
+	ASSERT_GE (512, bytes.size ());
+	parser.deserialize_confirm_req (bytes.data (), bytes.size ());
+	ASSERT_EQ (1, visitor.confirm_req_count);
+	ASSERT_EQ (parser.status, rai::message_parser::parse_status::success);
+	bytes.push_back (0);
+	parser.deserialize_confirm_req (bytes.data (), bytes.size ());
+	ASSERT_EQ (1, visitor.confirm_req_count);
+	ASSERT_NE (parser.status, rai::message_parser::parse_status::success);
+}
+
 TEST (message_parser, exact_publish_size)
 {
 	rai::system system (24000, 1);
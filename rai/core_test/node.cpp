@@ -3,6 +3,7 @@
 #include <rai/node/working.hpp>
 
 #include <boost/make_shared.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 TEST (node, stop)
 {
@@ -511,9 +512,23 @@ TEST (node_config, serialization)
 	config1.callback_address = "test";
 	config1.callback_port = 10;
 	config1.callback_target = "test";
+	config1.callback_connections = 10;
+	config1.callback_queue_max = 10;
+	config1.callback_batch_max = 10;
+	config1.callback_retries = 10;
+	config1.callback_timeout = std::chrono::seconds (100);
+	config1.wallet_action_threads = 3;
 	config1.lmdb_max_dbs = 256;
 	config1.state_block_parse_canary = 10;
 	config1.state_block_generate_canary = 10;
+	config1.unchecked_max_count = 10;
+	config1.unchecked_cutoff = std::chrono::seconds (10);
+	config1.lmdb.map_size = 10;
+	config1.lmdb.max_readers = 10;
+	config1.lmdb.write_map = true;
+	config1.lmdb.map_async = true;
+	config1.lmdb.sync_interval = std::chrono::seconds (10);
+	config1.sorted_indexes = true;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	rai::logging logging2;
@@ -529,9 +544,23 @@ TEST (node_config, serialization)
 	ASSERT_NE (config2.callback_address, config1.callback_address);
 	ASSERT_NE (config2.callback_port, config1.callback_port);
 	ASSERT_NE (config2.callback_target, config1.callback_target);
+	ASSERT_NE (config2.callback_connections, config1.callback_connections);
+	ASSERT_NE (config2.callback_queue_max, config1.callback_queue_max);
+	ASSERT_NE (config2.callback_batch_max, config1.callback_batch_max);
+	ASSERT_NE (config2.callback_retries, config1.callback_retries);
+	ASSERT_NE (config2.callback_timeout, config1.callback_timeout);
+	ASSERT_NE (config2.wallet_action_threads, config1.wallet_action_threads);
 	ASSERT_NE (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
 	ASSERT_NE (config2.state_block_parse_canary, config1.state_block_parse_canary);
 	ASSERT_NE (config2.state_block_generate_canary, config1.state_block_generate_canary);
+	ASSERT_NE (config2.unchecked_max_count, config1.unchecked_max_count);
+	ASSERT_NE (config2.unchecked_cutoff, config1.unchecked_cutoff);
+	ASSERT_NE (config2.lmdb.map_size, config1.lmdb.map_size);
+	ASSERT_NE (config2.lmdb.max_readers, config1.lmdb.max_readers);
+	ASSERT_NE (config2.lmdb.write_map, config1.lmdb.write_map);
+	ASSERT_NE (config2.lmdb.map_async, config1.lmdb.map_async);
+	ASSERT_NE (config2.lmdb.sync_interval, config1.lmdb.sync_interval);
+	ASSERT_NE (config2.sorted_indexes, config1.sorted_indexes);
 
 	bool upgraded (false);
 	config2.deserialize_json (upgraded, tree);
@@ -545,9 +574,37 @@ TEST (node_config, serialization)
 	ASSERT_EQ (config2.callback_address, config1.callback_address);
 	ASSERT_EQ (config2.callback_port, config1.callback_port);
 	ASSERT_EQ (config2.callback_target, config1.callback_target);
+	ASSERT_EQ (config2.callback_connections, config1.callback_connections);
+	ASSERT_EQ (config2.callback_queue_max, config1.callback_queue_max);
+	ASSERT_EQ (config2.callback_batch_max, config1.callback_batch_max);
+	ASSERT_EQ (config2.callback_retries, config1.callback_retries);
+	ASSERT_EQ (config2.callback_timeout, config1.callback_timeout);
+	ASSERT_EQ (config2.wallet_action_threads, config1.wallet_action_threads);
 	ASSERT_EQ (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
 	ASSERT_EQ (config2.state_block_parse_canary, config1.state_block_parse_canary);
 	ASSERT_EQ (config2.state_block_generate_canary, config1.state_block_generate_canary);
+	ASSERT_EQ (config2.unchecked_max_count, config1.unchecked_max_count);
+	ASSERT_EQ (config2.unchecked_cutoff, config1.unchecked_cutoff);
+	ASSERT_EQ (config2.lmdb.map_size, config1.lmdb.map_size);
+	ASSERT_EQ (config2.lmdb.max_readers, config1.lmdb.max_readers);
+	ASSERT_EQ (config2.lmdb.write_map, config1.lmdb.write_map);
+	ASSERT_EQ (config2.lmdb.map_async, config1.lmdb.map_async);
+	ASSERT_EQ (config2.lmdb.sync_interval, config1.lmdb.sync_interval);
+	ASSERT_EQ (config2.sorted_indexes, config1.sorted_indexes);
+}
+
+TEST (node_config, lmdb_map_async_requires_write_map)
+{
+	rai::lmdb_config config;
+	config.map_async = true;
+	boost::property_tree::ptree tree;
+	config.serialize_json (tree);
+	rai::lmdb_config config1;
+	ASSERT_TRUE (config1.deserialize_json (tree));
+	tree.put ("write_map", true);
+	ASSERT_FALSE (config1.deserialize_json (tree));
+	ASSERT_EQ (MDB_WRITEMAP | MDB_MAPASYNC, config1.flags ());
+	ASSERT_TRUE (config1.deferred_sync ());
 }
 
 TEST (node_config, v1_v2_upgrade)
@@ -896,9 +953,9 @@ TEST (node, DISABLED_fork_bootstrap_flip)
 	rai::keypair key2;
 	auto send2 (std::make_shared<rai::send_block> (latest, key2.pub, rai::genesis_amount - rai::Gxrb_ratio, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system0.work.generate (latest)));
 	// Insert but don't rebroadcast, simulating settled blocks
-	node1.block_processor.process_receive_many (rai::block_processor_item (send1));
+	node1.block_processor.add (rai::block_processor_item (send1), rai::block_priority::local).wait ();
 	node1.block_processor.flush ();
-	node2.block_processor.process_receive_many (rai::block_processor_item (send2));
+	node2.block_processor.add (rai::block_processor_item (send2), rai::block_priority::local).wait ();
 	node2.block_processor.flush ();
 	{
 		rai::transaction transaction (node2.store.environment, nullptr, false);
@@ -1375,6 +1432,125 @@ TEST (node, send_callback)
 	ASSERT_EQ (std::numeric_limits<rai::uint128_t>::max () - system.nodes[0]->config.receive_minimum.number (), system.nodes[0]->balance (rai::test_genesis_key.pub));
 }
 
+TEST (node, callback_batch)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	// A receiver answering every request on the same keep-alive connection
+	boost::asio::ip::tcp::acceptor acceptor (system.service, rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), 24100));
+	boost::asio::ip::tcp::socket socket (system.service);
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::request<boost::beast::http::string_body> request;
+	boost::beast::http::response<boost::beast::http::string_body> response;
+	auto accepted (0);
+	auto received (0);
+	std::function<void()> serve;
+	serve = [&]() {
+		request = boost::beast::http::request<boost::beast::http::string_body> ();
+		boost::beast::http::async_read (socket, buffer, request, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+			if (!ec)
+			{
+				boost::property_tree::ptree events;
+				std::stringstream body (request.body ());
+				boost::property_tree::read_json (body, events);
+				received += events.size ();
+				response = boost::beast::http::response<boost::beast::http::string_body> ();
+				response.result (boost::beast::http::status::ok);
+				response.version (11);
+				response.keep_alive (true);
+				response.prepare_payload ();
+				boost::beast::http::async_write (socket, response, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+					if (!ec)
+					{
+						serve ();
+					}
+				});
+			}
+		});
+	};
+	acceptor.async_accept (socket, [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		++accepted;
+		serve ();
+	});
+	node1.config.callback_address = "::1";
+	node1.config.callback_port = 24100;
+	node1.config.callback_target = "/";
+	node1.config.callback_connections = 1;
+	node1.config.callback_batch_max = 8;
+	rai::keypair key;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	auto iterations (0);
+	while (received < 2)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ (1, accepted);
+	std::lock_guard<std::mutex> lock (node1.callback.mutex);
+	ASSERT_EQ (2, node1.callback.delivered);
+	ASSERT_EQ (0, node1.callback.failed);
+	ASSERT_GE (node1.callback.latency_max, node1.callback.latency_total / 2);
+}
+
+TEST (node, callback_timeout)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	// The first connection is accepted and then never read from, the retry is answered
+	boost::asio::ip::tcp::acceptor acceptor (system.service, rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), 24100));
+	boost::asio::ip::tcp::socket stalled (system.service);
+	boost::asio::ip::tcp::socket socket (system.service);
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::request<boost::beast::http::string_body> request;
+	boost::beast::http::response<boost::beast::http::string_body> response;
+	auto received (0);
+	acceptor.async_accept (stalled, [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		acceptor.async_accept (socket, [&](boost::system::error_code const & ec) {
+			ASSERT_FALSE (ec);
+			boost::beast::http::async_read (socket, buffer, request, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+				ASSERT_FALSE (ec);
+				++received;
+				response.result (boost::beast::http::status::ok);
+				response.version (11);
+				response.keep_alive (true);
+				response.prepare_payload ();
+				boost::beast::http::async_write (socket, response, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+				});
+			});
+		});
+	});
+	node1.config.callback_address = "::1";
+	node1.config.callback_port = 24100;
+	node1.config.callback_target = "/";
+	node1.config.callback_connections = 1;
+	node1.config.callback_timeout = std::chrono::seconds (1);
+	rai::keypair key;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	auto iterations (0);
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock (node1.callback.mutex);
+			if (node1.callback.delivered == 1)
+			{
+				ASSERT_EQ (0, node1.callback.failed);
+				ASSERT_LE (1, node1.callback.retries);
+				break;
+			}
+		}
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 2000);
+	}
+	ASSERT_EQ (1, received);
+}
+
 // Check that votes get replayed back to nodes if they sent an old sequence number.
 // This helps representatives continue from their last sequence number if their node is reinitialized and the old sequence number is lost
 TEST (node, vote_replay)
@@ -1385,13 +1561,10 @@ TEST (node, vote_replay)
 	system.nodes[0]->generate_work (*open);
 	for (auto i (0); i < 11000; ++i)
 	{
-		rai::transaction transaction (system.nodes[1]->store.environment, nullptr, false);
-		auto vote (system.nodes[1]->store.vote_generate (transaction, rai::test_genesis_key.pub, rai::test_genesis_key.prv, open));
+		auto vote (system.nodes[1]->store.votes.generate (rai::test_genesis_key.pub, rai::test_genesis_key.prv, open));
 	}
 	{
-		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
-		std::lock_guard<std::mutex> lock (system.nodes[0]->store.cache_mutex);
-		auto vote (system.nodes[0]->store.vote_current (transaction, rai::test_genesis_key.pub));
+		auto vote (system.nodes[0]->store.votes.current (rai::test_genesis_key.pub));
 		ASSERT_EQ (nullptr, vote);
 	}
 	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
@@ -1402,9 +1575,7 @@ TEST (node, vote_replay)
 	while (!done)
 	{
 		system.poll ();
-		rai::transaction transaction (system.nodes[0]->store.environment, nullptr, false);
-		std::lock_guard<std::mutex> lock (system.nodes[0]->store.cache_mutex);
-		auto vote (system.nodes[0]->store.vote_current (transaction, rai::test_genesis_key.pub));
+		auto vote (system.nodes[0]->store.votes.current (rai::test_genesis_key.pub));
 		done = vote && (vote->sequence >= 10000);
 		++iterations;
 		ASSERT_GT (400, iterations);
@@ -1460,3 +1631,207 @@ TEST (node, bootstrap_connection_scaling)
 	ASSERT_EQ (1, attempt->target_connections (0));
 	ASSERT_EQ (1, attempt->target_connections (50000));
 }
+
+TEST (node, unchecked_drain)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::keypair key;
+	rai::genesis genesis;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), key.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ())));
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), key.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ())));
+	auto send3 (std::make_shared<rai::send_block> (send2->hash (), key.pub, rai::genesis_amount - 300, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send2->hash ())));
+	auto open (std::make_shared<rai::open_block> (send1->hash (), key.pub, key.pub, key.prv, key.pub, system.work.generate (key.pub)));
+	auto bad (std::make_shared<rai::send_block> (send3->hash (), key.pub, rai::genesis_amount - 400, key.prv, rai::test_genesis_key.pub, system.work.generate (send3->hash ())));
+	auto after_bad (std::make_shared<rai::send_block> (bad->hash (), key.pub, rai::genesis_amount - 500, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (bad->hash ())));
+	node1.block_processor.add (rai::block_processor_item (after_bad), rai::block_priority::local).wait ();
+	node1.block_processor.add (rai::block_processor_item (bad), rai::block_priority::local).wait ();
+	node1.block_processor.add (rai::block_processor_item (send3), rai::block_priority::local).wait ();
+	node1.block_processor.add (rai::block_processor_item (send2), rai::block_priority::local).wait ();
+	node1.block_processor.add (rai::block_processor_item (open), rai::block_priority::local).wait ();
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		ASSERT_EQ (2, node1.store.unchecked_get (transaction, send1->hash ()).size ());
+	}
+	node1.block_processor.add (rai::block_processor_item (send1), rai::block_priority::local).wait ();
+	// Dependents are verified after send1 is committed and processed in a later transaction
+	node1.block_processor.flush ();
+	auto & drainer (node1.block_processor.drainer);
+	ASSERT_EQ (5, drainer.collected);
+	ASSERT_EQ (3, drainer.verified);
+	ASSERT_EQ (0, drainer.unverified);
+	ASSERT_EQ (2, drainer.rejected);
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_TRUE (node1.store.unchecked_get (transaction, send1->hash ()).empty ());
+	ASSERT_TRUE (node1.store.unchecked_get (transaction, send3->hash ()).empty ());
+	ASSERT_TRUE (node1.store.block_exists (transaction, send3->hash ()));
+	ASSERT_TRUE (node1.store.block_exists (transaction, open->hash ()));
+	ASSERT_FALSE (node1.store.block_exists (transaction, bad->hash ()));
+	// The dependent of the rejected block is dropped with it rather than going back to unchecked
+	ASSERT_TRUE (node1.store.unchecked_get (transaction, bad->hash ()).empty ());
+	ASSERT_FALSE (node1.store.block_exists (transaction, after_bad->hash ()));
+	ASSERT_EQ (rai::genesis_amount - 300, node1.ledger.account_balance (transaction, rai::test_genesis_key.pub));
+}
+
+TEST (node, vote_generator_bundle)
+{
+	rai::system system (24000, 2);
+	auto & node1 (*system.nodes[0]);
+	auto & node2 (*system.nodes[1]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	std::vector<rai::endpoint> endpoints{ node2.network.endpoint () };
+	for (auto i (0); i < rai::vote::max_hashes; ++i)
+	{
+		node1.vote_generator.add (rai::block_hash (i), endpoints);
+	}
+	auto iterations (0);
+	while (node2.network.incoming.confirm_ack == 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	// One signature covered every block
+	std::lock_guard<std::mutex> lock (node1.vote_generator.mutex);
+	ASSERT_EQ (1, node1.vote_generator.generated);
+	ASSERT_EQ (rai::vote::max_hashes, node1.vote_generator.bundled);
+}
+
+TEST (node, confirm_req_batching)
+{
+	rai::system system (24000, 4);
+	auto & node1 (*system.nodes[0]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	rai::genesis genesis;
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	auto previous (genesis.hash ());
+	for (auto i (0); i < 20; ++i)
+	{
+		auto send (std::make_shared<rai::send_block> (previous, rai::test_genesis_key.pub, rai::genesis_amount - (i + 1), rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous)));
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *send).code);
+		blocks.push_back (send);
+		previous = send->hash ();
+	}
+	std::mutex mutex;
+	std::vector<std::unordered_set<rai::block_hash>> confirmed (system.nodes.size ());
+	std::unordered_set<rai::account> voters;
+	for (auto i (1); i < system.nodes.size (); ++i)
+	{
+		auto & hashes (confirmed[i]);
+		system.nodes[i]->observers.vote.add ([&mutex, &hashes, &voters](std::shared_ptr<rai::vote> vote_a, rai::endpoint const &) {
+			std::lock_guard<std::mutex> lock (mutex);
+			voters.insert (vote_a->account);
+			for (auto & hash : vote_a->block_hashes ())
+			{
+				hashes.insert (hash);
+			}
+		});
+		for (auto & block : blocks)
+		{
+			system.nodes[i]->network.request_confirmation (node1.network.endpoint (), block);
+		}
+	}
+	auto iterations (0);
+	auto done (false);
+	while (!done)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 500);
+		std::lock_guard<std::mutex> lock (mutex);
+		done = true;
+		for (auto i (1); i < system.nodes.size (); ++i)
+		{
+			done = done && confirmed[i].size () == blocks.size ();
+		}
+	}
+	// Every block was requested through the aggregator and answered by the only representative
+	for (auto i (1); i < system.nodes.size (); ++i)
+	{
+		auto & aggregator (system.nodes[i]->request_aggregator);
+		std::lock_guard<std::mutex> lock (aggregator.mutex);
+		ASSERT_EQ (blocks.size (), aggregator.requested);
+	}
+	std::lock_guard<std::mutex> lock (mutex);
+	ASSERT_EQ (1, voters.size ());
+	ASSERT_NE (voters.end (), voters.find (rai::test_genesis_key.pub));
+}
+
+TEST (node, confirm_req_hashes_unknown_peer)
+{
+	rai::system system (24000, 1);
+	auto & node0 (*system.nodes[0]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	rai::node_init init1;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, 24001, rai::unique_path (), system.alarm, system.logging, system.work));
+	node1->start ();
+	rai::genesis genesis;
+	std::vector<std::pair<rai::block_hash, rai::block_hash>> roots_hashes{ std::make_pair (genesis.hash (), genesis.hash ()) };
+	node1->network.send_confirm_req (node0.network.endpoint (), roots_hashes);
+	auto iterations (0);
+	while (node0.network.confirm_req_unknown == 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	// The first request made the sender a known peer, later ones are answered
+	ASSERT_EQ (0, node0.network.confirm_req_limited);
+	ASSERT_TRUE (node0.peers.known_peer (node1->network.endpoint ()));
+	std::atomic<bool> voted (false);
+	node1->observers.vote.add ([&voted](std::shared_ptr<rai::vote>, rai::endpoint const &) {
+		voted = true;
+	});
+	node1->network.send_confirm_req (node0.network.endpoint (), roots_hashes);
+	iterations = 0;
+	while (!voted)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ (1, node0.network.confirm_req_unknown);
+	node1->stop ();
+}
+
+TEST (node, block_processor_priority)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	auto send1 (std::make_shared<rai::send_block> (genesis.hash (), rai::test_genesis_key.pub, rai::genesis_amount - 1, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ())));
+	rai::process_return result;
+	ASSERT_FALSE (node1.block_processor.process_one (rai::block_processor_item (send1), result));
+	ASSERT_EQ (rai::process_result::progress, result.code);
+	ASSERT_FALSE (node1.block_processor.process_one (rai::block_processor_item (send1), result));
+	ASSERT_EQ (rai::process_result::old, result.code);
+	auto send2 (std::make_shared<rai::send_block> (send1->hash (), rai::test_genesis_key.pub, rai::genesis_amount - 2, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ())));
+	ASSERT_EQ (rai::process_result::progress, node1.block_processor.add (rai::block_processor_item (send2), rai::block_priority::network).get ().code);
+	ASSERT_EQ (send2->hash (), node1.latest (rai::test_genesis_key.pub));
+	node1.block_processor.stop ();
+	auto send3 (std::make_shared<rai::send_block> (send2->hash (), rai::test_genesis_key.pub, rai::genesis_amount - 3, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send2->hash ())));
+	ASSERT_TRUE (node1.block_processor.process_one (rai::block_processor_item (send3), result));
+	ASSERT_EQ (send2->hash (), node1.latest (rai::test_genesis_key.pub));
+}
+
+TEST (node, process_through_processor)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	std::atomic<unsigned> observed (0);
+	node1.observers.blocks.add ([&observed](std::shared_ptr<rai::block>, rai::process_return const &) {
+		++observed;
+	});
+	rai::genesis genesis;
+	rai::send_block send1 (genesis.hash (), rai::test_genesis_key.pub, rai::genesis_amount - 1, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()));
+	ASSERT_EQ (rai::process_result::progress, node1.process (send1).code);
+	// Observers run before the waiter resumes
+	ASSERT_EQ (1, observed);
+	// A stopped processor falls back to writing directly
+	node1.block_processor.stop ();
+	rai::send_block send2 (send1.hash (), rai::test_genesis_key.pub, rai::genesis_amount - 2, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1.hash ()));
+	ASSERT_EQ (rai::process_result::progress, node1.process (send2).code);
+	ASSERT_EQ (1, observed);
+	ASSERT_EQ (send2.hash (), node1.latest (rai::test_genesis_key.pub));
+}
@@ -159,3 +159,21 @@ TEST (peer_container, reachout)
 	peers.purge_list (std::chrono::steady_clock::now () + std::chrono::seconds (10));
 	ASSERT_FALSE (peers.reachout (endpoint1));
 }
+
+TEST (peer_container, confirm_req_limited)
+{
+	rai::peer_container peers (rai::endpoint{});
+	rai::endpoint endpoint0 (boost::asio::ip::address_v6::loopback (), 24000);
+	rai::endpoint endpoint1 (boost::asio::ip::address_v6::loopback (), 24001);
+	// Unknown senders are never answered
+	ASSERT_TRUE (peers.confirm_req_limited (endpoint0));
+	peers.insert (endpoint0, 0);
+	peers.insert (endpoint1, 0);
+	for (auto i (0); i < rai::peer_container::confirm_req_per_second; ++i)
+	{
+		ASSERT_FALSE (peers.confirm_req_limited (endpoint0));
+	}
+	ASSERT_TRUE (peers.confirm_req_limited (endpoint0));
+	// The limit is per sender
+	ASSERT_FALSE (peers.confirm_req_limited (endpoint1));
+}
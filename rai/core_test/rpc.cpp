@@ -959,6 +959,40 @@ TEST (rpc, history_count)
 	ASSERT_EQ (1, history_node.size ());
 }
 
+TEST (rpc, history_streamed_matches_buffered)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	rai::keypair key;
+	boost::property_tree::ptree request;
+	request.put ("account", key.pub.to_account ());
+	request.put ("count", 10);
+	// Without chunks the response goes through a property_tree, like TLS connections
+	std::string buffered;
+	auto handler1 (std::make_shared<rai::rpc_handler> (node1, rpc, "", [&buffered](boost::property_tree::ptree const & tree_a) {
+		std::stringstream ostream;
+		boost::property_tree::write_json (ostream, tree_a);
+		buffered = ostream.str ();
+	}));
+	handler1->request = request;
+	handler1->dispatch ("account_history");
+	std::string streamed;
+	auto handler2 (std::make_shared<rai::rpc_handler> (node1, rpc, "", [](boost::property_tree::ptree const &) {}));
+	handler2->chunk = [&streamed](std::string & chunk_a, bool) {
+		streamed.append (chunk_a);
+		return false;
+	};
+	handler2->request = request;
+	handler2->dispatch ("account_history");
+	ASSERT_FALSE (buffered.empty ());
+	ASSERT_EQ (buffered, streamed);
+	boost::property_tree::ptree tree;
+	std::stringstream istream (streamed);
+	boost::property_tree::read_json (istream, tree);
+	ASSERT_EQ ("", tree.get<std::string> ("history"));
+}
+
 TEST (rpc, process_block)
 {
 	rai::system system (24000, 1);
@@ -1382,6 +1416,14 @@ TEST (rpc_config, serialization)
 	config1.enable_control = true;
 	config1.frontier_request_limit = 8192;
 	config1.chain_request_limit = 4096;
+	config1.max_connections = 16;
+	config1.idle_timeout = std::chrono::seconds (5);
+	config1.worker_threads = 100;
+	config1.expensive_concurrency = 10;
+	config1.queue_max = 10;
+	config1.cache_ttl["block_count"] = std::chrono::milliseconds (500);
+	config1.cache_max = 10;
+	config1.websocket_queue_max = 10;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	rai::rpc_config config2;
@@ -1390,12 +1432,465 @@ TEST (rpc_config, serialization)
 	ASSERT_NE (config2.enable_control, config1.enable_control);
 	ASSERT_NE (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_NE (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_NE (config2.max_connections, config1.max_connections);
+	ASSERT_NE (config2.idle_timeout, config1.idle_timeout);
+	ASSERT_NE (config2.worker_threads, config1.worker_threads);
+	ASSERT_NE (config2.expensive_concurrency, config1.expensive_concurrency);
+	ASSERT_NE (config2.queue_max, config1.queue_max);
+	ASSERT_NE (config2.cache_ttl, config1.cache_ttl);
+	ASSERT_NE (config2.cache_max, config1.cache_max);
+	ASSERT_NE (config2.websocket_queue_max, config1.websocket_queue_max);
 	config2.deserialize_json (tree);
 	ASSERT_EQ (config2.address, config1.address);
 	ASSERT_EQ (config2.port, config1.port);
 	ASSERT_EQ (config2.enable_control, config1.enable_control);
 	ASSERT_EQ (config2.frontier_request_limit, config1.frontier_request_limit);
 	ASSERT_EQ (config2.chain_request_limit, config1.chain_request_limit);
+	ASSERT_EQ (config2.max_connections, config1.max_connections);
+	ASSERT_EQ (config2.idle_timeout, config1.idle_timeout);
+	ASSERT_EQ (config2.worker_threads, config1.worker_threads);
+	ASSERT_EQ (config2.expensive_concurrency, config1.expensive_concurrency);
+	ASSERT_EQ (config2.queue_max, config1.queue_max);
+	ASSERT_EQ (config2.cache_ttl, config1.cache_ttl);
+	ASSERT_EQ (config2.cache_max, config1.cache_max);
+	ASSERT_EQ (config2.websocket_queue_max, config1.websocket_queue_max);
+}
+
+TEST (json_writer, chunks)
+{
+	std::string output;
+	size_t chunks (0);
+	size_t last (0);
+	rai::json_writer writer ([&](std::string & chunk_a, bool last_a) {
+		output.append (chunk_a);
+		++chunks;
+		last += last_a ? 1 : 0;
+		return false;
+	},
+	16);
+	writer.begin_object ();
+	writer.put ("escaped", "\"quoted\"\\\n\t");
+	writer.begin_object ("accounts");
+	for (auto i (0); i < 10; ++i)
+	{
+		writer.put (std::to_string (i), std::to_string (i * i));
+	}
+	writer.end_object ();
+	writer.begin_array ("history");
+	boost::property_tree::ptree entry;
+	entry.put ("type", "send");
+	entry.put ("amount", "1");
+	writer.put_child (entry);
+	writer.put ("plain");
+	writer.end_array ();
+	writer.end_object ();
+	writer.finish ();
+	ASSERT_LT (1, chunks);
+	ASSERT_EQ (1, last);
+	boost::property_tree::ptree tree;
+	std::stringstream istream (output);
+	boost::property_tree::read_json (istream, tree);
+	ASSERT_EQ ("\"quoted\"\\\n\t", tree.get<std::string> ("escaped"));
+	ASSERT_EQ (10, tree.get_child ("accounts").size ());
+	ASSERT_EQ ("81", tree.get<std::string> ("accounts.9"));
+	auto & history (tree.get_child ("history"));
+	ASSERT_EQ (2, history.size ());
+	ASSERT_EQ ("send", history.begin ()->second.get<std::string> ("type"));
+	ASSERT_EQ ("plain", (++history.begin ())->second.get<std::string> (""));
+}
+
+TEST (json_writer, write_json_equivalence)
+{
+	boost::property_tree::ptree entry;
+	entry.put ("type", "send");
+	entry.put ("path", "a/b \"c\"\x01");
+	boost::property_tree::ptree nested;
+	nested.put ("empty", "");
+	entry.add_child ("nested", nested);
+	boost::property_tree::ptree tree;
+	tree.put ("escaped", "\\\n\t");
+	boost::property_tree::ptree history;
+	history.push_back (std::make_pair ("", entry));
+	history.push_back (std::make_pair ("", boost::property_tree::ptree ("plain")));
+	tree.add_child ("history", history);
+	tree.put ("none", "");
+	std::stringstream ostream;
+	boost::property_tree::write_json (ostream, tree);
+	std::string output;
+	rai::json_writer writer ([&output](std::string & chunk_a, bool) {
+		output.append (chunk_a);
+		return false;
+	},
+	16);
+	writer.begin_object ();
+	writer.put ("escaped", "\\\n\t");
+	writer.begin_array ("history");
+	writer.put_child (entry);
+	writer.put ("plain");
+	writer.end_array ();
+	// Containers left empty are written as an empty string, as write_json does
+	writer.begin_object ("none");
+	writer.end_object ();
+	writer.end_object ();
+	writer.finish ();
+	ASSERT_EQ (ostream.str (), output);
+}
+
+TEST (json_writer, aborted)
+{
+	size_t chunks (0);
+	rai::json_writer writer ([&](std::string & chunk_a, bool last_a) {
+		++chunks;
+		return true;
+	},
+	16);
+	writer.begin_object ();
+	writer.begin_object ("accounts");
+	for (auto i (0); i < 10 && !writer.aborted; ++i)
+	{
+		writer.put (std::to_string (i), std::to_string (i * i));
+	}
+	ASSERT_TRUE (writer.aborted);
+	writer.end_object ();
+	writer.end_object ();
+	writer.finish ();
+	ASSERT_EQ (1, chunks);
+}
+
+TEST (parse_json, read_json_equivalence)
+{
+	std::string text ("{ \"action\": \"accounts_balances\", \"count\": 10, \"sorting\": true, \"empty\": {}, \"none\": null,\n"
+	                  "\"accounts\": [\"xrb_1\", \"xrb_2\"], \"nested\": { \"list\": [ { \"a\": \"1\" }, [ -1.5e3 ] ] },\n"
+	                  "\"escaped\": \"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\" }");
+	boost::property_tree::ptree tree1;
+	ASSERT_FALSE (rai::parse_json (text, tree1));
+	boost::property_tree::ptree tree2;
+	std::stringstream istream (text);
+	boost::property_tree::read_json (istream, tree2);
+	ASSERT_EQ (tree2, tree1);
+	ASSERT_EQ ("accounts_balances", tree1.get<std::string> ("action"));
+	ASSERT_EQ (10, tree1.get<int> ("count"));
+	ASSERT_TRUE (tree1.get<bool> ("sorting"));
+	ASSERT_EQ (2, tree1.get_child ("accounts").size ());
+	ASSERT_EQ ("\"\\/\b\f\n\r\t\xc3\xa9\xf0\x9f\x98\x80", tree1.get<std::string> ("escaped"));
+}
+
+TEST (parse_json, errors)
+{
+	for (auto text : { "", "{", "{\"a\" 1}", "{\"a\": }", "{\"a\": \"1\",}", "[1 2]", "{\"a\": \"\\q\"}", "{\"a\": \"\\u12\"}", "{\"a\": tru}", "{\"a\": \"1\"} x", "{\"a\": \"\x01\"}" })
+	{
+		boost::property_tree::ptree tree;
+		ASSERT_TRUE (rai::parse_json (text, tree)) << text;
+	}
+}
+
+TEST (rpc_executor, bounded)
+{
+	rai::rpc_config config;
+	config.worker_threads = 2;
+	config.expensive_concurrency = 1;
+	config.queue_max = 1;
+	rai::rpc_executor executor (config);
+	std::promise<void> release;
+	std::shared_future<void> released (release.get_future ());
+	std::atomic<unsigned> started (0);
+	std::atomic<unsigned> finished (0);
+	auto blocking ([&]() {
+		++started;
+		released.wait ();
+		++finished;
+	});
+	ASSERT_FALSE (executor.add (rai::rpc_cost::expensive, blocking));
+	while (started < 1)
+	{
+		std::this_thread::yield ();
+	}
+	// The second expensive action waits for the first because of the concurrency limit, the third overflows the queue
+	ASSERT_FALSE (executor.add (rai::rpc_cost::expensive, blocking));
+	ASSERT_TRUE (executor.add (rai::rpc_cost::expensive, blocking));
+	std::atomic<bool> cheap_done (false);
+	ASSERT_FALSE (executor.add (rai::rpc_cost::cheap, [&]() { cheap_done = true; }));
+	while (!cheap_done)
+	{
+		std::this_thread::yield ();
+	}
+	ASSERT_EQ (1, started);
+	release.set_value ();
+	while (finished < 2)
+	{
+		std::this_thread::yield ();
+	}
+	ASSERT_EQ (1, executor.rejected);
+}
+
+// Ledger walks with a caller supplied count go through the expensive limiter whichever name they're called by
+TEST (rpc, history_cost)
+{
+	ASSERT_EQ (rai::rpc_cost::expensive, rai::rpc_executor::cost ("history"));
+	ASSERT_EQ (rai::rpc_cost::expensive, rai::rpc_executor::cost ("account_history"));
+}
+
+TEST (rpc, rpc_stats)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "account_balance");
+	request.put ("account", rai::test_genesis_key.pub.to_account ());
+	test_response response1 (request, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	request.clear ();
+	request.put ("action", "rpc_stats");
+	test_response response2 (request, rpc, system.service);
+	while (response2.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response2.status);
+	ASSERT_EQ (std::to_string (rpc.config.worker_threads), response2.json.get<std::string> ("threads"));
+	ASSERT_EQ ("1", response2.json.get<std::string> ("actions.account_balance.count"));
+	ASSERT_EQ ("0", response2.json.get<std::string> ("rejected"));
+}
+
+TEST (rpc, cache)
+{
+	rai::system system (24000, 1);
+	rai::rpc_config config (true);
+	config.cache_ttl["block_count"] = std::chrono::seconds (60);
+	config.cache_ttl["account_balance"] = std::chrono::seconds (60);
+	rai::rpc rpc (system.service, *system.nodes[0], config);
+	rpc.start ();
+	auto request_action ([&](boost::property_tree::ptree const & request_a) {
+		test_response response (request_a, rpc, system.service);
+		while (response.status == 0)
+		{
+			system.poll ();
+		}
+		EXPECT_EQ (200, response.status);
+		return response.json;
+	});
+	boost::property_tree::ptree block_count;
+	block_count.put ("action", "block_count");
+	boost::property_tree::ptree balance;
+	balance.put ("action", "account_balance");
+	balance.put ("account", rai::test_genesis_key.pub.to_account ());
+	boost::property_tree::ptree other;
+	rai::keypair key;
+	other.put ("action", "account_balance");
+	other.put ("account", key.pub.to_account ());
+	ASSERT_EQ ("1", request_action (block_count).get<std::string> ("count"));
+	request_action (balance);
+	request_action (other);
+	ASSERT_EQ ("1", request_action (block_count).get<std::string> ("count"));
+	request_action (balance);
+	request_action (other);
+	ASSERT_EQ (1, rpc.cache.stats["block_count"].hits);
+	ASSERT_EQ (2, rpc.cache.stats["account_balance"].hits);
+	// A send from genesis invalidates ledger wide entries and both accounts it touched
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	auto iterations (0);
+	while (rpc.cache.current () == 0)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	ASSERT_EQ ("2", request_action (block_count).get<std::string> ("count"));
+	ASSERT_EQ ("100", request_action (other).get<std::string> ("pending"));
+	ASSERT_EQ (1, rpc.cache.stats["block_count"].hits);
+	ASSERT_EQ (2, rpc.cache.stats["account_balance"].hits);
+}
+
+TEST (rpc, websocket)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	rai::keypair key;
+	std::atomic<bool> subscribed (false);
+	std::atomic<bool> done (false);
+	std::string ack;
+	std::string event;
+	// The client blocks on its own io_service while the node's is polled here
+	std::thread client ([&]() {
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::socket socket (service);
+		socket.connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port));
+		boost::beast::websocket::stream<boost::asio::ip::tcp::socket &> ws (socket);
+		ws.handshake ("localhost", "/");
+		boost::property_tree::ptree request;
+		request.put ("action", "subscribe");
+		request.put ("topic", "block");
+		boost::property_tree::ptree accounts;
+		boost::property_tree::ptree entry;
+		entry.put ("", key.pub.to_account ());
+		accounts.push_back (std::make_pair ("", entry));
+		request.add_child ("accounts", accounts);
+		std::stringstream text;
+		boost::property_tree::write_json (text, request);
+		ws.write (boost::asio::buffer (text.str ()));
+		boost::beast::flat_buffer buffer;
+		ws.read (buffer);
+		ack.assign (boost::asio::buffers_begin (buffer.data ()), boost::asio::buffers_end (buffer.data ()));
+		buffer.consume (buffer.size ());
+		subscribed = true;
+		ws.read (buffer);
+		event.assign (boost::asio::buffers_begin (buffer.data ()), boost::asio::buffers_end (buffer.data ()));
+		done = true;
+	});
+	auto iterations (0);
+	while (!subscribed)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	boost::property_tree::ptree ack_l;
+	std::stringstream ack_stream (ack);
+	boost::property_tree::read_json (ack_stream, ack_l);
+	ASSERT_EQ ("subscribe", ack_l.get<std::string> ("ack"));
+	// Only the send involves the subscribed account
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	auto send (system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	ASSERT_NE (nullptr, send);
+	iterations = 0;
+	while (!done)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	client.join ();
+	boost::property_tree::ptree event_l;
+	std::stringstream event_stream (event);
+	boost::property_tree::read_json (event_stream, event_l);
+	ASSERT_EQ ("block", event_l.get<std::string> ("topic"));
+	ASSERT_EQ (send->hash ().to_string (), event_l.get<std::string> ("message.hash"));
+	ASSERT_EQ (rai::test_genesis_key.pub.to_account (), event_l.get<std::string> ("message.account"));
+	ASSERT_EQ ("100", event_l.get<std::string> ("message.amount"));
+	ASSERT_GE (rpc.websocket->sent, 1);
+}
+
+TEST (rpc, keep_alive_pipelining)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	// Both requests are written before either response is read
+	std::stringstream requests;
+	for (auto action : { "account_balance", "block_count" })
+	{
+		boost::property_tree::ptree request;
+		request.put ("action", action);
+		request.put ("account", rai::test_genesis_key.pub.to_account ());
+		std::stringstream body;
+		boost::property_tree::write_json (body, request);
+		boost::beast::http::request<boost::beast::http::string_body> req;
+		req.method (boost::beast::http::verb::post);
+		req.target ("/");
+		req.version (11);
+		req.body () = body.str ();
+		req.prepare_payload ();
+		requests << req;
+	}
+	auto data (requests.str ());
+	boost::asio::ip::tcp::socket sock (system.service);
+	boost::beast::flat_buffer sb;
+	boost::beast::http::response<boost::beast::http::string_body> resp1;
+	boost::beast::http::response<boost::beast::http::string_body> resp2;
+	int status (0);
+	sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		boost::asio::async_write (sock, boost::asio::buffer (data), [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+			ASSERT_FALSE (ec);
+			boost::beast::http::async_read (sock, sb, resp1, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+				ASSERT_FALSE (ec);
+				boost::beast::http::async_read (sock, sb, resp2, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+					status = ec ? 400 : 200;
+				});
+			});
+		});
+	});
+	while (status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, status);
+	ASSERT_TRUE (resp1.keep_alive ());
+	boost::property_tree::ptree json1;
+	std::stringstream body1 (resp1.body ());
+	boost::property_tree::read_json (body1, json1);
+	ASSERT_EQ ("340282366920938463463374607431768211455", json1.get<std::string> ("balance"));
+	boost::property_tree::ptree json2;
+	std::stringstream body2 (resp2.body ());
+	boost::property_tree::read_json (body2, json2);
+	ASSERT_EQ ("1", json2.get<std::string> ("count"));
+	ASSERT_EQ (1, rpc.connections);
+}
+
+TEST (rpc, idle_timeout)
+{
+	rai::system system (24000, 1);
+	rai::rpc_config config (true);
+	config.idle_timeout = std::chrono::seconds (1);
+	rai::rpc rpc (system.service, *system.nodes[0], config);
+	rpc.start ();
+	boost::asio::ip::tcp::socket sock (system.service);
+	boost::beast::flat_buffer sb;
+	boost::beast::http::response<boost::beast::http::string_body> resp;
+	boost::system::error_code error;
+	auto done (false);
+	sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		// Nothing is sent so the server closes the connection once it's idle
+		boost::beast::http::async_read (sock, sb, resp, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+			error = ec;
+			done = true;
+		});
+	});
+	auto deadline (std::chrono::steady_clock::now () + std::chrono::seconds (10));
+	while (!done)
+	{
+		system.poll ();
+		ASSERT_LT (std::chrono::steady_clock::now (), deadline);
+	}
+	ASSERT_TRUE (!!error);
+}
+
+TEST (rpc, max_connections)
+{
+	rai::system system (24000, 1);
+	rai::rpc_config config (true);
+	config.max_connections = 1;
+	rai::rpc rpc (system.service, *system.nodes[0], config);
+	rpc.start ();
+	boost::asio::ip::tcp::socket sock1 (system.service);
+	boost::asio::ip::tcp::socket sock2 (system.service);
+	boost::beast::flat_buffer sb;
+	boost::beast::http::response<boost::beast::http::string_body> resp;
+	boost::system::error_code error;
+	auto done (false);
+	sock1.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		sock2.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&](boost::system::error_code const & ec) {
+			ASSERT_FALSE (ec);
+			boost::beast::http::async_read (sock2, sb, resp, [&](boost::system::error_code const & ec, size_t bytes_transferred) {
+				error = ec;
+				done = true;
+			});
+		});
+	});
+	while (!done)
+	{
+		system.poll ();
+	}
+	ASSERT_TRUE (!!error);
 }
 
 TEST (rpc, search_pending)
@@ -1616,6 +2111,30 @@ TEST (rpc, block_count)
 	ASSERT_EQ ("0", response1.json.get<std::string> ("unchecked"));
 }
 
+TEST (rpc, unchecked_stats)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto block (std::make_shared<rai::send_block> (4, 1, 2, rai::keypair ().prv, 4, 5));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.store.unchecked_put (transaction, block->previous (), block);
+	}
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "unchecked_stats");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	ASSERT_EQ ("1", response1.json.get<std::string> ("count"));
+	ASSERT_EQ (std::to_string (1 + rai::send_block::size), response1.json.get<std::string> ("bytes"));
+	ASSERT_EQ ("0", response1.json.get<std::string> ("evictions"));
+}
+
 TEST (rpc, frontier_count)
 {
 	rai::system system (24000, 1);
@@ -1905,6 +2424,35 @@ TEST (rpc, representatives)
 	ASSERT_EQ (rai::genesis_account, representatives[0]);
 }
 
+TEST (rpc, representatives_delegators)
+{
+	rai::system system (24000, 1);
+	rai::keypair key;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	auto & node1 (*system.nodes[0]);
+	auto latest (node1.latest (rai::test_genesis_key.pub));
+	rai::send_block send (latest, key.pub, 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, node1.generate_work (latest));
+	node1.process (send);
+	rai::open_block open (send.hash (), rai::test_genesis_key.pub, key.pub, key.prv, key.pub, node1.generate_work (key.pub));
+	ASSERT_EQ (rai::process_result::progress, node1.process (open).code);
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "representatives");
+	request.put ("delegators", "true");
+	test_response response (request, rpc, system.service);
+	while (response.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response.status);
+	auto & representatives (response.json.get_child ("representatives"));
+	ASSERT_EQ (1, representatives.size ());
+	auto & genesis (representatives.get_child (rai::genesis_account.to_account ()));
+	ASSERT_EQ (rai::genesis_amount.convert_to<std::string> (), genesis.get<std::string> ("weight"));
+	ASSERT_EQ ("2", genesis.get<std::string> ("delegators"));
+}
+
 TEST (rpc, wallet_change_seed)
 {
 	rai::system system0 (24000, 1);
@@ -3018,6 +3566,37 @@ TEST (rpc, ledger)
 	}
 }
 
+TEST (rpc, frontiers_stream)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	{
+		// Enough accounts for the response to span many chunks
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		for (auto i (1); i <= 5000; ++i)
+		{
+			rai::account_info info (i, i, i, i, 0, 1);
+			node1.store.account_put (transaction, rai::account (i), info);
+		}
+	}
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "frontiers");
+	request.put ("account", rai::account (0).to_account ());
+	request.put ("count", std::to_string (std::numeric_limits<uint64_t>::max ()));
+	test_response response (request, rpc, system.service);
+	while (response.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response.status);
+	auto & frontiers (response.json.get_child ("frontiers"));
+	ASSERT_EQ (5001, frontiers.size ());
+	ASSERT_EQ (rai::block_hash (5000).to_string (), frontiers.get<std::string> (rai::account (5000).to_account ()));
+	ASSERT_TRUE (response.resp.chunked ());
+}
+
 TEST (rpc, accounts_create)
 {
 	rai::system system (24000, 1);
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <rai/node/testing.hpp>
+#include <rai/snapshot.hpp>
+
+#include <sstream>
+
+TEST (snapshot, round_trip)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::keypair key;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	system.wallet (0)->insert_adhoc (key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	auto iterations (0);
+	while (node1.balance (key.pub).is_zero ())
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+	}
+	std::stringstream stream;
+	rai::ledger_snapshot snapshot1 (node1.store);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		ASSERT_FALSE (snapshot1.serialize (transaction, stream));
+	}
+	ASSERT_LT (0, snapshot1.entries);
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_FALSE (init);
+	rai::ledger_snapshot snapshot2 (store);
+	ASSERT_FALSE (snapshot2.deserialize (stream));
+	ASSERT_EQ (snapshot1.entries, snapshot2.entries);
+	rai::ledger ledger (store);
+	rai::transaction transaction1 (node1.store.environment, nullptr, false);
+	rai::transaction transaction2 (store.environment, nullptr, false);
+	ASSERT_EQ (node1.ledger.account_balance (transaction1, key.pub), ledger.account_balance (transaction2, key.pub));
+	ASSERT_EQ (node1.ledger.weight (transaction1, key.pub), ledger.weight (transaction2, key.pub));
+	ASSERT_EQ (node1.ledger.latest (transaction1, rai::test_genesis_key.pub), ledger.latest (transaction2, rai::test_genesis_key.pub));
+	ASSERT_EQ (node1.store.block_count (transaction1).sum (), store.block_count (transaction2).sum ());
+	ASSERT_EQ (node1.ledger.checksum (transaction1, 0, std::numeric_limits<rai::uint256_t>::max ()), ledger.checksum (transaction2, 0, std::numeric_limits<rai::uint256_t>::max ()));
+}
+
+TEST (snapshot, corrupt_chunk)
+{
+	bool init1 (false);
+	rai::block_store store1 (init1, rai::unique_path ());
+	ASSERT_FALSE (init1);
+	rai::genesis genesis;
+	std::stringstream stream;
+	{
+		rai::transaction transaction (store1.environment, nullptr, true);
+		genesis.initialize (transaction, store1);
+		rai::ledger_snapshot snapshot (store1);
+		ASSERT_FALSE (snapshot.serialize (transaction, stream));
+	}
+	auto contents (stream.str ());
+	// Flip a byte in the payload of the last chunk, which is ahead of its checksum and the end marker
+	contents[contents.size () - sizeof (rai::uint256_union) - 2] ^= 1;
+	std::stringstream corrupt (contents);
+	bool init2 (false);
+	rai::block_store store2 (init2, rai::unique_path ());
+	ASSERT_FALSE (init2);
+	rai::ledger_snapshot snapshot (store2);
+	ASSERT_TRUE (snapshot.deserialize (corrupt));
+}
+
+TEST (snapshot, bad_header)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_FALSE (init);
+	std::stringstream stream ("not a snapshot");
+	rai::ledger_snapshot snapshot (store);
+	ASSERT_TRUE (snapshot.deserialize (stream));
+}
+
+TEST (snapshot, oversized_chunk)
+{
+	std::stringstream stream;
+	uint32_t count (1);
+	uint32_t size (std::numeric_limits<uint32_t>::max ());
+	stream.write (reinterpret_cast<char const *> (&count), sizeof (count));
+	stream.write (reinterpret_cast<char const *> (&size), sizeof (size));
+	rai::snapshot_chunk chunk (1);
+	ASSERT_TRUE (chunk.deserialize (stream));
+	ASSERT_TRUE (chunk.payload.empty ());
+}
+
+TEST (snapshot, replace_keeps_other_tables)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::keypair key;
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	std::stringstream stream;
+	{
+		rai::ledger_snapshot snapshot (node1.store);
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		ASSERT_FALSE (snapshot.serialize (transaction, stream));
+	}
+	bool init1 (false);
+	rai::block_store import (init1, rai::unique_path ());
+	ASSERT_FALSE (init1);
+	rai::ledger_snapshot snapshot1 (import);
+	ASSERT_FALSE (snapshot1.deserialize (stream));
+	bool init2 (false);
+	rai::block_store store (init2, rai::unique_path ());
+	ASSERT_FALSE (init2);
+	rai::genesis genesis;
+	MDB_dbi wallet;
+	rai::uint256_union wallet_key (1);
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		// Stands in for a wallet living in the same environment as the ledger
+		ASSERT_EQ (0, mdb_dbi_open (transaction, "wallet", MDB_CREATE, &wallet));
+		ASSERT_EQ (0, mdb_put (transaction, wallet, rai::mdb_val (wallet_key), rai::mdb_val (wallet_key), 0));
+	}
+	{
+		rai::ledger_snapshot snapshot2 (store);
+		rai::transaction import_transaction (import.environment, nullptr, false);
+		rai::transaction transaction (store.environment, nullptr, true);
+		ASSERT_FALSE (snapshot2.replace (transaction, import, import_transaction));
+		ASSERT_EQ (snapshot1.entries, snapshot2.entries);
+	}
+	rai::ledger ledger (store);
+	rai::transaction transaction1 (node1.store.environment, nullptr, false);
+	rai::transaction transaction2 (store.environment, nullptr, false);
+	ASSERT_EQ (node1.ledger.latest (transaction1, rai::test_genesis_key.pub), ledger.latest (transaction2, rai::test_genesis_key.pub));
+	ASSERT_EQ (node1.ledger.weight (transaction1, rai::test_genesis_key.pub), ledger.weight (transaction2, rai::test_genesis_key.pub));
+	rai::mdb_val value;
+	ASSERT_EQ (0, mdb_get (transaction2, wallet, rai::mdb_val (wallet_key), value));
+}
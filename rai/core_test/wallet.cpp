@@ -667,6 +667,134 @@ TEST (wallet, work_generate)
 	}
 }
 
+TEST (wallet, work_precache)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	wallet->insert_adhoc (rai::test_genesis_key.prv);
+	// The block is made outside the wallet so only the precache can regenerate work for its successor
+	rai::keypair key;
+	auto send (std::make_shared<rai::send_block> (node1.latest (rai::test_genesis_key.pub), key.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0));
+	node1.generate_work (*send);
+	node1.process_active (send);
+	auto iterations (0);
+	auto again (true);
+	while (again)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		uint64_t work;
+		again = node1.ledger.latest_root (transaction, rai::test_genesis_key.pub) != send->hash () || wallet->store.work_get (transaction, rai::test_genesis_key.pub, work) || rai::work_validate (send->hash (), work);
+	}
+	ASSERT_NE (nullptr, wallet->send_action (rai::test_genesis_key.pub, key.pub, 100));
+	std::lock_guard<std::mutex> lock (node1.wallets.work_stats.mutex);
+	ASSERT_LE (1, node1.wallets.work_stats.precomputed);
+	ASSERT_EQ (1, node1.wallets.work_stats.hits);
+	ASSERT_EQ (1, node1.wallets.work_stats.sends);
+}
+
+TEST (wallet, spendable)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	rai::keypair key1;
+	rai::keypair key2;
+	wallet->insert_adhoc (key1.prv);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		wallet->insert_watch (transaction, key2.pub);
+	}
+	ASSERT_TRUE (wallet->store.spendable (key1.pub));
+	ASSERT_FALSE (wallet->store.spendable (key2.pub));
+	ASSERT_EQ (1, node1.wallets.owners (key1.pub).size ());
+	ASSERT_TRUE (node1.wallets.owners (key2.pub).empty ());
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		wallet->store.erase (transaction, key1.pub);
+	}
+	ASSERT_FALSE (wallet->store.spendable (key1.pub));
+	ASSERT_TRUE (node1.wallets.owners (key1.pub).empty ());
+}
+
+TEST (wallet, representatives_cached)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	rai::keypair key;
+	wallet->insert_adhoc (rai::test_genesis_key.prv);
+	wallet->insert_adhoc (key.prv);
+	{
+		std::lock_guard<std::mutex> lock (wallet->representatives_mutex);
+		ASSERT_EQ (1, wallet->representatives.size ());
+		ASSERT_EQ (1, wallet->representatives.count (rai::test_genesis_key.pub));
+	}
+	// Delegating to the other wallet account makes it a representative
+	ASSERT_NE (nullptr, wallet->change_action (rai::test_genesis_key.pub, key.pub));
+	auto iterations (0);
+	auto again (true);
+	while (again)
+	{
+		system.poll ();
+		++iterations;
+		ASSERT_LT (iterations, 200);
+		std::lock_guard<std::mutex> lock (wallet->representatives_mutex);
+		again = wallet->representatives.count (key.pub) == 0;
+	}
+	// Representatives that lost their weight are skipped
+	std::vector<rai::account> visited;
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.wallets.foreach_representative (transaction, [&visited](rai::public_key const & pub_a, rai::raw_key const &) {
+			visited.push_back (pub_a);
+		});
+	}
+	ASSERT_EQ (std::vector<rai::account>{ key.pub }, visited);
+	// Keys aren't kept decrypted, a locked wallet stops voting at once and keeps its representatives for when it's unlocked
+	rai::raw_key empty;
+	empty.data.clear ();
+	wallet->store.password.value_set (empty);
+	visited.clear ();
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.wallets.foreach_representative (transaction, [&visited](rai::public_key const & pub_a, rai::raw_key const &) {
+			visited.push_back (pub_a);
+		});
+	}
+	ASSERT_TRUE (visited.empty ());
+	{
+		std::lock_guard<std::mutex> lock (wallet->representatives_mutex);
+		ASSERT_EQ (1, wallet->representatives.count (key.pub));
+	}
+	ASSERT_FALSE (wallet->enter_password (""));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.wallets.foreach_representative (transaction, [&visited](rai::public_key const & pub_a, rai::raw_key const &) {
+			visited.push_back (pub_a);
+		});
+	}
+	ASSERT_EQ (std::vector<rai::account>{ key.pub }, visited);
+	// Removed keys are dropped from the representatives
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		wallet->store.erase (transaction, key.pub);
+	}
+	visited.clear ();
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.wallets.foreach_representative (transaction, [&visited](rai::public_key const & pub_a, rai::raw_key const &) {
+			visited.push_back (pub_a);
+		});
+	}
+	ASSERT_TRUE (visited.empty ());
+	std::lock_guard<std::mutex> lock (wallet->representatives_mutex);
+	ASSERT_EQ (0, wallet->representatives.count (key.pub));
+}
+
 TEST (wallet, unsynced_work)
 {
 	rai::system system (24000, 1);
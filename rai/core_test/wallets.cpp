@@ -2,6 +2,8 @@
 
 #include <rai/node/testing.hpp>
 
+#include <future>
+
 TEST (wallets, open_create)
 {
 	rai::system system (24000, 1);
@@ -93,3 +95,75 @@ TEST (wallets, wallet_create_max)
 	auto existing = wallets.items.find (key.pub);
 	ASSERT_TRUE (existing == wallets.items.end ());
 }
+
+TEST (wallets, parallel_actions)
+{
+	rai::system system (24000, 1);
+	auto & wallets (system.nodes[0]->wallets);
+	ASSERT_LE (2, wallets.threads.size ());
+	rai::keypair key1;
+	rai::keypair key2;
+	// The action for key1 only finishes once the one for key2 ran alongside it
+	std::promise<void> released;
+	auto released_future (released.get_future ().share ());
+	std::promise<bool> concurrent;
+	std::promise<void> ran2;
+	auto ran2_future (ran2.get_future ().share ());
+	wallets.queue_wallet_action (rai::wallets::high_priority, key1.pub, [&concurrent, ran2_future, released_future]() {
+		concurrent.set_value (ran2_future.wait_for (std::chrono::seconds (10)) == std::future_status::ready);
+		released_future.wait ();
+	});
+	wallets.queue_wallet_action (rai::wallets::high_priority, key2.pub, [&ran2]() {
+		ran2.set_value ();
+	});
+	ASSERT_TRUE (concurrent.get_future ().get ());
+	// Actions for the busy account wait and then run highest priority first
+	std::mutex mutex;
+	std::vector<int> order;
+	std::promise<void> done;
+	wallets.queue_wallet_action (1, key1.pub, [&]() {
+		std::lock_guard<std::mutex> lock (mutex);
+		order.push_back (1);
+		done.set_value ();
+	});
+	wallets.queue_wallet_action (2, key1.pub, [&]() {
+		std::lock_guard<std::mutex> lock (mutex);
+		order.push_back (2);
+	});
+	ASSERT_EQ (2, wallets.queue_depth ()["normal"]);
+	released.set_value ();
+	done.get_future ().wait ();
+	std::lock_guard<std::mutex> lock (mutex);
+	ASSERT_EQ ((std::vector<int>{ 2, 1 }), order);
+	ASSERT_EQ (0, wallets.queue_depth ()["normal"]);
+}
+
+TEST (wallets, generate_reserved_thread)
+{
+	rai::system system (24000, 1);
+	auto & wallets (system.nodes[0]->wallets);
+	ASSERT_LE (2, wallets.threads.size ());
+	// Blocked work generation for more accounts than there are threads
+	std::promise<void> released;
+	auto released_future (released.get_future ().share ());
+	auto generating (std::make_shared<std::atomic<unsigned>> (0));
+	for (auto i (0u), n (unsigned (wallets.threads.size ()) * 2); i < n; ++i)
+	{
+		rai::keypair key;
+		wallets.queue_wallet_action (rai::wallets::generate_priority, key.pub, [generating, released_future]() {
+			++*generating;
+			released_future.wait ();
+		});
+	}
+	// A send still gets a thread while generation holds the rest
+	rai::keypair key;
+	auto sent (std::make_shared<std::promise<void>> ());
+	wallets.queue_wallet_action (rai::wallets::high_priority, key.pub, [sent]() {
+		sent->set_value ();
+	});
+	auto sent_status (sent->get_future ().wait_for (std::chrono::seconds (10)));
+	auto generating_l (generating->load ());
+	released.set_value ();
+	ASSERT_EQ (std::future_status::ready, sent_status);
+	ASSERT_GE (wallets.threads.size () - 1, generating_l);
+}
@@ -85,8 +85,8 @@ public:
 		auto balance (ledger.balance (transaction, block_a.hashables.previous));
 		ledger.store.representation_add (transaction, representative, balance);
 		ledger.store.representation_add (transaction, hash, 0 - balance);
-		ledger.store.block_del (transaction, hash);
 		ledger.change_latest (transaction, account, block_a.hashables.previous, representative, info.balance, info.block_count - 1);
+		ledger.store.block_del (transaction, hash);
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, account);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
@@ -160,7 +160,7 @@ public:
 class ledger_processor : public rai::block_visitor
 {
 public:
-	ledger_processor (rai::ledger &, MDB_txn *);
+	ledger_processor (rai::ledger &, MDB_txn *, bool);
 	virtual ~ledger_processor () = default;
 	void send_block (rai::send_block const &) override;
 	void receive_block (rai::receive_block const &) override;
@@ -170,6 +170,8 @@ public:
 	void state_block_impl (rai::state_block const &);
 	rai::ledger & ledger;
 	MDB_txn * transaction;
+	// Signature was checked before the write transaction was opened
+	bool verified;
 	rai::process_return result;
 };
 
@@ -189,7 +191,7 @@ void ledger_processor::state_block_impl (rai::state_block const & block_a)
 	result.code = existing ? rai::process_result::old : rai::process_result::progress; // Have we seen this block before? (Unambiguous)
 	if (result.code == rai::process_result::progress)
 	{
-		result.code = validate_message (block_a.hashables.account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Unambiguous)
+		result.code = (!verified && validate_message (block_a.hashables.account, hash, block_a.signature)) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Unambiguous)
 		if (result.code == rai::process_result::progress)
 		{
 			result.code = block_a.hashables.account.is_zero () ? rai::process_result::opened_burn_account : rai::process_result::progress; // Is this for the burn account? (Unambiguous)
@@ -307,7 +309,7 @@ void ledger_processor::change_block (rai::change_block const & block_a)
 					auto latest_error (ledger.store.account_get (transaction, account, info));
 					assert (!latest_error);
 					assert (info.head == block_a.hashables.previous);
-					result.code = validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
+					result.code = (!verified && validate_message (account, hash, block_a.signature)) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
 					if (result.code == rai::process_result::progress)
 					{
 						ledger.store.block_put (transaction, hash, block_a);
@@ -344,7 +346,7 @@ void ledger_processor::send_block (rai::send_block const & block_a)
 				result.code = account.is_zero () ? rai::process_result::fork : rai::process_result::progress;
 				if (result.code == rai::process_result::progress)
 				{
-					result.code = validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
+					result.code = (!verified && validate_message (account, hash, block_a.signature)) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Malformed)
 					if (result.code == rai::process_result::progress)
 					{
 						rai::account_info info;
@@ -393,7 +395,7 @@ void ledger_processor::receive_block (rai::receive_block const & block_a)
 					result.code = account.is_zero () ? rai::process_result::gap_previous : rai::process_result::progress; //Have we seen the previous block? No entries for account at all (Harmless)
 					if (result.code == rai::process_result::progress)
 					{
-						result.code = rai::validate_message (account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
+						result.code = (!verified && rai::validate_message (account, hash, block_a.signature)) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
 						if (result.code == rai::process_result::progress)
 						{
 							rai::account_info info;
@@ -443,7 +445,7 @@ void ledger_processor::open_block (rai::open_block const & block_a)
 		result.code = source_missing ? rai::process_result::gap_source : rai::process_result::progress; // Have we seen the source block? (Harmless)
 		if (result.code == rai::process_result::progress)
 		{
-			result.code = rai::validate_message (block_a.hashables.account, hash, block_a.signature) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
+			result.code = (!verified && rai::validate_message (block_a.hashables.account, hash, block_a.signature)) ? rai::process_result::bad_signature : rai::process_result::progress; // Is the signature valid (Malformed)
 			if (result.code == rai::process_result::progress)
 			{
 				rai::account_info info;
@@ -476,9 +478,10 @@ void ledger_processor::open_block (rai::open_block const & block_a)
 	}
 }
 
-ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a) :
+ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a, bool verified_a) :
 ledger (ledger_a),
-transaction (transaction_a)
+transaction (transaction_a),
+verified (verified_a)
 {
 }
 } // namespace
@@ -560,19 +563,13 @@ rai::uint128_t rai::ledger::account_balance (MDB_txn * transaction_a, rai::accou
 
 rai::uint128_t rai::ledger::account_pending (MDB_txn * transaction_a, rai::account const & account_a)
 {
-	rai::uint128_t result (0);
-	rai::account end (account_a.number () + 1);
-	for (auto i (store.pending_begin (transaction_a, rai::pending_key (account_a, 0))), n (store.pending_begin (transaction_a, rai::pending_key (end, 0))); i != n; ++i)
-	{
-		rai::pending_info info (i->second);
-		result += info.amount.number ();
-	}
+	auto result (store.pending_summary_get (transaction_a, account_a).amount.number ());
 	return result;
 }
 
-rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a)
+rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a, bool verified_a)
 {
-	ledger_processor processor (*this, transaction_a);
+	ledger_processor processor (*this, transaction_a, verified_a);
 	block_a.visit (processor);
 	return processor.result;
 }
@@ -826,6 +823,18 @@ void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & a
 		assert (store.block_get (transaction_a, hash_a)->previous ().is_zero ());
 		info.open_block = hash_a;
 	}
+	if (!exists || hash_a.is_zero () || info.rep_block != rep_block_a)
+	{
+		delegator_update (transaction_a, account_a, exists ? info.rep_block : rai::block_hash (0), hash_a.is_zero () ? rai::block_hash (0) : rep_block_a);
+	}
+	if (exists && (hash_a.is_zero () || info.balance != balance_a))
+	{
+		store.balance_index_del (transaction_a, account_a, info.balance);
+	}
+	if (!hash_a.is_zero () && (!exists || info.balance != balance_a))
+	{
+		store.balance_index_put (transaction_a, account_a, balance_a);
+	}
 	if (!hash_a.is_zero ())
 	{
 		info.head = hash_a;
@@ -849,6 +858,33 @@ void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & a
 	}
 }
 
+void rai::ledger::delegator_update (MDB_txn * transaction_a, rai::account const & account_a, rai::block_hash const & old_rep_block_a, rai::block_hash const & new_rep_block_a)
+{
+	auto representative ([this, transaction_a](rai::block_hash const & rep_block_a) {
+		rai::account result (0);
+		if (!rep_block_a.is_zero ())
+		{
+			auto block (store.block_get (transaction_a, rep_block_a));
+			assert (block != nullptr);
+			result = block->representative ();
+		}
+		return result;
+	});
+	auto old_rep (representative (old_rep_block_a));
+	auto new_rep (representative (new_rep_block_a));
+	if (old_rep_block_a.is_zero () || new_rep_block_a.is_zero () || old_rep != new_rep)
+	{
+		if (!old_rep_block_a.is_zero ())
+		{
+			store.delegator_del (transaction_a, old_rep, account_a);
+		}
+		if (!new_rep_block_a.is_zero ())
+		{
+			store.delegator_put (transaction_a, new_rep, account_a);
+		}
+	}
+}
+
 std::unique_ptr<rai::block> rai::ledger::successor (MDB_txn * transaction_a, rai::block_hash const & block_a)
 {
 	assert (store.account_exists (transaction_a, block_a) || store.block_exists (transaction_a, block_a));
@@ -39,9 +39,11 @@ public:
 	rai::block_hash block_destination (MDB_txn *, rai::block const &);
 	rai::block_hash block_source (MDB_txn *, rai::block const &);
 	rai::uint128_t supply (MDB_txn *);
-	rai::process_return process (MDB_txn *, rai::block const &);
+	rai::process_return process (MDB_txn *, rai::block const &, bool = false);
 	void rollback (MDB_txn *, rai::block_hash const &);
 	void change_latest (MDB_txn *, rai::account const &, rai::block_hash const &, rai::account const &, rai::uint128_union const &, uint64_t, bool = false);
+	// Moves an account between the delegator lists of the representatives named by its old and new rep blocks, zero for none
+	void delegator_update (MDB_txn *, rai::account const &, rai::block_hash const &, rai::block_hash const &);
 	void checksum_update (MDB_txn *, rai::block_hash const &);
 	rai::checksum checksum (MDB_txn *, rai::account const &, rai::account const &);
 	void dump_account_chain (rai::account const &);
@@ -1362,6 +1362,12 @@ bool rai::bootstrap_initiator::in_progress ()
 	return attempt != nullptr;
 }
 
+std::shared_ptr<rai::bootstrap_attempt> rai::bootstrap_initiator::current_attempt ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return attempt;
+}
+
 void rai::bootstrap_initiator::stop ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
@@ -0,0 +1,305 @@
+#include <rai/node/callback.hpp>
+
+#include <rai/node/node.hpp>
+
+std::chrono::milliseconds const rai::callback_dispatcher::retry_delay = rai::rai_network == rai::rai_networks::rai_test_network ? std::chrono::milliseconds (10) : std::chrono::milliseconds (500);
+
+rai::callback_connection::callback_connection (std::shared_ptr<rai::node> node_a) :
+node (node_a),
+resolver (node_a->service),
+socket (node_a->service),
+timeout (node_a->service),
+attempts (0),
+connected (false),
+timed_out (false)
+{
+}
+
+void rai::callback_connection::send (std::vector<rai::callback_item> batch_a)
+{
+	batch = std::move (batch_a);
+	attempts = 0;
+	std::string body;
+	if (node->config.callback_batch_max > 1)
+	{
+		body += '[';
+		for (auto i (batch.begin ()), n (batch.end ()); i != n; ++i)
+		{
+			if (i != batch.begin ())
+			{
+				body += ',';
+			}
+			body += i->body;
+		}
+		body += ']';
+	}
+	else
+	{
+		assert (batch.size () == 1);
+		body = batch.front ().body;
+	}
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	request.method (boost::beast::http::verb::post);
+	request.target (node->config.callback_target);
+	request.version (11);
+	request.insert (boost::beast::http::field::host, node->config.callback_address);
+	request.insert (boost::beast::http::field::content_type, "application/json");
+	request.keep_alive (true);
+	request.body () = std::move (body);
+	request.prepare_payload ();
+	if (connected)
+	{
+		write ();
+	}
+	else
+	{
+		connect ();
+	}
+}
+
+void rai::callback_connection::connect ()
+{
+	auto this_l (shared_from_this ());
+	start_timeout ();
+	resolver.async_resolve (boost::asio::ip::tcp::resolver::query (node->config.callback_address, std::to_string (node->config.callback_port)), [this_l](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
+		if (!ec && !this_l->timed_out)
+		{
+			boost::asio::async_connect (this_l->socket, i_a, [this_l](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator) {
+				this_l->stop_timeout ();
+				if (!ec)
+				{
+					this_l->connected = true;
+					this_l->write ();
+				}
+				else
+				{
+					this_l->failed ("Unable to connect to callback address: " + ec.message ());
+				}
+			});
+		}
+		else
+		{
+			this_l->stop_timeout ();
+			this_l->failed ("Error resolving callback: " + ec.message ());
+		}
+	});
+}
+
+void rai::callback_connection::write ()
+{
+	auto this_l (shared_from_this ());
+	start_timeout ();
+	boost::beast::http::async_write (socket, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->stop_timeout ();
+		if (!ec)
+		{
+			this_l->read ();
+		}
+		else
+		{
+			this_l->failed ("Unable to send callback: " + ec.message ());
+		}
+	});
+}
+
+void rai::callback_connection::read ()
+{
+	auto this_l (shared_from_this ());
+	response = boost::beast::http::response<boost::beast::http::string_body> ();
+	start_timeout ();
+	boost::beast::http::async_read (socket, buffer, response, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->stop_timeout ();
+		if (!ec)
+		{
+			if (this_l->response.result () == boost::beast::http::status::ok)
+			{
+				if (!this_l->response.keep_alive ())
+				{
+					boost::system::error_code ignored;
+					this_l->socket.close (ignored);
+					this_l->connected = false;
+				}
+				this_l->node->callback.finished (this_l, true);
+			}
+			else
+			{
+				this_l->failed (boost::str (boost::format ("Callback failed with status: %1%") % this_l->response.result ()));
+			}
+		}
+		else
+		{
+			// A keep-alive connection closed by the receiver while idle also ends up here and is reopened by the retry
+			this_l->failed ("Unable complete callback: " + ec.message ());
+		}
+	});
+}
+
+void rai::callback_connection::start_timeout ()
+{
+	timed_out = false;
+	timeout.expires_from_now (node->config.callback_timeout);
+	std::weak_ptr<rai::callback_connection> this_w (shared_from_this ());
+	timeout.async_wait ([this_w](boost::system::error_code const & ec) {
+		if (ec != boost::asio::error::operation_aborted)
+		{
+			auto this_l (this_w.lock ());
+			if (this_l != nullptr)
+			{
+				// Aborts the pending operation, whose handler then fails over to the retry
+				this_l->timed_out = true;
+				this_l->resolver.cancel ();
+				boost::system::error_code ignored;
+				this_l->socket.close (ignored);
+			}
+		}
+	});
+}
+
+void rai::callback_connection::stop_timeout ()
+{
+	size_t killed (timeout.cancel ());
+	(void)killed;
+}
+
+void rai::callback_connection::failed (std::string const & message_a)
+{
+	if (node->config.logging.callback_logging ())
+	{
+		BOOST_LOG (node->log) << boost::str (boost::format ("%1%:%2% %3%%4%") % node->config.callback_address % node->config.callback_port % (timed_out ? "Timed out: " : "") % message_a);
+	}
+	boost::system::error_code ignored;
+	socket.close (ignored);
+	buffer.consume (buffer.size ());
+	connected = false;
+	auto retry (false);
+	{
+		std::lock_guard<std::mutex> lock (node->callback.mutex);
+		retry = !node->callback.stopped && attempts < node->config.callback_retries;
+		if (retry)
+		{
+			++node->callback.retries;
+		}
+	}
+	if (retry)
+	{
+		// Backs off exponentially between attempts
+		auto delay (rai::callback_dispatcher::retry_delay * (1 << std::min (attempts, 10u)));
+		++attempts;
+		auto this_l (shared_from_this ());
+		node->alarm.add (std::chrono::steady_clock::now () + delay, [this_l]() {
+			this_l->connect ();
+		});
+	}
+	else
+	{
+		node->callback.finished (shared_from_this (), false);
+	}
+}
+
+rai::callback_dispatcher::callback_dispatcher (rai::node & node_a) :
+node (node_a),
+connections (0),
+stopped (false),
+delivered (0),
+failed (0),
+dropped (0),
+retries (0),
+batches (0),
+latency_total (0),
+latency_max (0)
+{
+}
+
+bool rai::callback_dispatcher::add (std::string const & body_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	auto result (stopped || queue.size () >= node.config.callback_queue_max);
+	if (!result)
+	{
+		queue.push_back (rai::callback_item{ body_a, std::chrono::steady_clock::now () });
+		dispatch (lock);
+	}
+	else
+	{
+		++dropped;
+	}
+	return result;
+}
+
+void rai::callback_dispatcher::finished (std::shared_ptr<rai::callback_connection> connection_a, bool delivered_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (delivered_a)
+	{
+		auto now (std::chrono::steady_clock::now ());
+		for (auto & i : connection_a->batch)
+		{
+			auto latency (std::chrono::duration_cast<std::chrono::microseconds> (now - i.queued));
+			latency_total += latency;
+			latency_max = std::max (latency_max, latency);
+		}
+		delivered += connection_a->batch.size ();
+		++batches;
+	}
+	else
+	{
+		failed += connection_a->batch.size ();
+	}
+	connection_a->batch.clear ();
+	if (!stopped)
+	{
+		idle.push_back (connection_a);
+		dispatch (lock);
+	}
+	else
+	{
+		boost::system::error_code ignored;
+		connection_a->socket.close (ignored);
+	}
+}
+
+void rai::callback_dispatcher::dispatch (std::unique_lock<std::mutex> & lock_a)
+{
+	std::vector<std::pair<std::shared_ptr<rai::callback_connection>, std::vector<rai::callback_item>>> work;
+	while (!queue.empty () && (!idle.empty () || connections < node.config.callback_connections))
+	{
+		std::shared_ptr<rai::callback_connection> connection;
+		if (!idle.empty ())
+		{
+			connection = idle.back ();
+			idle.pop_back ();
+		}
+		else
+		{
+			connection = std::make_shared<rai::callback_connection> (node.shared ());
+			++connections;
+		}
+		std::vector<rai::callback_item> batch;
+		auto count (std::min<size_t> (queue.size (), std::max<size_t> (node.config.callback_batch_max, 1)));
+		batch.insert (batch.end (), std::make_move_iterator (queue.begin ()), std::make_move_iterator (queue.begin () + count));
+		queue.erase (queue.begin (), queue.begin () + count);
+		work.push_back (std::make_pair (connection, std::move (batch)));
+	}
+	lock_a.unlock ();
+	for (auto & i : work)
+	{
+		auto connection (i.first);
+		auto batch (std::make_shared<std::vector<rai::callback_item>> (std::move (i.second)));
+		node.service.post ([connection, batch]() {
+			connection->send (std::move (*batch));
+		});
+	}
+}
+
+void rai::callback_dispatcher::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	queue.clear ();
+	for (auto & i : idle)
+	{
+		boost::system::error_code ignored;
+		i->socket.close (ignored);
+	}
+	idle.clear ();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rai
+{
+class node;
+class callback_item
+{
+public:
+	std::string body;
+	std::chrono::steady_clock::time_point queued;
+};
+/**
+ * A persistent connection to the callback receiver, delivering one batch at a time and reconnecting when the receiver closes it
+ */
+class callback_connection : public std::enable_shared_from_this<rai::callback_connection>
+{
+public:
+	callback_connection (std::shared_ptr<rai::node>);
+	void send (std::vector<rai::callback_item>);
+	void connect ();
+	void write ();
+	void read ();
+	// Closes the socket if the pending resolve, connect, write or read doesn't finish within callback_timeout
+	void start_timeout ();
+	void stop_timeout ();
+	// Closes the connection and schedules another attempt until the configured retries run out
+	void failed (std::string const &);
+	std::shared_ptr<rai::node> node;
+	boost::asio::ip::tcp::resolver resolver;
+	boost::asio::ip::tcp::socket socket;
+	boost::asio::steady_timer timeout;
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::request<boost::beast::http::string_body> request;
+	boost::beast::http::response<boost::beast::http::string_body> response;
+	std::vector<rai::callback_item> batch;
+	unsigned attempts;
+	bool connected;
+	bool timed_out;
+};
+/**
+ * Queues block callbacks and delivers them over a small pool of keep-alive connections
+ * When batching is enabled each POST carries a JSON array of up to callback_batch_max events
+ */
+class callback_dispatcher
+{
+public:
+	callback_dispatcher (rai::node &);
+	// Returns true if the queue is full and the event was dropped
+	bool add (std::string const &);
+	// Called by a connection once its batch was delivered or given up on
+	void finished (std::shared_ptr<rai::callback_connection>, bool);
+	void stop ();
+	rai::node & node;
+	std::mutex mutex;
+	std::deque<rai::callback_item> queue;
+	std::vector<std::shared_ptr<rai::callback_connection>> idle;
+	unsigned connections;
+	bool stopped;
+	uint64_t delivered;
+	uint64_t failed;
+	uint64_t dropped;
+	uint64_t retries;
+	uint64_t batches;
+	// Time from queueing an event until the receiver acknowledged it
+	std::chrono::microseconds latency_total;
+	std::chrono::microseconds latency_max;
+	static std::chrono::milliseconds const retry_delay;
+
+private:
+	void dispatch (std::unique_lock<std::mutex> &);
+};
+}
@@ -8,10 +8,14 @@ std::array<uint8_t, 2> constexpr rai::message::magic_number;
 size_t constexpr rai::message::ipv4_only_position;
 size_t constexpr rai::message::bootstrap_server_position;
 std::bitset<16> constexpr rai::message::block_type_mask;
+uint8_t constexpr rai::message::protocol_version;
+uint8_t constexpr rai::message::vote_by_hash_version;
+uint8_t constexpr rai::message::confirm_req_hashes_version;
+size_t constexpr rai::confirm_req::roots_hashes_max;
 
 rai::message::message (rai::message_type type_a) :
-version_max (0x07),
-version_using (0x07),
+version_max (protocol_version),
+version_using (protocol_version),
 version_min (0x01),
 type (type_a)
 {
@@ -168,7 +172,7 @@ void rai::message_parser::deserialize_confirm_req (uint8_t const * buffer_a, siz
 	auto error_l (incoming.deserialize (stream));
 	if (!error_l && at_end (stream))
 	{
-		if (!rai::work_validate (*incoming.block))
+		if (incoming.block == nullptr || !rai::work_validate (*incoming.block))
 		{
 			visitor.confirm_req (incoming);
 		}
@@ -190,7 +194,7 @@ void rai::message_parser::deserialize_confirm_ack (uint8_t const * buffer_a, siz
 	rai::confirm_ack incoming (error_l, stream);
 	if (!error_l && at_end (stream))
 	{
-		if (!rai::work_validate (*incoming.vote->block))
+		if (incoming.vote->block == nullptr || !rai::work_validate (*incoming.vote->block))
 		{
 			visitor.confirm_ack (incoming);
 		}
@@ -319,6 +323,14 @@ block (block_a)
 	block_type_set (block->type ());
 }
 
+rai::confirm_req::confirm_req (std::vector<std::pair<rai::block_hash, rai::block_hash>> const & roots_hashes_a) :
+message (rai::message_type::confirm_req),
+roots_hashes (roots_hashes_a)
+{
+	assert (!roots_hashes.empty () && roots_hashes.size () <= roots_hashes_max);
+	block_type_set (rai::block_type::not_a_block);
+}
+
 bool rai::confirm_req::deserialize (rai::stream & stream_a)
 {
 	auto result (read_header (stream_a, version_max, version_using, version_min, type, extensions));
@@ -326,8 +338,24 @@ bool rai::confirm_req::deserialize (rai::stream & stream_a)
 	assert (type == rai::message_type::confirm_req);
 	if (!result)
 	{
-		block = rai::deserialize_block (stream_a, block_type ());
-		result = block == nullptr;
+		if (block_type () == rai::block_type::not_a_block)
+		{
+			uint8_t count;
+			result = read (stream_a, count);
+			result = result || count == 0 || count > roots_hashes_max;
+			for (auto i (0); !result && i < count; ++i)
+			{
+				rai::block_hash hash;
+				rai::block_hash root;
+				result = read (stream_a, hash) || read (stream_a, root);
+				roots_hashes.push_back (std::make_pair (hash, root));
+			}
+		}
+		else
+		{
+			block = rai::deserialize_block (stream_a, block_type ());
+			result = block == nullptr;
+		}
 	}
 	return result;
 }
@@ -339,14 +367,44 @@ void rai::confirm_req::visit (rai::message_visitor & visitor_a) const
 
 void rai::confirm_req::serialize (rai::stream & stream_a)
 {
-	assert (block != nullptr);
 	write_header (stream_a);
-	block->serialize (stream_a);
+	if (block != nullptr)
+	{
+		block->serialize (stream_a);
+	}
+	else
+	{
+		write (stream_a, static_cast<uint8_t> (roots_hashes.size ()));
+		for (auto & i : roots_hashes)
+		{
+			write (stream_a, i.first);
+			write (stream_a, i.second);
+		}
+	}
 }
 
 bool rai::confirm_req::operator== (rai::confirm_req const & other_a) const
 {
-	return *block == *other_a.block;
+	auto blocks_equal (block == nullptr ? other_a.block == nullptr : other_a.block != nullptr && *block == *other_a.block);
+	return blocks_equal && roots_hashes == other_a.roots_hashes;
+}
+
+std::string rai::confirm_req::roots_string () const
+{
+	std::string result;
+	if (block != nullptr)
+	{
+		result = block->hash ().to_string () + ":" + block->root ().to_string ();
+	}
+	for (auto & i : roots_hashes)
+	{
+		if (!result.empty ())
+		{
+			result += ", ";
+		}
+		result += i.first.to_string () + ":" + i.second.to_string ();
+	}
+	return result;
 }
 
 rai::confirm_ack::confirm_ack (bool & error_a, rai::stream & stream_a) :
@@ -359,7 +417,7 @@ rai::confirm_ack::confirm_ack (std::shared_ptr<rai::vote> vote_a) :
 message (rai::message_type::confirm_ack),
 vote (vote_a)
 {
-	block_type_set (vote->block->type ());
+	block_type_set (vote->block != nullptr ? vote->block->type () : rai::block_type::not_a_block);
 }
 
 bool rai::confirm_ack::deserialize (rai::stream & stream_a)
@@ -378,8 +436,17 @@ bool rai::confirm_ack::deserialize (rai::stream & stream_a)
 				result = read (stream_a, vote->sequence);
 				if (!result)
 				{
-					vote->block = rai::deserialize_block (stream_a, block_type ());
-					result = vote->block == nullptr;
+					if (block_type () == rai::block_type::not_a_block)
+					{
+						vote->block = nullptr;
+						vote->hashes.clear ();
+						result = vote->deserialize_hashes (stream_a);
+					}
+					else
+					{
+						vote->block = rai::deserialize_block (stream_a, block_type ());
+						result = vote->block == nullptr;
+					}
 				}
 			}
 		}
@@ -389,7 +456,7 @@ bool rai::confirm_ack::deserialize (rai::stream & stream_a)
 
 void rai::confirm_ack::serialize (rai::stream & stream_a)
 {
-	assert (block_type () == rai::block_type::send || block_type () == rai::block_type::receive || block_type () == rai::block_type::open || block_type () == rai::block_type::change || block_type () == rai::block_type::state);
+	assert (block_type () == rai::block_type::not_a_block || block_type () == rai::block_type::send || block_type () == rai::block_type::receive || block_type () == rai::block_type::open || block_type () == rai::block_type::change || block_type () == rai::block_type::state);
 	write_header (stream_a);
 	vote->serialize (stream_a, block_type ());
 }
@@ -125,6 +125,11 @@ public:
 	static size_t constexpr ipv4_only_position = 1;
 	static size_t constexpr bootstrap_server_position = 2;
 	static std::bitset<16> constexpr block_type_mask = std::bitset<16> (0x0f00);
+	static uint8_t constexpr protocol_version = 0x08;
+	// Peers from this version on understand confirm_ack carrying block hashes instead of a block
+	static uint8_t constexpr vote_by_hash_version = 0x08;
+	// Peers from this version on understand confirm_req carrying hash and root pairs instead of a block
+	static uint8_t constexpr confirm_req_hashes_version = 0x08;
 };
 class work_pool;
 class message_parser
@@ -178,11 +183,18 @@ class confirm_req : public message
 public:
 	confirm_req ();
 	confirm_req (std::shared_ptr<rai::block>);
+	confirm_req (std::vector<std::pair<rai::block_hash, rai::block_hash>> const &);
 	bool deserialize (rai::stream &) override;
 	void serialize (rai::stream &) override;
 	void visit (rai::message_visitor &) const override;
 	bool operator== (rai::confirm_req const &) const;
+	std::string roots_string () const;
+	// The block to confirm, null if the request is by hash
 	std::shared_ptr<rai::block> block;
+	// Hash and root pairs of the blocks to confirm, the responder votes for its own block on a root if it has a different one
+	std::vector<std::pair<rai::block_hash, rai::block_hash>> roots_hashes;
+	// Keeps the request within a single receive buffer
+	static size_t constexpr roots_hashes_max = 7;
 };
 class confirm_ack : public message
 {
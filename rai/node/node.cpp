@@ -3,8 +3,10 @@
 #include <rai/lib/interface.h>
 #include <rai/node/common.hpp>
 #include <rai/node/rpc.hpp>
+#include <rai/snapshot.hpp>
 
 #include <algorithm>
+#include <fstream>
 #include <future>
 #include <memory>
 #include <sstream>
@@ -31,6 +33,11 @@ std::chrono::minutes constexpr rai::node::backup_interval;
 int constexpr rai::port_mapping::mapping_timeout;
 int constexpr rai::port_mapping::check_timeout;
 unsigned constexpr rai::active_transactions::announce_interval_ms;
+unsigned constexpr rai::active_transactions::announcements_max;
+size_t constexpr rai::active_transactions::duration_buckets;
+size_t constexpr rai::block_processor::network_batch_max;
+std::chrono::milliseconds constexpr rai::vote_generator::wait;
+std::chrono::milliseconds constexpr rai::request_aggregator::window;
 
 rai::message_statistics::message_statistics () :
 keepalive (0),
@@ -47,7 +54,9 @@ node (node_a),
 bad_sender_count (0),
 on (true),
 insufficient_work_count (0),
-error_count (0)
+error_count (0),
+confirm_req_unknown (0),
+confirm_req_limited (0)
 {
 }
 
@@ -161,20 +170,41 @@ bool confirm_block (MDB_txn * transaction_a, rai::node & node_a, T & list_a, std
 	bool result (false);
 	if (node_a.config.enable_voting)
 	{
-		node_a.wallets.foreach_representative (transaction_a, [&result, &block_a, &list_a, &node_a, &transaction_a](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
-			result = true;
-			auto vote (node_a.store.vote_generate (transaction_a, pub_a, prv_a, block_a));
-			rai::confirm_ack confirm (vote);
-			std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+		// Peers that understand votes by hash get them from the vote generator, bundled with other blocks under one signature
+		std::vector<rai::endpoint> legacy;
+		std::vector<rai::endpoint> by_hash;
+		for (auto j (list_a.begin ()), m (list_a.end ()); j != m; ++j)
+		{
+			if (node_a.peers.version (*j) >= rai::message::vote_by_hash_version)
 			{
-				rai::vectorstream stream (*bytes);
-				confirm.serialize (stream);
+				by_hash.push_back (*j);
 			}
-			for (auto j (list_a.begin ()), m (list_a.end ()); j != m; ++j)
+			else
+			{
+				legacy.push_back (*j);
+			}
+		}
+		node_a.wallets.foreach_representative (transaction_a, [&result, &block_a, &legacy, &node_a, &transaction_a](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
+			result = true;
+			if (!legacy.empty ())
 			{
-				node_a.network.confirm_send (confirm, bytes, *j);
+				auto vote (node_a.store.votes.generate (pub_a, prv_a, block_a));
+				rai::confirm_ack confirm (vote);
+				std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+				{
+					rai::vectorstream stream (*bytes);
+					confirm.serialize (stream);
+				}
+				for (auto j (legacy.begin ()), m (legacy.end ()); j != m; ++j)
+				{
+					node_a.network.confirm_send (confirm, bytes, *j);
+				}
 			}
 		});
+		if (result && !by_hash.empty ())
+		{
+			node_a.vote_generator.add (block_a->hash (), by_hash);
+		}
 	}
 	return result;
 }
@@ -192,16 +222,15 @@ void rai::network::republish_block (MDB_txn * transaction, std::shared_ptr<rai::
 {
 	auto hash (block->hash ());
 	auto list (node.peers.list_sqrt ());
+	rai::publish message (block);
+	std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+	{
+		rai::vectorstream stream (*bytes);
+		message.serialize (stream);
+	}
 	// If we're a representative, broadcast a signed confirm, otherwise an unsigned publish
 	if (!confirm_block (transaction, node, list, block))
 	{
-		rai::publish message (block);
-		std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
-		{
-			rai::vectorstream stream (*bytes);
-			message.serialize (stream);
-		}
-		auto hash (block->hash ());
 		for (auto i (list.begin ()), n (list.end ()); i != n; ++i)
 		{
 			republish (hash, bytes, *i);
@@ -213,6 +242,14 @@ void rai::network::republish_block (MDB_txn * transaction, std::shared_ptr<rai::
 	}
 	else
 	{
+		// Votes by hash don't carry the block so it's published to those peers alongside the vote
+		for (auto i (list.begin ()), n (list.end ()); i != n; ++i)
+		{
+			if (node.peers.version (*i) >= rai::message::vote_by_hash_version)
+			{
+				republish (hash, bytes, *i);
+			}
+		}
 		if (node.config.logging.network_logging ())
 		{
 			BOOST_LOG (node.log) << boost::str (boost::format ("Block %1% was confirmed to peers") % hash.to_string ());
@@ -238,7 +275,11 @@ void rai::network::republish_vote (std::shared_ptr<rai::vote> vote_a)
 	auto list (node.peers.list_sqrt ());
 	for (auto j (list.begin ()), m (list.end ()); j != m; ++j)
 	{
-		node.network.confirm_send (confirm, bytes, *j);
+		// Older peers can't parse votes by hash
+		if (vote_a->block != nullptr || node.peers.version (*j) >= rai::message::vote_by_hash_version)
+		{
+			node.network.confirm_send (confirm, bytes, *j);
+		}
 	}
 }
 
@@ -247,7 +288,7 @@ void rai::network::broadcast_confirm_req (std::shared_ptr<rai::block> block_a)
 	auto list (node.peers.representatives (std::numeric_limits<size_t>::max ()));
 	for (auto i (list.begin ()), j (list.end ()); i != j; ++i)
 	{
-		node.network.send_confirm_req (i->endpoint, block_a);
+		request_confirmation (i->endpoint, block_a);
 	}
 	if (node.config.logging.network_logging ())
 	{
@@ -255,9 +296,50 @@ void rai::network::broadcast_confirm_req (std::shared_ptr<rai::block> block_a)
 	}
 }
 
+void rai::network::broadcast_confirm_req_batched (std::shared_ptr<rai::block> block_a)
+{
+	auto list (node.peers.representatives (std::numeric_limits<size_t>::max ()));
+	size_t sent (0);
+	for (auto & i : list)
+	{
+		if (i.network_version >= rai::message::confirm_req_hashes_version)
+		{
+			node.request_aggregator.add (i.endpoint, block_a);
+			++sent;
+		}
+	}
+	if (node.config.logging.network_logging ())
+	{
+		BOOST_LOG (node.log) << boost::str (boost::format ("Queued confirm req by hash for block %1% to %2% representatives") % block_a->hash ().to_string () % sent);
+	}
+}
+
+void rai::network::request_confirmation (rai::endpoint const & endpoint_a, std::shared_ptr<rai::block> block_a)
+{
+	if (node.peers.version (endpoint_a) >= rai::message::confirm_req_hashes_version)
+	{
+		node.request_aggregator.add (endpoint_a, block_a);
+	}
+	else
+	{
+		send_confirm_req (endpoint_a, block_a);
+	}
+}
+
 void rai::network::send_confirm_req (rai::endpoint const & endpoint_a, std::shared_ptr<rai::block> block)
 {
 	rai::confirm_req message (block);
+	send_confirm_req (endpoint_a, message);
+}
+
+void rai::network::send_confirm_req (rai::endpoint const & endpoint_a, std::vector<std::pair<rai::block_hash, rai::block_hash>> const & roots_hashes_a)
+{
+	rai::confirm_req message (roots_hashes_a);
+	send_confirm_req (endpoint_a, message);
+}
+
+void rai::network::send_confirm_req (rai::endpoint const & endpoint_a, rai::confirm_req & message)
+{
 	std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
 	{
 		rai::vectorstream stream (*bytes);
@@ -345,35 +427,103 @@ public:
 	{
 		if (node.config.logging.network_message_logging ())
 		{
-			BOOST_LOG (node.log) << boost::str (boost::format ("Confirm_req message from %1% for %2%") % sender % message_a.block->hash ().to_string ());
+			BOOST_LOG (node.log) << boost::str (boost::format ("Confirm_req message from %1% for %2%") % sender % message_a.roots_string ());
 		}
 		++node.network.incoming.confirm_req;
+		// Answers by hash are several times larger than the request, only send them to peers we already knew about
+		auto known (node.peers.known_peer (sender));
 		node.peers.contacted (sender, message_a.version_using);
 		node.peers.insert (sender, message_a.version_using);
-		node.process_active (message_a.block);
-		rai::transaction transaction_a (node.store.environment, nullptr, false);
-		if (node.store.block_exists (transaction_a, message_a.block->hash ()))
+		if (message_a.block != nullptr)
 		{
-			confirm_block (transaction_a, node, sender, message_a.block);
+			node.process_active (message_a.block);
+			rai::transaction transaction_a (node.store.environment, nullptr, false);
+			if (node.store.block_exists (transaction_a, message_a.block->hash ()))
+			{
+				confirm_block (transaction_a, node, sender, message_a.block);
+			}
+		}
+		else if (node.config.enable_voting && node.wallets.have_representatives () && !confirm_req_dropped (known))
+		{
+			// A peer asking by hash understands votes by hash, the vote generator answers all of its requests together
+			std::vector<rai::endpoint> endpoints{ sender };
+			rai::transaction transaction_a (node.store.environment, nullptr, false);
+			for (auto & i : message_a.roots_hashes)
+			{
+				if (node.store.block_exists (transaction_a, i.first))
+				{
+					node.vote_generator.add (i.first, endpoints);
+				}
+				else
+				{
+					// We have a different block on this root, send it along with our vote for it
+					rai::block_hash successor (0);
+					rai::account_info info;
+					if (!node.store.account_get (transaction_a, i.second, info))
+					{
+						successor = info.open_block;
+					}
+					else if (node.store.block_exists (transaction_a, i.second))
+					{
+						successor = node.store.block_successor (transaction_a, i.second);
+					}
+					if (!successor.is_zero ())
+					{
+						auto block (node.store.block_get (transaction_a, successor));
+						assert (block != nullptr);
+						rai::publish publish (std::move (block));
+						std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+						{
+							rai::vectorstream stream (*bytes);
+							publish.serialize (stream);
+						}
+						node.network.republish (successor, bytes, sender);
+						node.vote_generator.add (successor, endpoints);
+					}
+				}
+			}
 		}
 	}
+	// Counts and logs by-hash requests we won't answer, true if the request should be dropped
+	bool confirm_req_dropped (bool known_a)
+	{
+		auto result (false);
+		if (!known_a)
+		{
+			++node.network.confirm_req_unknown;
+			result = true;
+		}
+		else if (node.peers.confirm_req_limited (sender))
+		{
+			++node.network.confirm_req_limited;
+			result = true;
+		}
+		if (result && node.config.logging.network_message_logging ())
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Dropping confirm_req by hash from %1%, %2%") % sender % (known_a ? "over rate limit" : "not a known peer"));
+		}
+		return result;
+	}
 	void confirm_ack (rai::confirm_ack const & message_a) override
 	{
 		if (node.config.logging.network_message_logging ())
 		{
-			BOOST_LOG (node.log) << boost::str (boost::format ("Received confirm_ack message from %1% for %2% sequence %3%") % sender % message_a.vote->block->hash ().to_string () % std::to_string (message_a.vote->sequence));
+			BOOST_LOG (node.log) << boost::str (boost::format ("Received confirm_ack message from %1% for %2% sequence %3%") % sender % message_a.vote->hashes_string () % std::to_string (message_a.vote->sequence));
 		}
 		++node.network.incoming.confirm_ack;
 		node.peers.contacted (sender, message_a.version_using);
 		node.peers.insert (sender, message_a.version_using);
-		node.process_active (message_a.vote->block);
+		if (message_a.vote->block != nullptr)
+		{
+			node.process_active (message_a.vote->block);
+		}
 		auto vote (node.vote_processor.vote (message_a.vote, sender));
 		if (vote.code == rai::vote_code::replay)
 		{
 			// This tries to assist rep nodes that have lost track of their highest sequence number by replaying our highest known vote back to them
 			// Only do this if the sequence number is significantly different to account for network reordering
 			// Amplify attack considerations: We're sending out a confirm_ack in response to a confirm_ack for no net traffic increase
-			if (vote.vote->sequence > message_a.vote->sequence + 10000)
+			if (vote.vote->sequence > message_a.vote->sequence + 10000 && (vote.vote->block != nullptr || message_a.version_using >= rai::message::vote_by_hash_version))
 			{
 				rai::confirm_ack confirm (vote.vote);
 				std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
@@ -795,13 +945,22 @@ inactive_supply (0),
 password_fanout (1024),
 io_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
 work_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+wallet_action_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
 enable_voting (true),
 bootstrap_connections (4),
 bootstrap_connections_max (64),
 callback_port (0),
+callback_connections (4),
+callback_queue_max (16 * 1024),
+callback_batch_max (1),
+callback_retries (3),
+callback_timeout (std::chrono::seconds (10)),
 lmdb_max_dbs (128),
 state_block_parse_canary (0),
-state_block_generate_canary (0)
+state_block_generate_canary (0),
+unchecked_max_count (rai::unchecked_index::max_count_default),
+unchecked_cutoff (rai::unchecked_index::cutoff_default),
+sorted_indexes (false)
 {
 	switch (rai::rai_network)
 	{
@@ -835,7 +994,7 @@ state_block_generate_canary (0)
 
 void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) const
 {
-	tree_a.put ("version", "10");
+	tree_a.put ("version", "16");
 	tree_a.put ("peering_port", std::to_string (peering_port));
 	tree_a.put ("bootstrap_fraction_numerator", std::to_string (bootstrap_fraction_numerator));
 	tree_a.put ("receive_minimum", receive_minimum.to_string_dec ());
@@ -870,15 +1029,27 @@ void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) con
 	tree_a.put ("password_fanout", std::to_string (password_fanout));
 	tree_a.put ("io_threads", std::to_string (io_threads));
 	tree_a.put ("work_threads", std::to_string (work_threads));
+	tree_a.put ("wallet_action_threads", std::to_string (wallet_action_threads));
 	tree_a.put ("enable_voting", enable_voting);
 	tree_a.put ("bootstrap_connections", bootstrap_connections);
 	tree_a.put ("bootstrap_connections_max", bootstrap_connections_max);
 	tree_a.put ("callback_address", callback_address);
 	tree_a.put ("callback_port", std::to_string (callback_port));
 	tree_a.put ("callback_target", callback_target);
+	tree_a.put ("callback_connections", std::to_string (callback_connections));
+	tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
+	tree_a.put ("callback_batch_max", std::to_string (callback_batch_max));
+	tree_a.put ("callback_retries", std::to_string (callback_retries));
+	tree_a.put ("callback_timeout", std::to_string (callback_timeout.count ()));
 	tree_a.put ("lmdb_max_dbs", lmdb_max_dbs);
 	tree_a.put ("state_block_parse_canary", state_block_parse_canary.to_string ());
 	tree_a.put ("state_block_generate_canary", state_block_generate_canary.to_string ());
+	tree_a.put ("unchecked_max_count", std::to_string (unchecked_max_count));
+	tree_a.put ("unchecked_cutoff", std::to_string (unchecked_cutoff.count ()));
+	boost::property_tree::ptree lmdb_l;
+	lmdb.serialize_json (lmdb_l);
+	tree_a.add_child ("lmdb", lmdb_l);
+	tree_a.put ("sorted_indexes", sorted_indexes);
 }
 
 bool rai::node_config::upgrade_json (unsigned version, boost::property_tree::ptree & tree_a)
@@ -959,6 +1130,44 @@ bool rai::node_config::upgrade_json (unsigned version, boost::property_tree::ptr
 			tree_a.put ("version", "10");
 			result = true;
 		case 10:
+			tree_a.put ("unchecked_max_count", std::to_string (unchecked_max_count));
+			tree_a.put ("unchecked_cutoff", std::to_string (unchecked_cutoff.count ()));
+			tree_a.erase ("version");
+			tree_a.put ("version", "11");
+			result = true;
+		case 11:
+		{
+			boost::property_tree::ptree lmdb_l;
+			lmdb.serialize_json (lmdb_l);
+			tree_a.add_child ("lmdb", lmdb_l);
+			tree_a.erase ("version");
+			tree_a.put ("version", "12");
+			result = true;
+		}
+		case 12:
+			tree_a.put ("sorted_indexes", sorted_indexes);
+			tree_a.erase ("version");
+			tree_a.put ("version", "13");
+			result = true;
+		case 13:
+			tree_a.put ("callback_connections", std::to_string (callback_connections));
+			tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
+			tree_a.put ("callback_batch_max", std::to_string (callback_batch_max));
+			tree_a.put ("callback_retries", std::to_string (callback_retries));
+			tree_a.erase ("version");
+			tree_a.put ("version", "14");
+			result = true;
+		case 14:
+			tree_a.put ("wallet_action_threads", std::to_string (wallet_action_threads));
+			tree_a.erase ("version");
+			tree_a.put ("version", "15");
+			result = true;
+		case 15:
+			tree_a.put ("callback_timeout", std::to_string (callback_timeout.count ()));
+			tree_a.erase ("version");
+			tree_a.put ("version", "16");
+			result = true;
+		case 16:
 			break;
 		default:
 			throw std::runtime_error ("Unknown node_config version");
@@ -1024,16 +1233,26 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 		auto password_fanout_l (tree_a.get<std::string> ("password_fanout"));
 		auto io_threads_l (tree_a.get<std::string> ("io_threads"));
 		auto work_threads_l (tree_a.get<std::string> ("work_threads"));
+		auto wallet_action_threads_l (tree_a.get<std::string> ("wallet_action_threads"));
 		enable_voting = tree_a.get<bool> ("enable_voting");
 		auto bootstrap_connections_l (tree_a.get<std::string> ("bootstrap_connections"));
 		auto bootstrap_connections_max_l (tree_a.get<std::string> ("bootstrap_connections_max"));
 		callback_address = tree_a.get<std::string> ("callback_address");
 		auto callback_port_l (tree_a.get<std::string> ("callback_port"));
 		callback_target = tree_a.get<std::string> ("callback_target");
+		auto callback_connections_l (tree_a.get<std::string> ("callback_connections"));
+		auto callback_queue_max_l (tree_a.get<std::string> ("callback_queue_max"));
+		auto callback_batch_max_l (tree_a.get<std::string> ("callback_batch_max"));
+		auto callback_retries_l (tree_a.get<std::string> ("callback_retries"));
+		auto callback_timeout_l (tree_a.get<std::string> ("callback_timeout"));
 		auto lmdb_max_dbs_l = tree_a.get<std::string> ("lmdb_max_dbs");
 		result |= parse_port (callback_port_l, callback_port);
 		auto state_block_parse_canary_l = tree_a.get<std::string> ("state_block_parse_canary");
 		auto state_block_generate_canary_l = tree_a.get<std::string> ("state_block_generate_canary");
+		auto unchecked_max_count_l (tree_a.get<std::string> ("unchecked_max_count"));
+		auto unchecked_cutoff_l (tree_a.get<std::string> ("unchecked_cutoff"));
+		auto & lmdb_l (tree_a.get_child ("lmdb"));
+		sorted_indexes = tree_a.get<bool> ("sorted_indexes");
 		try
 		{
 			peering_port = std::stoul (peering_port_l);
@@ -1041,9 +1260,17 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			password_fanout = std::stoul (password_fanout_l);
 			io_threads = std::stoul (io_threads_l);
 			work_threads = std::stoul (work_threads_l);
+			wallet_action_threads = std::stoul (wallet_action_threads_l);
 			bootstrap_connections = std::stoul (bootstrap_connections_l);
 			bootstrap_connections_max = std::stoul (bootstrap_connections_max_l);
+			callback_connections = std::stoul (callback_connections_l);
+			callback_queue_max = std::stoull (callback_queue_max_l);
+			callback_batch_max = std::stoull (callback_batch_max_l);
+			callback_retries = std::stoul (callback_retries_l);
+			callback_timeout = std::chrono::seconds (std::stoull (callback_timeout_l));
 			lmdb_max_dbs = std::stoi (lmdb_max_dbs_l);
+			unchecked_max_count = std::stoull (unchecked_max_count_l);
+			unchecked_cutoff = std::chrono::seconds (std::stoull (unchecked_cutoff_l));
 			result |= peering_port > std::numeric_limits<uint16_t>::max ();
 			result |= logging.deserialize_json (upgraded_a, logging_l);
 			result |= receive_minimum.decode_dec (receive_minimum_l);
@@ -1052,8 +1279,15 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			result |= password_fanout > 1024 * 1024;
 			result |= io_threads == 0;
 			result |= work_threads == 0;
+			result |= wallet_action_threads == 0;
 			result |= state_block_parse_canary.decode_hex (state_block_parse_canary_l);
 			result |= state_block_generate_canary.decode_hex (state_block_generate_canary_l);
+			result |= unchecked_max_count == 0;
+			result |= callback_connections == 0;
+			result |= callback_queue_max == 0;
+			result |= callback_batch_max == 0;
+			result |= callback_timeout.count () == 0;
+			result |= lmdb.deserialize_json (lmdb_l);
 		}
 		catch (std::logic_error const &)
 		{
@@ -1086,11 +1320,7 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 	if (!rai::validate_message (vote_a->account, vote_a->hash (), vote_a->signature))
 	{
 		result.code = rai::vote_code::replay;
-		std::shared_ptr<rai::vote> newest_vote;
-		{
-			rai::transaction transaction (node.store.environment, nullptr, false);
-			newest_vote = node.store.vote_max (transaction, vote_a);
-		}
+		auto newest_vote (node.store.votes.max (vote_a));
 		if (!node.active.vote (vote_a))
 		{
 			result.code = rai::vote_code::vote;
@@ -1115,7 +1345,7 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 				status = "Vote";
 				break;
 		}
-		BOOST_LOG (node.log) << boost::str (boost::format ("Vote from: %1% sequence: %2% block: %3% status: %4%") % vote_a->account.to_account () % std::to_string (vote_a->sequence) % vote_a->block->hash ().to_string () % status);
+		BOOST_LOG (node.log) << boost::str (boost::format ("Vote from: %1% sequence: %2% block(s): %3% status: %4%") % vote_a->account.to_account () % std::to_string (vote_a->sequence) % vote_a->hashes_string () % status);
 	}
 	switch (result.code)
 	{
@@ -1128,6 +1358,180 @@ rai::vote_result rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, r
 	return result;
 }
 
+rai::vote_generator::vote_generator (rai::node & node_a) :
+node (node_a),
+stopped (false),
+generated (0),
+bundled (0),
+thread ([this]() { run (); })
+{
+}
+
+void rai::vote_generator::add (rai::block_hash const & hash_a, std::vector<rai::endpoint> const & endpoints_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		hashes.push_back (std::make_pair (hash_a, endpoints_a));
+		condition.notify_all ();
+	}
+}
+
+void rai::vote_generator::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		hashes.clear ();
+		condition.notify_all ();
+	}
+	if (thread.joinable ())
+	{
+		thread.join ();
+	}
+}
+
+void rai::vote_generator::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (hashes.size () < rai::vote::max_hashes)
+		{
+			if (hashes.empty ())
+			{
+				condition.wait (lock);
+			}
+			else
+			{
+				// Give a partial bundle a moment to fill up before signing it
+				condition.wait_for (lock, wait, [this]() { return stopped || hashes.size () >= rai::vote::max_hashes; });
+				if (!stopped && !hashes.empty ())
+				{
+					send (lock);
+				}
+			}
+		}
+		else
+		{
+			send (lock);
+		}
+	}
+}
+
+void rai::vote_generator::send (std::unique_lock<std::mutex> & lock_a)
+{
+	std::vector<rai::block_hash> hashes_l;
+	std::unordered_set<rai::endpoint> endpoints;
+	while (!hashes.empty () && hashes_l.size () < rai::vote::max_hashes)
+	{
+		auto & front (hashes.front ());
+		if (std::find (hashes_l.begin (), hashes_l.end (), front.first) == hashes_l.end ())
+		{
+			hashes_l.push_back (front.first);
+		}
+		endpoints.insert (front.second.begin (), front.second.end ());
+		hashes.pop_front ();
+	}
+	lock_a.unlock ();
+	uint64_t generated_l (0);
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		node.wallets.foreach_representative (transaction, [this, &hashes_l, &endpoints, &generated_l](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
+			auto vote (this->node.store.votes.generate (pub_a, prv_a, hashes_l));
+			rai::confirm_ack confirm (vote);
+			std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+			{
+				rai::vectorstream stream (*bytes);
+				confirm.serialize (stream);
+			}
+			for (auto & i : endpoints)
+			{
+				this->node.network.confirm_send (confirm, bytes, i);
+			}
+			++generated_l;
+		});
+	}
+	lock_a.lock ();
+	generated += generated_l;
+	bundled += generated_l * hashes_l.size ();
+}
+
+rai::request_aggregator::request_aggregator (rai::node & node_a) :
+node (node_a),
+scheduled (false),
+stopped (false),
+requested (0),
+messages (0)
+{
+}
+
+void rai::request_aggregator::add (rai::endpoint const & endpoint_a, std::shared_ptr<rai::block> block_a)
+{
+	std::vector<std::pair<rai::block_hash, rai::block_hash>> full;
+	auto schedule (false);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (!stopped)
+		{
+			auto & pending (requests[endpoint_a]);
+			auto request (std::make_pair (block_a->hash (), block_a->root ()));
+			if (std::find (pending.begin (), pending.end (), request) == pending.end ())
+			{
+				++requested;
+				pending.push_back (request);
+				if (pending.size () >= rai::confirm_req::roots_hashes_max)
+				{
+					full.swap (pending);
+					requests.erase (endpoint_a);
+					++messages;
+				}
+				else if (!scheduled)
+				{
+					scheduled = true;
+					schedule = true;
+				}
+			}
+		}
+	}
+	if (!full.empty ())
+	{
+		node.network.send_confirm_req (endpoint_a, full);
+	}
+	if (schedule)
+	{
+		std::weak_ptr<rai::node> node_w (node.shared ());
+		node.alarm.add (std::chrono::steady_clock::now () + window, [node_w]() {
+			if (auto node_l = node_w.lock ())
+			{
+				node_l->request_aggregator.flush ();
+			}
+		});
+	}
+}
+
+void rai::request_aggregator::flush ()
+{
+	std::unordered_map<rai::endpoint, std::vector<std::pair<rai::block_hash, rai::block_hash>>> requests_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		requests_l.swap (requests);
+		scheduled = false;
+		messages += requests_l.size ();
+	}
+	for (auto & i : requests_l)
+	{
+		node.network.send_confirm_req (i.first, i.second);
+	}
+}
+
+void rai::request_aggregator::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	requests.clear ();
+}
+
 void rai::rep_crawler::add (rai::block_hash const & hash_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
@@ -1152,12 +1556,225 @@ block_processor_item (block_a, false)
 }
 
 rai::block_processor_item::block_processor_item (std::shared_ptr<rai::block> block_a, bool force_a) :
+block_processor_item (block_a, force_a, false)
+{
+}
+
+rai::block_processor_item::block_processor_item (std::shared_ptr<rai::block> block_a, bool force_a, bool verified_a) :
 block (block_a),
-force (force_a)
+force (force_a),
+verified (verified_a)
+{
+}
+
+rai::unchecked_drainer::unchecked_drainer (rai::node & node_a) :
+node (node_a),
+batches (0),
+collected (0),
+verified (0),
+unverified (0),
+rejected (0),
+entries (nullptr),
+next (0),
+chunk (0),
+remaining (0),
+stopped (false)
+{
+	// The block processor thread verifies alongside these
+	auto count (std::max<unsigned> (std::thread::hardware_concurrency (), 1) - 1);
+	for (auto i (0u); i < count; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+rai::unchecked_drainer::~unchecked_drainer ()
+{
+	stop ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
+}
+
+void rai::unchecked_drainer::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	condition.notify_all ();
+}
+
+void rai::unchecked_drainer::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!verify_chunk (lock))
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+constexpr size_t rai::unchecked_drainer::batch_max;
+constexpr size_t rai::unchecked_drainer::parallel_min;
+
+void rai::unchecked_drainer::drain (MDB_txn * transaction_a, rai::block_hash const & hash_a, std::vector<rai::unchecked_drainer_entry> & entries_a)
+{
+	// Breadth first walk, a block is only reachable from the dependency it's waiting on so each level only depends on earlier levels
+	std::deque<std::pair<rai::block_hash, size_t>> dependencies;
+	auto const root (std::numeric_limits<size_t>::max ());
+	dependencies.push_back (std::make_pair (hash_a, root));
+	auto limit (entries_a.size () + batch_max);
+	while (!dependencies.empty () && entries_a.size () < limit)
+	{
+		auto dependency (dependencies.front ());
+		dependencies.pop_front ();
+		auto cached (node.store.unchecked_get (transaction_a, dependency.first));
+		for (auto & block : cached)
+		{
+			node.store.unchecked_del (transaction_a, dependency.first, *block);
+			auto parent (dependency.second != root ? &entries_a[dependency.second] : nullptr);
+			rai::unchecked_drainer_entry entry;
+			entry.block = block;
+			entry.account = signer (transaction_a, *block, parent);
+			entry.level = parent != nullptr ? parent->level + 1 : 0;
+			entry.parent = dependency.second;
+			entry.work_valid = false;
+			entry.signature_valid = false;
+			entry.rejected = false;
+			dependencies.push_back (std::make_pair (block->hash (), entries_a.size ()));
+			entries_a.push_back (entry);
+		}
+	}
+}
+
+void rai::unchecked_drainer::queue (std::vector<rai::unchecked_drainer_entry> & entries_a, std::deque<rai::block_processor_item> & blocks_a)
+{
+	if (!entries_a.empty ())
+	{
+		auto const root (std::numeric_limits<size_t>::max ());
+		verify (entries_a);
+		// Parents come before their dependents, a rejected block takes everything drained behind it along
+		for (auto & i : entries_a)
+		{
+			i.rejected = !i.work_valid || !(i.signature_valid || i.account.is_zero ()) || (i.parent != root && entries_a[i.parent].rejected);
+		}
+		// Topological batches, within a level blocks of the same account chain are kept together
+		std::stable_sort (entries_a.begin (), entries_a.end (), [](rai::unchecked_drainer_entry const & lhs, rai::unchecked_drainer_entry const & rhs) {
+			return lhs.level < rhs.level || (lhs.level == rhs.level && lhs.account < rhs.account);
+		});
+		size_t verified_l (0);
+		size_t rejected_l (0);
+		for (auto i (entries_a.rbegin ()), n (entries_a.rend ()); i != n; ++i)
+		{
+			if (!i->rejected)
+			{
+				verified_l += i->signature_valid ? 1 : 0;
+				blocks_a.push_front (rai::block_processor_item (i->block, false, i->signature_valid));
+			}
+			else
+			{
+				++rejected_l;
+				if (node.config.logging.ledger_logging ())
+				{
+					BOOST_LOG (node.log) << boost::str (boost::format ("Dropping unchecked block %1% with invalid %2%") % i->block->hash ().to_string () % (!i->work_valid ? "work" : !(i->signature_valid || i->account.is_zero ()) ? "signature" : "dependency"));
+				}
+			}
+		}
+		++batches;
+		collected += entries_a.size ();
+		verified += verified_l;
+		unverified += entries_a.size () - verified_l - rejected_l;
+		rejected += rejected_l;
+		if (entries_a.size () >= parallel_min && node.config.logging.ledger_logging ())
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("Drained %1% unchecked blocks, %2% rejected") % entries_a.size () % rejected_l);
+		}
+		entries_a.clear ();
+	}
+}
+
+rai::account rai::unchecked_drainer::signer (MDB_txn * transaction_a, rai::block const & block_a, rai::unchecked_drainer_entry const * parent_a)
+{
+	rai::account result (0);
+	switch (block_a.type ())
+	{
+		case rai::block_type::open:
+			result = static_cast<rai::open_block const &> (block_a).hashables.account;
+			break;
+		case rai::block_type::state:
+			result = static_cast<rai::state_block const &> (block_a).hashables.account;
+			break;
+		default:
+		{
+			// Legacy blocks are signed by the owner of their predecessor, which is either drained along with them or the current frontier
+			auto previous (block_a.previous ());
+			if (parent_a != nullptr && parent_a->block->hash () == previous)
+			{
+				result = parent_a->account;
+			}
+			else
+			{
+				result = node.store.frontier_get (transaction_a, previous);
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+void rai::unchecked_drainer::verify (std::vector<rai::unchecked_drainer_entry> & entries_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	assert (entries == nullptr);
+	entries = &entries_a;
+	next = 0;
+	chunk = threads.empty () || entries_a.size () < parallel_min ? entries_a.size () : std::max ((entries_a.size () + threads.size ()) / (threads.size () + 1), parallel_min);
+	remaining = (entries_a.size () + chunk - 1) / chunk;
+	condition.notify_all ();
+	while (verify_chunk (lock))
+	{
+	}
+	while (remaining > 0)
+	{
+		condition.wait (lock);
+	}
+	entries = nullptr;
+}
+
+bool rai::unchecked_drainer::verify_chunk (std::unique_lock<std::mutex> & lock_a)
 {
+	auto result (entries != nullptr && next < entries->size ());
+	if (result)
+	{
+		auto & entries_l (*entries);
+		auto begin (next);
+		auto end (std::min (begin + chunk, entries_l.size ()));
+		next = end;
+		lock_a.unlock ();
+		for (auto i (begin); i < end; ++i)
+		{
+			auto & entry (entries_l[i]);
+			entry.work_valid = !rai::work_validate (*entry.block);
+			if (entry.work_valid && !entry.account.is_zero ())
+			{
+				entry.signature_valid = !rai::validate_message (entry.account, entry.block->hash (), entry.block->block_signature ());
+			}
+		}
+		lock_a.lock ();
+		--remaining;
+		if (remaining == 0)
+		{
+			condition.notify_all ();
+		}
+	}
+	return result;
 }
 
 rai::block_processor::block_processor (rai::node & node_a) :
+drainer (node_a),
+batches (0),
 stopped (false),
 idle (true),
 node (node_a)
@@ -1173,23 +1790,77 @@ void rai::block_processor::stop ()
 {
 	std::lock_guard<std::mutex> lock (mutex);
 	stopped = true;
+	drainer.stop ();
+	// Breaks the promises of anyone still waiting
+	forced.clear ();
+	local.clear ();
+	blocks.clear ();
 	condition.notify_all ();
 }
 
 void rai::block_processor::flush ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
-	while (!stopped && (!blocks.empty () || !idle))
+	while (!stopped && (!forced.empty () || !local.empty () || !blocks.empty () || !idle))
 	{
 		condition.wait (lock);
 	}
 }
 
+size_t rai::block_processor::size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return forced.size () + local.size () + blocks.size ();
+}
+
 void rai::block_processor::add (rai::block_processor_item const & item_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
-	blocks.push_back (item_a);
-	condition.notify_all ();
+	if (!stopped)
+	{
+		blocks.push_back (item_a);
+		condition.notify_all ();
+	}
+}
+
+std::future<rai::process_return> rai::block_processor::add (rai::block_processor_item const & item_a, rai::block_priority priority_a)
+{
+	auto item (item_a);
+	item.promise = std::make_shared<std::promise<rai::process_return>> ();
+	auto result (item.promise->get_future ());
+	std::lock_guard<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		switch (priority_a)
+		{
+			case rai::block_priority::forced:
+				forced.push_back (item);
+				break;
+			case rai::block_priority::local:
+				local.push_back (item);
+				break;
+			case rai::block_priority::network:
+				blocks.push_back (item);
+				break;
+		}
+		condition.notify_all ();
+	}
+	return result;
+}
+
+bool rai::block_processor::process_one (rai::block_processor_item const & item_a, rai::process_return & result_a, rai::block_priority priority_a)
+{
+	auto future (add (item_a, priority_a));
+	auto result (false);
+	try
+	{
+		result_a = future.get ();
+	}
+	catch (std::future_error const &)
+	{
+		result = true;
+	}
+	return result;
 }
 
 void rai::block_processor::process_blocks ()
@@ -1197,12 +1868,18 @@ void rai::block_processor::process_blocks ()
 	std::unique_lock<std::mutex> lock (mutex);
 	while (!stopped)
 	{
-		if (!blocks.empty ())
+		if (!forced.empty () || !local.empty () || !blocks.empty ())
 		{
 			std::deque<rai::block_processor_item> blocks_processing;
-			std::swap (blocks, blocks_processing);
+			std::swap (forced, blocks_processing);
+			blocks_processing.insert (blocks_processing.end (), local.begin (), local.end ());
+			local.clear ();
+			auto count (std::min (blocks.size (), network_batch_max));
+			blocks_processing.insert (blocks_processing.end (), blocks.begin (), blocks.begin () + count);
+			blocks.erase (blocks.begin (), blocks.begin () + count);
 			lock.unlock ();
 			process_receive_many (blocks_processing);
+			++batches;
 			// Let other threads get an opportunity to transaction lock
 			std::this_thread::yield ();
 			lock.lock ();
@@ -1217,23 +1894,26 @@ void rai::block_processor::process_blocks ()
 	}
 }
 
-void rai::block_processor::process_receive_many (rai::block_processor_item const & item_a)
-{
-	std::deque<rai::block_processor_item> blocks_processing;
-	blocks_processing.push_back (item_a);
-	process_receive_many (blocks_processing);
-}
-
 void rai::block_processor::process_receive_many (std::deque<rai::block_processor_item> & blocks_processing)
 {
 	while (!blocks_processing.empty ())
 	{
 		std::deque<std::pair<std::shared_ptr<rai::block>, rai::process_return>> progress;
+		std::vector<std::pair<std::shared_ptr<std::promise<rai::process_return>>, rai::process_return>> completed;
+		std::vector<rai::unchecked_drainer_entry> drained;
 		{
 			rai::transaction transaction (node.store.environment, nullptr, true);
 			auto cutoff (std::chrono::steady_clock::now () + rai::transaction_timeout);
 			while (!blocks_processing.empty () && std::chrono::steady_clock::now () < cutoff)
 			{
+				{
+					// Forced and local blocks queued during a network batch go ahead of the rest of it so their waiters aren't held up
+					std::lock_guard<std::mutex> lock (mutex);
+					blocks_processing.insert (blocks_processing.begin (), local.begin (), local.end ());
+					local.clear ();
+					blocks_processing.insert (blocks_processing.begin (), forced.begin (), forced.end ());
+					forced.clear ();
+				}
 				auto item (blocks_processing.front ());
 				blocks_processing.pop_front ();
 				auto hash (item.block->hash ());
@@ -1247,7 +1927,11 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 						node.ledger.rollback (transaction, successor->hash ());
 					}
 				}
-				auto process_result (process_receive_one (transaction, item.block));
+				auto process_result (process_receive_one (transaction, item.block, item.verified));
+				if (item.promise != nullptr)
+				{
+					completed.push_back (std::make_pair (item.promise, process_result));
+				}
 				switch (process_result.code)
 				{
 					case rai::process_result::progress:
@@ -1256,12 +1940,7 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 					}
 					case rai::process_result::old:
 					{
-						auto cached (node.store.unchecked_get (transaction, hash));
-						for (auto i (cached.begin ()), n (cached.end ()); i != n; ++i)
-						{
-							node.store.unchecked_del (transaction, hash, **i);
-							blocks_processing.push_front (rai::block_processor_item (*i));
-						}
+						drainer.drain (transaction, hash, drained);
 						std::lock_guard<std::mutex> lock (node.gap_cache.mutex);
 						node.gap_cache.blocks.get<1> ().erase (hash);
 						break;
@@ -1283,13 +1962,20 @@ void rai::block_processor::process_receive_many (std::deque<rai::block_processor
 				}
 			}
 		}
+		// Waiters resume once the blocks are committed and observed
+		for (auto & i : completed)
+		{
+			i.first->set_value (i.second);
+		}
+		// Signature checks don't hold the write transaction, the dependents are processed in the next one
+		drainer.queue (drained, blocks_processing);
 	}
 }
 
-rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a)
+rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a, bool verified_a)
 {
 	rai::process_return result;
-	result = node.ledger.process (transaction_a, *block_a);
+	result = node.ledger.process (transaction_a, *block_a, verified_a);
 	switch (result.code)
 	{
 		case rai::process_result::progress:
@@ -1379,6 +2065,7 @@ rai::process_return rai::block_processor::process_receive_one (MDB_txn * transac
 				// Only let the bootstrap attempt know about forked blocks that did not arrive via UDP.
 				node.bootstrap_initiator.process_fork (transaction_a, block_a);
 			}
+			node.active.publish (block_a);
 			if (node.config.logging.ledger_logging ())
 			{
 				BOOST_LOG (node.log) << boost::str (boost::format ("Fork for: %1% root: %2%") % block_a->hash ().to_string () % block_a->root ().to_string ());
@@ -1428,7 +2115,7 @@ service (service_a),
 config (config_a),
 alarm (alarm_a),
 work (work_a),
-store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs),
+store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs, config_a.lmdb, config_a.sorted_indexes),
 gap_cache (*this),
 ledger (store, config_a.inactive_supply.number (), config.state_block_parse_canary, config.state_block_generate_canary),
 active (*this),
@@ -1442,8 +2129,16 @@ port_mapping (*this),
 vote_processor (*this),
 warmed_up (0),
 block_processor (*this),
-block_processor_thread ([this]() { this->block_processor.process_blocks (); })
+block_processor_thread ([this]() { this->block_processor.process_blocks (); }),
+callback (*this),
+vote_generator (*this),
+request_aggregator (*this)
 {
+	{
+		std::lock_guard<std::mutex> lock (store.cache_mutex);
+		store.unchecked_index.max_count = config.unchecked_max_count;
+		store.unchecked_index.cutoff = config.unchecked_cutoff;
+	}
 	wallets.observer = [this](bool active) {
 		observers.wallet (active);
 	};
@@ -1481,89 +2176,32 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 					std::stringstream ostream;
 					boost::property_tree::write_json (ostream, event);
 					ostream.flush ();
-					auto body (std::make_shared<std::string> (ostream.str ()));
-					auto address (node_l->config.callback_address);
-					auto port (node_l->config.callback_port);
-					auto target (std::make_shared<std::string> (node_l->config.callback_target));
-					auto resolver (std::make_shared<boost::asio::ip::tcp::resolver> (node_l->service));
-					resolver->async_resolve (boost::asio::ip::tcp::resolver::query (address, std::to_string (port)), [node_l, address, port, target, body, resolver](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
-						if (!ec)
-						{
-							for (auto i (i_a), n (boost::asio::ip::tcp::resolver::iterator{}); i != n; ++i)
-							{
-								auto sock (std::make_shared<boost::asio::ip::tcp::socket> (node_l->service));
-								sock->async_connect (i->endpoint (), [node_l, target, body, sock, address, port](boost::system::error_code const & ec) {
-									if (!ec)
-									{
-										auto req (std::make_shared<boost::beast::http::request<boost::beast::http::string_body>> ());
-										req->method (boost::beast::http::verb::post);
-										req->target (*target);
-										req->version (11);
-										req->insert (boost::beast::http::field::host, address);
-										req->insert (boost::beast::http::field::content_type, "application/json");
-										req->body () = *body;
-										//req->prepare (*req);
-										//boost::beast::http::prepare(req);
-										req->prepare_payload ();
-										boost::beast::http::async_write (*sock, *req, [node_l, sock, address, port, req](boost::system::error_code const & ec, size_t bytes_transferred) {
-											if (!ec)
-											{
-												auto sb (std::make_shared<boost::beast::flat_buffer> ());
-												auto resp (std::make_shared<boost::beast::http::response<boost::beast::http::string_body>> ());
-												boost::beast::http::async_read (*sock, *sb, *resp, [node_l, sb, resp, sock, address, port](boost::system::error_code const & ec, size_t bytes_transferred) {
-													if (!ec)
-													{
-														if (resp->result () == boost::beast::http::status::ok)
-														{
-														}
-														else
-														{
-															if (node_l->config.logging.callback_logging ())
-															{
-																BOOST_LOG (node_l->log) << boost::str (boost::format ("Callback to %1%:%2% failed with status: %3%") % address % port % resp->result ());
-															}
-														}
-													}
-													else
-													{
-														if (node_l->config.logging.callback_logging ())
-														{
-															BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable complete callback: %1%:%2% %3%") % address % port % ec.message ());
-														}
-													};
-												});
-											}
-											else
-											{
-												if (node_l->config.logging.callback_logging ())
-												{
-													BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to send callback: %1%:%2% %3%") % address % port % ec.message ());
-												}
-											}
-										});
-									}
-									else
-									{
-										if (node_l->config.logging.callback_logging ())
-										{
-											BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to connect to callback address: %1%:%2%, %3%") % address % port % ec.message ());
-										}
-									}
-								});
-							}
-						}
-						else
-						{
-							if (node_l->config.logging.callback_logging ())
-							{
-								BOOST_LOG (node_l->log) << boost::str (boost::format ("Error resolving callback: %1%:%2%, %3%") % address % port % ec.message ());
-							}
-						}
-					});
+					if (node_l->callback.add (ostream.str ()) && node_l->config.logging.callback_logging ())
+					{
+						BOOST_LOG (node_l->log) << boost::str (boost::format ("Callback queue to %1%:%2% is full, dropping event") % node_l->config.callback_address % node_l->config.callback_port);
+					}
 				}
 			});
 		}
 	});
+	// Work for wallet accounts is regenerated as soon as their root moves so sending doesn't wait on it
+	observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::process_return const & result_a) {
+		this->wallets.work_precache (result_a.account);
+	});
+	// A wallet account becomes a voting representative once a block delegates weight to it
+	observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::process_return const & result_a) {
+		auto representative (block_a->representative ());
+		if (!representative.is_zero ())
+		{
+			this->wallets.representative_update (representative);
+		}
+	});
+	observers.account_balance.add ([this](rai::account const & account_a, bool is_pending) {
+		if (is_pending)
+		{
+			this->wallets.work_precache (account_a);
+		}
+	});
 	observers.endpoint.add ([this](rai::endpoint const & endpoint_a) {
 		this->network.send_keepalive (endpoint_a);
 		rep_query (*this, endpoint_a);
@@ -1572,7 +2210,8 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 		this->gap_cache.vote (vote_a);
 	});
 	observers.vote.add ([this](std::shared_ptr<rai::vote> vote_a, rai::endpoint const & endpoint_a) {
-		if (this->rep_crawler.exists (vote_a->block->hash ()))
+		auto hashes (vote_a->block_hashes ());
+		if (std::any_of (hashes.begin (), hashes.end (), [this](rai::block_hash const & hash_a) { return this->rep_crawler.exists (hash_a); }))
 		{
 			auto weight_l (weight (vote_a->account));
 			// We see a valid non-replay vote for a block we requested, this node is probably a representative
@@ -1585,7 +2224,7 @@ block_processor_thread ([this]() { this->block_processor.process_blocks (); })
 				{
 					if (*i != nullptr)
 					{
-						this->network.send_confirm_req (endpoint_a, *i);
+						this->network.request_confirmation (endpoint_a, *i);
 					}
 				}
 			}
@@ -1684,7 +2323,7 @@ void rai::gap_cache::add (MDB_txn * transaction_a, std::shared_ptr<rai::block> b
 	}
 	else
 	{
-		blocks.insert ({ std::chrono::steady_clock::now (), hash, std::unique_ptr<rai::votes> (new rai::votes (block_a)) });
+		blocks.insert ({ std::chrono::steady_clock::now (), hash, block_a, std::unique_ptr<rai::votes> (new rai::votes (block_a)) });
 		if (blocks.size () > max)
 		{
 			blocks.get<0> ().erase (blocks.get<0> ().begin ());
@@ -1696,27 +2335,29 @@ void rai::gap_cache::vote (std::shared_ptr<rai::vote> vote_a)
 {
 	rai::transaction transaction (node.store.environment, nullptr, false);
 	std::lock_guard<std::mutex> lock (mutex);
-	auto hash (vote_a->block->hash ());
-	auto existing (blocks.get<1> ().find (hash));
-	if (existing != blocks.get<1> ().end ())
+	for (auto & hash : vote_a->block_hashes ())
 	{
-		existing->votes->vote (vote_a);
-		auto winner (node.ledger.winner (transaction, *existing->votes));
-		if (winner.first > bootstrap_threshold (transaction))
+		auto existing (blocks.get<1> ().find (hash));
+		if (existing != blocks.get<1> ().end ())
 		{
-			auto node_l (node.shared ());
-			auto now (std::chrono::steady_clock::now ());
-			node.alarm.add (rai::rai_network == rai::rai_networks::rai_test_network ? now + std::chrono::milliseconds (5) : now + std::chrono::seconds (5), [node_l, hash]() {
-				rai::transaction transaction (node_l->store.environment, nullptr, false);
-				if (!node_l->store.block_exists (transaction, hash))
-				{
-					if (!node_l->bootstrap_initiator.in_progress ())
+			existing->votes->vote (vote_a->account, existing->block);
+			auto winner (node.ledger.winner (transaction, *existing->votes));
+			if (winner.first > bootstrap_threshold (transaction))
+			{
+				auto node_l (node.shared ());
+				auto now (std::chrono::steady_clock::now ());
+				node.alarm.add (rai::rai_network == rai::rai_networks::rai_test_network ? now + std::chrono::milliseconds (5) : now + std::chrono::seconds (5), [node_l, hash]() {
+					rai::transaction transaction (node_l->store.environment, nullptr, false);
+					if (!node_l->store.block_exists (transaction, hash))
 					{
-						BOOST_LOG (node_l->log) << boost::str (boost::format ("Missing confirmed block %1%") % hash.to_string ());
+						if (!node_l->bootstrap_initiator.in_progress ())
+						{
+							BOOST_LOG (node_l->log) << boost::str (boost::format ("Missing confirmed block %1%") % hash.to_string ());
+						}
+						node_l->bootstrap_initiator.bootstrap ();
 					}
-					node_l->bootstrap_initiator.bootstrap ();
-				}
-			});
+				});
+			}
 		}
 	}
 }
@@ -1750,7 +2391,7 @@ void rai::network::confirm_send (rai::confirm_ack const & confirm_a, std::shared
 {
 	if (node.config.logging.network_publish_logging ())
 	{
-		BOOST_LOG (node.log) << boost::str (boost::format ("Sending confirm_ack for block %1% to %2% sequence %3%") % confirm_a.vote->block->hash ().to_string () % endpoint_a % std::to_string (confirm_a.vote->sequence));
+		BOOST_LOG (node.log) << boost::str (boost::format ("Sending confirm_ack for block(s) %1% to %2% sequence %3%") % confirm_a.vote->hashes_string () % endpoint_a % std::to_string (confirm_a.vote->sequence));
 	}
 	std::weak_ptr<rai::node> node_w (node.shared ());
 	++outgoing.confirm_ack;
@@ -1773,8 +2414,21 @@ void rai::node::process_active (std::shared_ptr<rai::block> incoming)
 
 rai::process_return rai::node::process (rai::block const & block_a)
 {
-	rai::transaction transaction (store.environment, nullptr, true);
-	auto result (ledger.process (transaction, block_a));
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		rai::serialize_block (stream, block_a);
+	}
+	rai::bufferstream stream (bytes.data (), bytes.size ());
+	std::shared_ptr<rai::block> block (rai::deserialize_block (stream));
+	assert (block != nullptr);
+	rai::process_return result;
+	if (block_processor.process_one (rai::block_processor_item (block), result, rai::block_priority::forced))
+	{
+		// The processor has stopped so nothing else is writing to the ledger
+		rai::transaction transaction (store.environment, nullptr, true);
+		result = ledger.process (transaction, block_a);
+	}
 	return result;
 }
 
@@ -1815,6 +2469,13 @@ std::map<rai::endpoint, unsigned> rai::peer_container::list_version ()
 	return result;
 }
 
+unsigned rai::peer_container::version (rai::endpoint const & endpoint_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (peers.find (endpoint_a));
+	return existing != peers.end () ? existing->network_version : 0;
+}
+
 rai::endpoint rai::peer_container::bootstrap_peer ()
 {
 	rai::endpoint result (boost::asio::ip::address_v6::any (), 0);
@@ -1919,10 +2580,11 @@ void rai::node::start ()
 	ongoing_keepalive ();
 	ongoing_bootstrap ();
 	ongoing_store_flush ();
+	ongoing_store_sync ();
 	ongoing_rep_crawl ();
 	bootstrap.start ();
 	backup_wallet ();
-	active.announce_votes ();
+	active.announce_start ();
 	port_mapping.start ();
 	add_initial_peers ();
 	observers.started ();
@@ -1942,6 +2604,10 @@ void rai::node::stop ()
 	bootstrap.stop ();
 	port_mapping.stop ();
 	wallets.stop ();
+	callback.stop ();
+	vote_generator.stop ();
+	request_aggregator.stop ();
+	store.votes.flush ();
 	if (block_processor_thread.joinable ())
 	{
 		block_processor_thread.join ();
@@ -2063,6 +2729,10 @@ void rai::node::ongoing_store_flush ()
 		rai::transaction transaction (store.environment, nullptr, true);
 		store.flush (transaction);
 	}
+	if (store.votes.flush ())
+	{
+		BOOST_LOG (log) << "Unable to write the vote log";
+	}
 	std::weak_ptr<rai::node> node_w (shared_from_this ());
 	alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [node_w]() {
 		if (auto node_l = node_w.lock ())
@@ -2072,6 +2742,27 @@ void rai::node::ongoing_store_flush ()
 	});
 }
 
+void rai::node::ongoing_store_sync ()
+{
+	if (config.lmdb.deferred_sync () && config.lmdb.sync_interval.count () > 0)
+	{
+		std::weak_ptr<rai::node> node_w (shared_from_this ());
+		alarm.add (std::chrono::steady_clock::now () + config.lmdb.sync_interval, [node_w]() {
+			if (auto node_l = node_w.lock ())
+			{
+				node_l->background ([node_l]() {
+					auto status (mdb_env_sync (node_l->store.environment, 1));
+					if (status != 0)
+					{
+						BOOST_LOG (node_l->log) << boost::str (boost::format ("Error syncing ledger: %1%") % mdb_strerror (status));
+					}
+					node_l->ongoing_store_sync ();
+				});
+			}
+		});
+	}
+}
+
 void rai::node::backup_wallet ()
 {
 	rai::transaction transaction (store.environment, nullptr, false);
@@ -2403,6 +3094,7 @@ void rai::node::process_confirmed (std::shared_ptr<rai::block> confirmed_a)
 {
 	confirmed_visitor visitor (*this, confirmed_a);
 	confirmed_a->visit (visitor);
+	observers.confirmed (confirmed_a);
 }
 
 void rai::node::process_message (rai::message & message_a, rai::endpoint const & sender_a)
@@ -2602,6 +3294,30 @@ void rai::peer_container::rep_request (rai::endpoint const & endpoint_a)
 	}
 }
 
+bool rai::peer_container::confirm_req_limited (rai::endpoint const & endpoint_a)
+{
+	auto result (true);
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (peers.find (endpoint_a));
+	if (existing != peers.end ())
+	{
+		auto now (std::chrono::steady_clock::now ());
+		peers.modify (existing, [&result, now](rai::peer_information & info) {
+			if (now - info.confirm_req_window >= std::chrono::seconds (1))
+			{
+				info.confirm_req_window = now;
+				info.confirm_req_count = 0;
+			}
+			result = info.confirm_req_count >= confirm_req_per_second;
+			if (!result)
+			{
+				++info.confirm_req_count;
+			}
+		});
+	}
+	return result;
+}
+
 bool rai::peer_container::reachout (rai::endpoint const & endpoint_a)
 {
 	// Don't contact invalid IPs
@@ -2628,8 +3344,10 @@ bool rai::peer_container::insert (rai::endpoint const & endpoint_a, unsigned ver
 		auto existing (peers.find (endpoint_a));
 		if (existing != peers.end ())
 		{
-			peers.modify (existing, [](rai::peer_information & info) {
+			peers.modify (existing, [version_a](rai::peer_information & info) {
 				info.last_contact = std::chrono::steady_clock::now ();
+				// Bootstrap connections insert with a nominal version so it's only ever raised here
+				info.network_version = std::max (info.network_version, version_a);
 			});
 			result = true;
 		}
@@ -2733,6 +3451,8 @@ last_attempt (last_contact),
 last_bootstrap_attempt (std::chrono::steady_clock::time_point ()),
 last_rep_request (std::chrono::steady_clock::time_point ()),
 last_rep_response (std::chrono::steady_clock::time_point ()),
+confirm_req_window (std::chrono::steady_clock::time_point ()),
+confirm_req_count (0),
 rep_weight (0),
 network_version (network_version_a)
 {
@@ -2745,6 +3465,8 @@ last_attempt (last_attempt_a),
 last_bootstrap_attempt (std::chrono::steady_clock::time_point ()),
 last_rep_request (std::chrono::steady_clock::time_point ()),
 last_rep_response (std::chrono::steady_clock::time_point ()),
+confirm_req_window (std::chrono::steady_clock::time_point ()),
+confirm_req_count (0),
 rep_weight (0)
 {
 }
@@ -2799,29 +3521,36 @@ rai::election::election (MDB_txn * transaction_a, rai::node & node_a, std::share
 confirmation_action (confirmation_action_a),
 votes (block_a),
 node (node_a),
-last_winner (block_a)
+last_winner (block_a),
+confirmed (false)
 {
 	assert (node_a.store.block_exists (transaction_a, block_a->hash ()));
-	confirmed.clear ();
 	compute_rep_votes (transaction_a);
 }
 
 void rai::election::compute_rep_votes (MDB_txn * transaction_a)
 {
-	node.wallets.foreach_representative (transaction_a, [this, transaction_a](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
-		auto vote (this->node.store.vote_generate (transaction_a, pub_a, prv_a, last_winner));
-		this->votes.vote (vote);
+	// Our own tally only needs the account, votes sent to peers are signed by the vote generator
+	std::vector<rai::account> representatives;
+	node.wallets.foreach_representative (transaction_a, [&representatives](rai::public_key const & pub_a, rai::raw_key const &) {
+		representatives.push_back (pub_a);
 	});
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto & i : representatives)
+	{
+		votes.vote (i, last_winner);
+	}
 }
 
-void rai::election::broadcast_winner ()
+void rai::election::broadcast_winner (MDB_txn * transaction_a)
 {
+	compute_rep_votes (transaction_a);
+	std::shared_ptr<rai::block> winner;
 	{
-		rai::transaction transaction (node.store.environment, nullptr, true);
-		compute_rep_votes (transaction);
+		std::lock_guard<std::mutex> lock (mutex);
+		winner = last_winner;
 	}
-	rai::transaction transaction_a (node.store.environment, nullptr, false);
-	node.network.republish_block (transaction_a, last_winner);
+	node.network.republish_block (transaction_a, winner);
 }
 
 rai::uint128_t rai::election::quorum_threshold (MDB_txn * transaction_a, rai::ledger & ledger_a)
@@ -2838,7 +3567,7 @@ rai::uint128_t rai::election::minimum_threshold (MDB_txn * transaction_a, rai::l
 
 void rai::election::confirm_once (MDB_txn * transaction_a)
 {
-	if (!confirmed.test_and_set ())
+	if (!confirmed.exchange (true))
 	{
 		auto tally_l (node.ledger.tally (transaction_a, votes));
 		assert (tally_l.size () > 0);
@@ -2849,10 +3578,7 @@ void rai::election::confirm_once (MDB_txn * transaction_a)
 		{
 			if (exceeded_min_threshold)
 			{
-				auto node_l (node.shared ());
-				node.background ([node_l, block_l]() {
-					node_l->block_processor.process_receive_many (rai::block_processor_item (block_l, true));
-				});
+				node.block_processor.add (rai::block_processor_item (block_l, true), rai::block_priority::forced);
 				last_winner = block_l;
 			}
 			else
@@ -2889,6 +3615,7 @@ void rai::election::confirm_if_quorum (MDB_txn * transaction_a)
 
 void rai::election::confirm_cutoff (MDB_txn * transaction_a)
 {
+	std::lock_guard<std::mutex> lock (mutex);
 	if (node.config.logging.vote_logging ())
 	{
 		BOOST_LOG (node.log) << boost::str (boost::format ("Vote tally weight %2% for root %1%") % votes.id.to_string () % last_winner->root ().to_string ());
@@ -2901,13 +3628,28 @@ void rai::election::confirm_cutoff (MDB_txn * transaction_a)
 }
 
 bool rai::election::vote (std::shared_ptr<rai::vote> vote_a)
+{
+	assert (vote_a->block != nullptr);
+	auto processed (false);
+	auto result (false);
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		result = vote (transaction, vote_a, vote_a->block, processed);
+	}
+	if (processed)
+	{
+		node.network.republish_vote (vote_a);
+	}
+	return result;
+}
+
+bool rai::election::vote (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a, std::shared_ptr<rai::block> block_a, bool & processed_a)
 {
 	assert (!rai::validate_message (vote_a->account, vote_a->hash (), vote_a->signature));
 	// see republish_vote documentation for an explanation of these rules
-	rai::transaction transaction (node.store.environment, nullptr, true);
 	auto replay (false);
-	auto supply (node.ledger.supply (transaction));
-	auto weight (node.ledger.weight (transaction, vote_a->account));
+	auto supply (node.ledger.supply (transaction_a));
+	auto weight (node.ledger.weight (transaction_a, vote_a->account));
 	if (rai::rai_network == rai::rai_networks::rai_test_network || weight > supply / 1000) // 0.1% or above
 	{
 		unsigned int cooldown;
@@ -2924,6 +3666,7 @@ bool rai::election::vote (std::shared_ptr<rai::vote> vote_a)
 			cooldown = 1;
 		}
 		auto should_process (false);
+		std::lock_guard<std::mutex> lock (mutex);
 		auto last_vote_it (last_votes.find (vote_a->account));
 		if (last_vote_it == last_votes.end ())
 		{
@@ -2947,9 +3690,9 @@ bool rai::election::vote (std::shared_ptr<rai::vote> vote_a)
 		if (should_process)
 		{
 			last_votes[vote_a->account] = std::make_pair (std::chrono::steady_clock::now (), vote_a->sequence);
-			node.network.republish_vote (vote_a);
-			votes.vote (vote_a);
-			confirm_if_quorum (transaction);
+			processed_a = true;
+			votes.vote (vote_a->account, block_a);
+			confirm_if_quorum (transaction_a);
 		}
 	}
 	return replay;
@@ -2957,64 +3700,161 @@ bool rai::election::vote (std::shared_ptr<rai::vote> vote_a)
 
 void rai::active_transactions::announce_votes ()
 {
-	std::vector<rai::block_hash> inactive;
-	rai::transaction transaction (node.store.environment, nullptr, true);
-	std::lock_guard<std::mutex> lock (mutex);
-
+	std::vector<std::shared_ptr<rai::election>> announce;
+	std::vector<std::shared_ptr<rai::block>> unconfirmed;
 	{
+		// Nothing here writes to the ledger, vote sequence numbers are kept by the vote store
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		std::lock_guard<std::mutex> lock (mutex);
+		auto now (std::chrono::steady_clock::now ());
+		std::vector<rai::block_hash> inactive;
+		// Elections that finished last round hand their slots to the next ones in line, up to announcements_max per round
+		auto budget (std::min<size_t> (announcements_per_interval + released, announcements_max));
 		size_t announcements (0);
-		auto i (roots.begin ());
-		auto n (roots.end ());
-		// Announce our decision for up to `announcements_per_interval' conflicts
-		for (; i != n && announcements < announcements_per_interval; ++i)
+		auto & sorted (roots.get<1> ());
+		auto i (sorted.begin ());
+		auto n (sorted.end ());
+		// Announce our decision for up to `budget' conflicts, highest difficulty and then oldest first
+		for (; i != n && announcements < budget; ++i)
 		{
-			auto election_l (i->election);
-			node.background ([election_l]() { election_l->broadcast_winner (); });
+			if (i->election->confirmed)
+			{
+				// Already settled by quorum, doesn't need an announcement
+				inactive.push_back (i->root);
+				continue;
+			}
+			++announcements;
+			announce.push_back (i->election);
 			if (i->announcements >= contiguous_announcements - 1)
 			{
 				// These blocks have reached the confirmation interval for forks
 				i->election->confirm_cutoff (transaction);
-				auto root_l (i->election->votes.id);
-				inactive.push_back (root_l);
+				inactive.push_back (i->root);
 			}
 			else
 			{
-				unsigned announcements;
-				roots.modify (i, [&announcements](rai::conflict_info & info_a) {
-					announcements = ++info_a.announcements;
+				unsigned announcements_l;
+				sorted.modify (i, [&announcements_l](rai::conflict_info & info_a) {
+					announcements_l = ++info_a.announcements;
 				});
+				size_t rep_votes;
+				std::shared_ptr<rai::block> winner;
+				{
+					std::lock_guard<std::mutex> election_lock (i->election->mutex);
+					rep_votes = i->election->votes.rep_votes.size ();
+					winner = i->election->last_winner;
+				}
 				// If more than one full announcement interval has passed and no one has voted on this block, we need to synchronize
-				if (announcements > 1 && i->election->votes.rep_votes.size () <= 1)
+				if (announcements_l > 1 && rep_votes <= 1)
 				{
 					node.bootstrap_initiator.bootstrap ();
 				}
+				if (rep_votes <= 1)
+				{
+					// Representatives haven't voted yet, ask them directly, requests to the same representative go out together
+					unconfirmed.push_back (winner);
+				}
 			}
 		}
 		// Mark remainder as 0 announcements sent
-		// This could happen if there's a flood of forks, the network will resolve them in increasing root hash order
+		// This could happen if there's a flood of forks, the network will resolve them in priority order
 		// This is a DoS protection mechanism to rate-limit the amount of traffic for solving forks.
 		for (; i != n; ++i)
 		{
-			// Reset announcement count for conflicts above announcement cutoff
-			roots.modify (i, [](rai::conflict_info & info_a) {
-				info_a.announcements = 0;
-			});
+			if (i->election->confirmed)
+			{
+				inactive.push_back (i->root);
+			}
+			else
+			{
+				// Reset announcement count for conflicts above announcement cutoff
+				sorted.modify (i, [](rai::conflict_info & info_a) {
+					info_a.announcements = 0;
+				});
+			}
+		}
+		for (auto i (inactive.begin ()), n (inactive.end ()); i != n; ++i)
+		{
+			auto existing (roots.find (*i));
+			assert (existing != roots.end ());
+			for (auto & block : existing->election->blocks)
+			{
+				blocks.erase (block.first);
+			}
+			finished (now - existing->started);
+			roots.erase (existing);
+		}
+		released = inactive.size ();
+		if (now > last_announcement)
+		{
+			elections_rate = static_cast<double> (inactive.size ()) / std::chrono::duration_cast<std::chrono::duration<double>> (now - last_announcement).count ();
+		}
+		last_announcement = now;
+	}
+	// Network sends happen after the transaction and the container lock are released
+	if (!announce.empty ())
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		for (auto & i : announce)
+		{
+			i->broadcast_winner (transaction);
 		}
 	}
-	for (auto i (inactive.begin ()), n (inactive.end ()); i != n; ++i)
+	// Legacy representatives keep getting per-block requests only from bootstrap and wallets, as before batching
+	for (auto & i : unconfirmed)
 	{
-		assert (roots.find (*i) != roots.end ());
-		roots.erase (*i);
+		node.network.broadcast_confirm_req_batched (i);
 	}
-	auto now (std::chrono::steady_clock::now ());
-	auto node_l (node.shared ());
-	node.alarm.add (now + std::chrono::milliseconds (announce_interval_ms), [node_l]() { node_l->active.announce_votes (); });
 }
 
-void rai::active_transactions::stop ()
+void rai::active_transactions::announce_start ()
 {
 	std::lock_guard<std::mutex> lock (mutex);
-	roots.clear ();
+	if (!stopped && !thread.joinable ())
+	{
+		thread = std::thread ([this]() { run (); });
+	}
+}
+
+void rai::active_transactions::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		auto wakeup (std::chrono::steady_clock::now () + std::chrono::milliseconds (announce_interval_ms));
+		lock.unlock ();
+		announce_votes ();
+		lock.lock ();
+		condition.wait_until (lock, wakeup, [this]() { return stopped; });
+	}
+}
+
+void rai::active_transactions::finished (std::chrono::steady_clock::duration const & duration_a)
+{
+	auto seconds (std::chrono::duration_cast<std::chrono::seconds> (duration_a).count ());
+	size_t bucket (0);
+	while (seconds > 0 && bucket < durations.size () - 1)
+	{
+		seconds >>= 1;
+		++bucket;
+	}
+	++durations[bucket];
+	++elections_finished;
+}
+
+void rai::active_transactions::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		roots.clear ();
+		blocks.clear ();
+		condition.notify_all ();
+	}
+	if (thread.joinable ())
+	{
+		thread.join ();
+	}
 }
 
 bool rai::active_transactions::start (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a, std::function<void(std::shared_ptr<rai::block>, bool)> const & confirmation_action_a)
@@ -3025,32 +3865,90 @@ bool rai::active_transactions::start (MDB_txn * transaction_a, std::shared_ptr<r
 	if (existing == roots.end ())
 	{
 		auto election (std::make_shared<rai::election> (transaction_a, node, block_a, confirmation_action_a));
-		roots.insert (rai::conflict_info{ root, election, 0 });
+		auto difficulty (rai::work_value (root, block_a->block_work ()));
+		roots.insert (rai::conflict_info{ root, difficulty, std::chrono::steady_clock::now (), election, 0 });
+		auto hash (block_a->hash ());
+		election->blocks[hash] = block_a;
+		blocks[hash] = election;
 	}
 	return existing != roots.end ();
 }
 
-// Validate a vote and apply it to the current election if one exists
+// Validate a vote and apply it to the current election of each block it's for
 bool rai::active_transactions::vote (std::shared_ptr<rai::vote> vote_a)
 {
-	std::shared_ptr<rai::election> election;
+	std::vector<std::pair<std::shared_ptr<rai::election>, std::shared_ptr<rai::block>>> elections;
 	{
 		std::lock_guard<std::mutex> lock (mutex);
-		auto root (vote_a->block->root ());
-		auto existing (roots.find (root));
-		if (existing != roots.end ())
+		if (vote_a->block != nullptr)
+		{
+			auto existing (roots.find (vote_a->block->root ()));
+			if (existing != roots.end ())
+			{
+				elections.push_back (std::make_pair (existing->election, vote_a->block));
+				// The vote may introduce a fork, later votes by hash for it need to find this election
+				auto hash (vote_a->block->hash ());
+				if (existing->election->blocks.insert (std::make_pair (hash, vote_a->block)).second)
+				{
+					blocks[hash] = existing->election;
+				}
+			}
+		}
+		else
 		{
-			election = existing->election;
+			for (auto & hash : vote_a->hashes)
+			{
+				auto existing (blocks.find (hash));
+				if (existing != blocks.end ())
+				{
+					elections.push_back (std::make_pair (existing->second, existing->second->blocks[hash]));
+				}
+			}
 		}
 	}
 	auto result (false);
-	if (election)
+	if (!elections.empty ())
 	{
-		result = election->vote (vote_a);
+		// Only a replay if it was one for every election it reached
+		result = true;
+		auto processed (false);
+		{
+			rai::transaction transaction (node.store.environment, nullptr, false);
+			for (auto & i : elections)
+			{
+				result = i.first->vote (transaction, vote_a, i.second, processed) && result;
+			}
+		}
+		if (processed)
+		{
+			node.network.republish_vote (vote_a);
+		}
 	}
 	return result;
 }
 
+void rai::active_transactions::publish (std::shared_ptr<rai::block> block_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (roots.find (block_a->root ()));
+	if (existing != roots.end ())
+	{
+		auto hash (block_a->hash ());
+		if (existing->election->blocks.insert (std::make_pair (hash, block_a)).second)
+		{
+			blocks[hash] = existing->election;
+			// A fork with more work behind it raises the priority of the whole election
+			auto difficulty (rai::work_value (block_a->root (), block_a->block_work ()));
+			if (difficulty > existing->difficulty)
+			{
+				roots.modify (existing, [difficulty](rai::conflict_info & info_a) {
+					info_a.difficulty = difficulty;
+				});
+			}
+		}
+	}
+}
+
 bool rai::active_transactions::active (rai::block const & block_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
@@ -3064,14 +3962,21 @@ std::deque<std::shared_ptr<rai::block>> rai::active_transactions::list_blocks ()
 	std::lock_guard<std::mutex> lock (mutex);
 	for (auto i (roots.begin ()), n (roots.end ()); i != n; ++i)
 	{
+		std::lock_guard<std::mutex> election_lock (i->election->mutex);
 		result.push_back (i->election->last_winner);
 	}
 	return result;
 }
 
 rai::active_transactions::active_transactions (rai::node & node_a) :
-node (node_a)
+node (node_a),
+stopped (false),
+released (0),
+elections_finished (0),
+elections_rate (0),
+last_announcement (std::chrono::steady_clock::now ())
 {
+	durations.fill (0);
 }
 
 int rai::node::store_version ()
@@ -3122,6 +4027,8 @@ void rai::add_node_options (boost::program_options::options_description & descri
 		("account_key", "Get the public key for <account>")
 		("vacuum", "Compact database. If data_path is missing, the database in data directory is compacted.")
 		("snapshot", "Compact database and create snapshot, functions similar to vacuum but does not replace the existing database")
+		("snapshot_export", "Write the ledger in the database to <file> as a portable, checksummed snapshot")
+		("snapshot_import", "Replace the ledger in the database with the snapshot in <file>, wallets are kept")
 		("data_path", boost::program_options::value<std::string> (), "Use the supplied path as the data directory")
 		("diagnostics", "Run internal diagnostics")
 		("key_create", "Generates a adhoc random keypair and prints it to stdout")
@@ -3292,6 +4199,134 @@ bool rai::handle_node_options (boost::program_options::variables_map & vm)
 			std::cerr << "Snapshot Failed" << std::endl;
 		}
 	}
+	else if (vm.count ("snapshot_export"))
+	{
+		if (vm.count ("file") == 1)
+		{
+			std::string filename (vm["file"].as<std::string> ());
+			std::ofstream stream (filename, std::ios::binary | std::ios::trunc);
+			if (!stream.fail ())
+			{
+				std::cout << "Exporting ledger to " << filename << std::endl;
+				std::cout << "This may take a while..." << std::endl;
+				inactive_node node (data_path);
+				rai::ledger_snapshot snapshot (node.node->store);
+				rai::transaction transaction (node.node->store.environment, nullptr, false);
+				if (!snapshot.serialize (transaction, stream))
+				{
+					std::cout << boost::str (boost::format ("Exported %1% entries\n") % snapshot.entries);
+				}
+				else
+				{
+					std::cerr << "Error writing snapshot\n";
+					result = true;
+				}
+			}
+			else
+			{
+				std::cerr << "Unable to open <file>\n";
+				result = true;
+			}
+		}
+		else
+		{
+			std::cerr << "snapshot_export command requires one <file> option\n";
+			result = true;
+		}
+	}
+	else if (vm.count ("snapshot_import"))
+	{
+		if (vm.count ("file") == 1)
+		{
+			std::string filename (vm["file"].as<std::string> ());
+			std::ifstream stream (filename, std::ios::binary);
+			if (!stream.fail ())
+			{
+				try
+				{
+					auto import_path (data_path / "snapshot_import.ldb");
+					std::cout << "Importing ledger from " << filename << std::endl;
+					std::cout << "This may take a while..." << std::endl;
+					boost::filesystem::create_directories (data_path);
+					// The stores are opened with the database options of the node's configuration if there is one
+					rai::node_config config;
+					auto config_path (data_path / "config.json");
+					if (boost::filesystem::exists (config_path))
+					{
+						boost::property_tree::ptree tree;
+						boost::property_tree::read_json (config_path.string (), tree);
+						auto node_l (tree.get_child_optional ("node"));
+						auto upgraded (false);
+						if (node_l && config.deserialize_json (upgraded, *node_l))
+						{
+							std::cerr << "Error reading node configuration, using defaults\n";
+							config = rai::node_config ();
+						}
+					}
+					auto error (false);
+					{
+						// The snapshot is verified into a scratch store first so a bad file leaves the ledger untouched
+						boost::filesystem::remove (import_path);
+						rai::block_store import (error, import_path, config.lmdb_max_dbs, config.lmdb);
+						if (!error)
+						{
+							rai::ledger_snapshot snapshot (import);
+							error = snapshot.deserialize (stream);
+						}
+						if (!error)
+						{
+							// Only the ledger tables are swapped, wallets and everything else in the database stay in place
+							rai::block_store store (error, data_path / "data.ldb", config.lmdb_max_dbs, config.lmdb, config.sorted_indexes);
+							if (!error)
+							{
+								std::cout << "Finalizing" << std::endl;
+								rai::ledger_snapshot snapshot (store);
+								rai::transaction import_transaction (import.environment, nullptr, false);
+								rai::transaction transaction (store.environment, nullptr, true);
+								error = snapshot.replace (transaction, import, import_transaction);
+								if (!error)
+								{
+									std::cout << boost::str (boost::format ("Imported %1% entries\n") % snapshot.entries);
+								}
+							}
+						}
+					}
+					boost::filesystem::remove (import_path);
+					boost::filesystem::remove (import_path.string () + "-lock");
+					boost::filesystem::remove (boost::filesystem::path (import_path).replace_extension (".votes"));
+					if (!error)
+					{
+						std::cout << "Import completed" << std::endl;
+					}
+					else
+					{
+						std::cerr << "Snapshot is corrupt or incompatible with this node\n";
+						result = true;
+					}
+				}
+				catch (const boost::filesystem::filesystem_error & ex)
+				{
+					std::cerr << "Import failed during a file operation: " << ex.what () << std::endl;
+					result = true;
+				}
+				catch (const std::runtime_error & ex)
+				{
+					std::cerr << "Import failed: " << ex.what () << std::endl;
+					result = true;
+				}
+			}
+			else
+			{
+				std::cerr << "Unable to open <file>\n";
+				result = true;
+			}
+		}
+		else
+		{
+			std::cerr << "snapshot_import command requires one <file> option\n";
+			result = true;
+		}
+	}
 	else if (vm.count ("diagnostics"))
 	{
 		inactive_node node (data_path);
@@ -3759,13 +4794,8 @@ bool rai::handle_node_options (boost::program_options::variables_map & vm)
 	else if (vm.count ("vote_dump") == 1)
 	{
 		inactive_node node (data_path);
-		rai::transaction transaction (node.node->store.environment, nullptr, false);
-		for (auto i (node.node->store.vote_begin (transaction)), n (node.node->store.vote_end ()); i != n; ++i)
+		for (auto & vote : node.node->store.votes.list ())
 		{
-			bool error (false);
-			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto vote (std::make_shared<rai::vote> (error, stream));
-			assert (!error);
 			std::cerr << boost::str (boost::format ("%1%\n") % vote->to_json ());
 		}
 	}
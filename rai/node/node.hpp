@@ -3,9 +3,11 @@
 #include <rai/ledger.hpp>
 #include <rai/lib/work.hpp>
 #include <rai/node/bootstrap.hpp>
+#include <rai/node/callback.hpp>
 #include <rai/node/wallet.hpp>
 
 #include <condition_variable>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -16,6 +18,7 @@
 #include <boost/circular_buffer.hpp>
 #include <boost/iostreams/device/array.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -39,33 +42,43 @@ class node;
 class election : public std::enable_shared_from_this<rai::election>
 {
 	std::function<void(std::shared_ptr<rai::block>, bool)> confirmation_action;
+	// These are called with mutex held
 	void confirm_once (MDB_txn *);
+	// Check if we have vote quorum
+	bool have_quorum (MDB_txn *);
+	// Confirmation method 1, uncontested quorum
+	void confirm_if_quorum (MDB_txn *);
 
 public:
 	election (MDB_txn *, rai::node &, std::shared_ptr<rai::block>, std::function<void(std::shared_ptr<rai::block>, bool)> const &);
 	bool vote (std::shared_ptr<rai::vote>);
-	// Check if we have vote quorum
-	bool have_quorum (MDB_txn *);
+	// Counts the vote for one of this election's blocks, returns true if it's a replay and sets processed_a if it should be republished
+	bool vote (MDB_txn *, std::shared_ptr<rai::vote>, std::shared_ptr<rai::block>, bool & processed_a);
 	// Tell the network our view of the winner
-	void broadcast_winner ();
+	void broadcast_winner (MDB_txn *);
 	// Change our winner to agree with the network
 	void compute_rep_votes (MDB_txn *);
-	// Confirmation method 1, uncontested quorum
-	void confirm_if_quorum (MDB_txn *);
 	// Confirmation method 2, settling time
 	void confirm_cutoff (MDB_txn *);
 	rai::uint128_t quorum_threshold (MDB_txn *, rai::ledger &);
 	rai::uint128_t minimum_threshold (MDB_txn *, rai::ledger &);
+	// Votes arrive on io threads while the election thread announces, votes, last_votes and last_winner are guarded by mutex
+	std::mutex mutex;
 	rai::votes votes;
 	rai::node & node;
 	std::unordered_map<rai::account, std::pair<std::chrono::steady_clock::time_point, uint64_t>> last_votes;
 	std::shared_ptr<rai::block> last_winner;
-	std::atomic_flag confirmed;
+	std::atomic<bool> confirmed;
+	// Every block seen competing for this root, guarded by the active_transactions mutex
+	std::unordered_map<rai::block_hash, std::shared_ptr<rai::block>> blocks;
 };
 class conflict_info
 {
 public:
 	rai::block_hash root;
+	// Highest work value among the competing blocks
+	uint64_t difficulty;
+	std::chrono::steady_clock::time_point started;
 	std::shared_ptr<rai::election> election;
 	// Number of announcements in a row for this fork
 	unsigned announcements;
@@ -82,23 +95,55 @@ public:
 	// If this returns true, the vote is a replay
 	// If this returns false, the vote may or may not be a replay
 	bool vote (std::shared_ptr<rai::vote>);
+	// Adds a fork to the election for its root so votes by hash for it are counted
+	void publish (std::shared_ptr<rai::block>);
 	// Is the root of this block in the roots container
 	bool active (rai::block const &);
+	// Runs one announcement round
 	void announce_votes ();
+	// Starts the election thread, which runs an announcement round every interval
+	void announce_start ();
 	std::deque<std::shared_ptr<rai::block>> list_blocks ();
 	void stop ();
+	// Records how long a finished election ran
+	void finished (std::chrono::steady_clock::duration const &);
+	// Looked up by root, announced in order of difficulty and then age
 	boost::multi_index_container<
 	rai::conflict_info,
 	boost::multi_index::indexed_by<
-	boost::multi_index::ordered_unique<boost::multi_index::member<rai::conflict_info, rai::block_hash, &rai::conflict_info::root>>>>
+	boost::multi_index::hashed_unique<boost::multi_index::member<rai::conflict_info, rai::block_hash, &rai::conflict_info::root>>,
+	boost::multi_index::ordered_non_unique<boost::multi_index::composite_key<
+	rai::conflict_info,
+	boost::multi_index::member<rai::conflict_info, uint64_t, &rai::conflict_info::difficulty>,
+	boost::multi_index::member<rai::conflict_info, std::chrono::steady_clock::time_point, &rai::conflict_info::started>>,
+	boost::multi_index::composite_key_compare<std::greater<uint64_t>, std::less<std::chrono::steady_clock::time_point>>>>>
 	roots;
+	// Elections by the hash of each of their blocks, votes by hash are routed through this
+	std::unordered_map<rai::block_hash, std::shared_ptr<rai::election>> blocks;
 	rai::node & node;
 	std::mutex mutex;
-	// Maximum number of conflicts to vote on per interval, lowest root hash first
+	std::condition_variable condition;
+	bool stopped;
+	// Elections that finished in the last round, added to the next round's budget
+	size_t released;
+	uint64_t elections_finished;
+	// Elections finished per second during the last round
+	double elections_rate;
+	std::chrono::steady_clock::time_point last_announcement;
+	// Finished elections by duration, bucket n counts those that took less than 2^n seconds and the last one everything longer
+	static size_t constexpr duration_buckets = 8;
+	std::array<uint64_t, duration_buckets> durations;
+	// Minimum number of conflicts to vote on per interval, highest priority first
 	static unsigned constexpr announcements_per_interval = 32;
+	// Upper bound on conflicts voted on in one round however many elections finished in the previous one
+	static unsigned constexpr announcements_max = 2 * announcements_per_interval;
 	// After this many successive vote announcements, block is confirmed
 	static unsigned constexpr contiguous_announcements = 4;
 	static unsigned constexpr announce_interval_ms = (rai::rai_network == rai::rai_networks::rai_test_network) ? 10 : 16000;
+
+private:
+	void run ();
+	std::thread thread;
 };
 class operation
 {
@@ -125,6 +170,7 @@ class gap_information
 public:
 	std::chrono::steady_clock::time_point arrival;
 	rai::block_hash hash;
+	std::shared_ptr<rai::block> block;
 	std::unique_ptr<rai::votes> votes;
 };
 class gap_cache
@@ -157,6 +203,9 @@ public:
 	std::chrono::steady_clock::time_point last_bootstrap_attempt;
 	std::chrono::steady_clock::time_point last_rep_request;
 	std::chrono::steady_clock::time_point last_rep_response;
+	// Start of the current window and the by-hash confirm_req answered within it
+	std::chrono::steady_clock::time_point confirm_req_window;
+	unsigned confirm_req_count;
 	rai::amount rep_weight;
 	unsigned network_version;
 };
@@ -185,6 +234,8 @@ public:
 	// List of all peers
 	std::vector<rai::endpoint> list ();
 	std::map<rai::endpoint, unsigned> list_version ();
+	// Protocol version the peer last contacted us with, 0 if it isn't a known peer
+	unsigned version (rai::endpoint const &);
 	// A list of random peers with size the square root of total peer count
 	std::vector<rai::endpoint> list_sqrt ();
 	// Get the next peer for attempting bootstrap
@@ -194,6 +245,8 @@ public:
 	std::vector<rai::endpoint> rep_crawl ();
 	bool rep_response (rai::endpoint const &, rai::amount const &);
 	void rep_request (rai::endpoint const &);
+	// Counts a by-hash confirm_req from a known peer, true if the peer exceeded confirm_req_per_second and shouldn't be answered
+	bool confirm_req_limited (rai::endpoint const &);
 	// Should we reach out to this endpoint with a keepalive message
 	bool reachout (rai::endpoint const &);
 	size_t size ();
@@ -223,6 +276,7 @@ public:
 	std::function<void()> disconnect_observer;
 	// Number of peers to crawl for being a rep every period
 	static size_t constexpr peers_per_crawl = 8;
+	static unsigned constexpr confirm_req_per_second = 16;
 };
 class send_info
 {
@@ -314,7 +368,13 @@ public:
 	void merge_peers (std::array<rai::endpoint, 8> const &);
 	void send_keepalive (rai::endpoint const &);
 	void broadcast_confirm_req (std::shared_ptr<rai::block>);
+	// Asks representatives that accept confirm_req by hash through the request aggregator, older representatives are skipped
+	void broadcast_confirm_req_batched (std::shared_ptr<rai::block>);
+	// Asks the peer to confirm the block, batched with other requests to it if the peer supports it
+	void request_confirmation (rai::endpoint const &, std::shared_ptr<rai::block>);
 	void send_confirm_req (rai::endpoint const &, std::shared_ptr<rai::block>);
+	void send_confirm_req (rai::endpoint const &, std::vector<std::pair<rai::block_hash, rai::block_hash>> const &);
+	void send_confirm_req (rai::endpoint const &, rai::confirm_req &);
 	void send_buffer (uint8_t const *, size_t, rai::endpoint const &, std::function<void(boost::system::error_code const &, size_t)>);
 	rai::endpoint endpoint ();
 	rai::endpoint remote;
@@ -329,6 +389,9 @@ public:
 	uint64_t error_count;
 	rai::message_statistics incoming;
 	rai::message_statistics outgoing;
+	// confirm_req by hash left unanswered because the sender wasn't a known peer yet or was over its rate limit
+	std::atomic<uint64_t> confirm_req_unknown;
+	std::atomic<uint64_t> confirm_req_limited;
 	static uint16_t const node_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7075 : 54000;
 };
 class logging
@@ -402,15 +465,31 @@ public:
 	unsigned password_fanout;
 	unsigned io_threads;
 	unsigned work_threads;
+	// Threads running wallet actions, actions of different accounts run concurrently
+	unsigned wallet_action_threads;
 	bool enable_voting;
 	unsigned bootstrap_connections;
 	unsigned bootstrap_connections_max;
 	std::string callback_address;
 	uint16_t callback_port;
 	std::string callback_target;
+	// Keep-alive connections delivering callbacks concurrently
+	unsigned callback_connections;
+	// Callbacks waiting for delivery before new ones are dropped
+	size_t callback_queue_max;
+	// Events per POST, above one the body is a JSON array
+	size_t callback_batch_max;
+	unsigned callback_retries;
+	// Connecting, sending and waiting for the response each have to finish within this or the attempt fails and is retried
+	std::chrono::seconds callback_timeout;
 	int lmdb_max_dbs;
 	rai::block_hash state_block_parse_canary;
 	rai::block_hash state_block_generate_canary;
+	size_t unchecked_max_count;
+	std::chrono::seconds unchecked_cutoff;
+	rai::lmdb_config lmdb;
+	// Maintain balance and weight ordered indexes for sorted ledger and representatives queries
+	bool sorted_indexes;
 	static std::chrono::seconds constexpr keepalive_period = std::chrono::seconds (60);
 	static std::chrono::seconds constexpr keepalive_cutoff = keepalive_period * 5;
 	static std::chrono::minutes constexpr wallet_backup_interval = std::chrono::minutes (5);
@@ -421,6 +500,7 @@ public:
 	rai::observer_set<std::shared_ptr<rai::block>, rai::process_return const &> blocks;
 	rai::observer_set<bool> wallet;
 	rai::observer_set<std::shared_ptr<rai::vote>, rai::endpoint const &> vote;
+	rai::observer_set<std::shared_ptr<rai::block>> confirmed;
 	rai::observer_set<rai::account const &, bool> account_balance;
 	rai::observer_set<rai::endpoint const &> endpoint;
 	rai::observer_set<> disconnect;
@@ -433,6 +513,53 @@ public:
 	rai::vote_result vote (std::shared_ptr<rai::vote>, rai::endpoint);
 	rai::node & node;
 };
+/**
+ * Collects blocks our representatives vote for and signs them in bundles of up to vote::max_hashes
+ * Each bundle is sent to every peer that asked for any of its blocks
+ */
+class vote_generator
+{
+public:
+	vote_generator (rai::node &);
+	void add (rai::block_hash const &, std::vector<rai::endpoint> const &);
+	void stop ();
+	rai::node & node;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::pair<rai::block_hash, std::vector<rai::endpoint>>> hashes;
+	bool stopped;
+	// Votes signed and blocks covered by them
+	uint64_t generated;
+	uint64_t bundled;
+	// How long a partial bundle waits for more blocks before it's sent
+	static std::chrono::milliseconds constexpr wait = std::chrono::milliseconds (rai::rai_network == rai::rai_networks::rai_test_network ? 5 : 50);
+	std::thread thread;
+
+private:
+	void run ();
+	void send (std::unique_lock<std::mutex> &);
+};
+/**
+ * Coalesces confirmation requests for the same peer over a short window into confirm_req messages carrying several hash and root pairs
+ */
+class request_aggregator
+{
+public:
+	request_aggregator (rai::node &);
+	void add (rai::endpoint const &, std::shared_ptr<rai::block>);
+	// Sends everything queued
+	void flush ();
+	void stop ();
+	rai::node & node;
+	std::mutex mutex;
+	std::unordered_map<rai::endpoint, std::vector<std::pair<rai::block_hash, rai::block_hash>>> requests;
+	bool scheduled;
+	bool stopped;
+	// Blocks requested and the confirm_req messages carrying them
+	uint64_t requested;
+	uint64_t messages;
+	static std::chrono::milliseconds constexpr window = std::chrono::milliseconds (rai::rai_network == rai::rai_networks::rai_test_network ? 5 : 100);
+};
 // The network is crawled for representatives by occasionally sending a unicast confirm_req for a specific block and watching to see if it's acknowledged with a vote.
 class rep_crawler
 {
@@ -443,16 +570,81 @@ public:
 	std::mutex mutex;
 	std::unordered_set<rai::block_hash> active;
 };
+enum class block_priority
+{
+	forced, // Election winners replacing a block in our ledger
+	local, // Blocks created by our wallets or submitted over RPC
+	network // Blocks from peers and bootstrap
+};
 class block_processor_item
 {
 public:
 	block_processor_item (std::shared_ptr<rai::block>);
 	block_processor_item (std::shared_ptr<rai::block>, bool);
+	block_processor_item (std::shared_ptr<rai::block>, bool, bool);
 	std::shared_ptr<rai::block> block;
 	bool force;
+	// Signature was already checked by the unchecked_drainer
+	bool verified;
+	// Fulfilled once the block is processed, null if no one is waiting on it
+	std::shared_ptr<std::promise<rai::process_return>> promise;
+};
+class unchecked_drainer_entry
+{
+public:
+	std::shared_ptr<rai::block> block;
+	// Signing account, zero if it can't be determined before the block is processed
+	rai::account account;
+	size_t level;
+	// Index of the drained block this one depends on
+	size_t parent;
+	bool work_valid;
+	bool signature_valid;
+	// Set when the block or anything it depends on failed verification
+	bool rejected;
+};
+// Pulls every block waiting in the unchecked table on a newly inserted dependency
+// Dependents are walked as a graph inside the write transaction, once it's released their work and signatures are checked in parallel on a persistent set of verification threads and they're queued by dependency level grouped by account chain
+class unchecked_drainer
+{
+public:
+	unchecked_drainer (rai::node &);
+	~unchecked_drainer ();
+	// Removes the dependents of the block from the unchecked table and appends them to the entries
+	void drain (MDB_txn *, rai::block_hash const &, std::vector<rai::unchecked_drainer_entry> &);
+	// Verifies drained entries without a transaction open and queues the valid ones ahead of the blocks, marked verified
+	void queue (std::vector<rai::unchecked_drainer_entry> &, std::deque<rai::block_processor_item> &);
+	void verify (std::vector<rai::unchecked_drainer_entry> &);
+	void stop ();
+	rai::account signer (MDB_txn *, rai::block const &, rai::unchecked_drainer_entry const *);
+	rai::node & node;
+	std::atomic<uint64_t> batches;
+	std::atomic<uint64_t> collected;
+	std::atomic<uint64_t> verified;
+	std::atomic<uint64_t> unverified;
+	std::atomic<uint64_t> rejected;
+	// Blocks collected from the unchecked table in a single drain
+	static size_t constexpr batch_max = 64 * 1024;
+	// Below this many blocks verification is done on the calling thread
+	static size_t constexpr parallel_min = 256;
+
+private:
+	void run ();
+	// Takes the next chunk of the current batch, returns false once there's nothing left to take
+	bool verify_chunk (std::unique_lock<std::mutex> &);
+	std::mutex mutex;
+	std::condition_variable condition;
+	// Batch being verified, chunks are handed out from next and the batch is done once remaining reaches zero
+	std::vector<rai::unchecked_drainer_entry> * entries;
+	size_t next;
+	size_t chunk;
+	size_t remaining;
+	bool stopped;
+	std::vector<std::thread> threads;
 };
 // Processing blocks is a potentially long IO operation
 // This class isolates block insertion from other operations like servicing network operations
+// Its thread is the only one writing blocks to the ledger, queued blocks are taken in priority order
 class block_processor
 {
 public:
@@ -460,15 +652,27 @@ public:
 	~block_processor ();
 	void stop ();
 	void flush ();
+	// Queues a block from the network
 	void add (rai::block_processor_item const &);
-	void process_receive_many (rai::block_processor_item const &);
-	void process_receive_many (std::deque<rai::block_processor_item> &);
-	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>);
+	// The future is ready once the block is processed and broken if the processor stops first
+	std::future<rai::process_return> add (rai::block_processor_item const &, rai::block_priority);
+	// Queues the block and waits for it, returns true if the processor stopped first
+	// Must not be called from the block processor thread
+	bool process_one (rai::block_processor_item const &, rai::process_return &, rai::block_priority = rai::block_priority::local);
+	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>, bool = false);
 	void process_blocks ();
+	size_t size ();
+	rai::unchecked_drainer drainer;
+	std::atomic<uint64_t> batches;
+	// Network blocks taken per batch so forced and local blocks don't wait behind a bootstrap backlog
+	static size_t constexpr network_batch_max = 1024;
 
 private:
+	void process_receive_many (std::deque<rai::block_processor_item> &);
 	bool stopped;
 	bool idle;
+	std::deque<rai::block_processor_item> forced;
+	std::deque<rai::block_processor_item> local;
 	std::deque<rai::block_processor_item> blocks;
 	std::mutex mutex;
 	std::condition_variable condition;
@@ -495,6 +699,9 @@ public:
 	void process_confirmed (std::shared_ptr<rai::block>);
 	void process_message (rai::message &, rai::endpoint const &);
 	void process_active (std::shared_ptr<rai::block>);
+	// Queues a copy of the block ahead of network blocks and waits for the result, not to be called from the block processor thread or with a write transaction open
+	// It's processed like any other block: block observers run, gaps go to unchecked and the gap cache, and blocks waiting on it are drained
+	// Only once the block processor has stopped is the ledger written directly, without any of these
 	rai::process_return process (rai::block const &);
 	void keepalive_preconfigured (std::vector<std::string> const &);
 	rai::block_hash latest (rai::account const &);
@@ -507,6 +714,7 @@ public:
 	void ongoing_rep_crawl ();
 	void ongoing_bootstrap ();
 	void ongoing_store_flush ();
+	void ongoing_store_sync ();
 	void backup_wallet ();
 	int price (rai::uint128_t const &, int);
 	void generate_work (rai::block &);
@@ -536,6 +744,9 @@ public:
 	rai::block_processor block_processor;
 	std::thread block_processor_thread;
 	rai::block_arrival block_arrival;
+	rai::callback_dispatcher callback;
+	rai::vote_generator vote_generator;
+	rai::request_aggregator request_aggregator;
 	static double constexpr price_max = 16.0;
 	static double constexpr free_cutoff = 1024.0;
 	static std::chrono::seconds constexpr period = std::chrono::seconds (60);
@@ -53,7 +53,14 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (rai::rpc::rpc_port),
 enable_control (false),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+max_connections (1024),
+idle_timeout (std::chrono::seconds (30)),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+expensive_concurrency (2),
+queue_max (4096),
+cache_max (64 * 1024),
+websocket_queue_max (1024)
 {
 }
 
@@ -62,7 +69,14 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (rai::rpc::rpc_port),
 enable_control (enable_control_a),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+max_connections (1024),
+idle_timeout (std::chrono::seconds (30)),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+expensive_concurrency (2),
+queue_max (4096),
+cache_max (64 * 1024),
+websocket_queue_max (1024)
 {
 }
 
@@ -73,6 +87,19 @@ void rai::rpc_config::serialize_json (boost::property_tree::ptree & tree_a) cons
 	tree_a.put ("enable_control", enable_control);
 	tree_a.put ("frontier_request_limit", frontier_request_limit);
 	tree_a.put ("chain_request_limit", chain_request_limit);
+	tree_a.put ("max_connections", std::to_string (max_connections));
+	tree_a.put ("idle_timeout", std::to_string (idle_timeout.count ()));
+	tree_a.put ("worker_threads", std::to_string (worker_threads));
+	tree_a.put ("expensive_concurrency", std::to_string (expensive_concurrency));
+	tree_a.put ("queue_max", std::to_string (queue_max));
+	boost::property_tree::ptree cache_ttl_l;
+	for (auto & i : cache_ttl)
+	{
+		cache_ttl_l.put (i.first, std::to_string (i.second.count ()));
+	}
+	tree_a.add_child ("cache_ttl", cache_ttl_l);
+	tree_a.put ("cache_max", std::to_string (cache_max));
+	tree_a.put ("websocket_queue_max", std::to_string (websocket_queue_max));
 }
 
 bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree_a)
@@ -93,12 +120,42 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 			enable_control = tree_a.get<bool> ("enable_control");
 			auto frontier_request_limit_l (tree_a.get<std::string> ("frontier_request_limit"));
 			auto chain_request_limit_l (tree_a.get<std::string> ("chain_request_limit"));
+			// Added after the initial format, absent entries keep their defaults
+			auto max_connections_l (tree_a.get<std::string> ("max_connections", std::to_string (max_connections)));
+			auto idle_timeout_l (tree_a.get<std::string> ("idle_timeout", std::to_string (idle_timeout.count ())));
+			auto worker_threads_l (tree_a.get<std::string> ("worker_threads", std::to_string (worker_threads)));
+			auto expensive_concurrency_l (tree_a.get<std::string> ("expensive_concurrency", std::to_string (expensive_concurrency)));
+			auto queue_max_l (tree_a.get<std::string> ("queue_max", std::to_string (queue_max)));
+			auto cache_max_l (tree_a.get<std::string> ("cache_max", std::to_string (cache_max)));
+			auto websocket_queue_max_l (tree_a.get<std::string> ("websocket_queue_max", std::to_string (websocket_queue_max)));
 			try
 			{
 				port = std::stoul (port_l);
 				result = port > std::numeric_limits<uint16_t>::max ();
 				frontier_request_limit = std::stoull (frontier_request_limit_l);
 				chain_request_limit = std::stoull (chain_request_limit_l);
+				max_connections = std::stoul (max_connections_l);
+				idle_timeout = std::chrono::seconds (std::stoull (idle_timeout_l));
+				worker_threads = std::stoul (worker_threads_l);
+				expensive_concurrency = std::stoul (expensive_concurrency_l);
+				queue_max = std::stoull (queue_max_l);
+				cache_max = std::stoull (cache_max_l);
+				websocket_queue_max = std::stoull (websocket_queue_max_l);
+				auto cache_ttl_l (tree_a.get_child_optional ("cache_ttl"));
+				if (cache_ttl_l)
+				{
+					cache_ttl.clear ();
+					for (auto & i : cache_ttl_l.get ())
+					{
+						cache_ttl[i.first] = std::chrono::milliseconds (std::stoull (i.second.get<std::string> ("")));
+					}
+				}
+				result |= max_connections == 0;
+				result |= worker_threads == 0;
+				result |= expensive_concurrency == 0;
+				result |= queue_max == 0;
+				result |= cache_max == 0;
+				result |= websocket_queue_max == 0;
 			}
 			catch (std::logic_error const &)
 			{
@@ -119,10 +176,408 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 	return result;
 }
 
+rai::rpc_action_stats::rpc_action_stats () :
+count (0),
+queue_wait (0),
+queue_wait_max (0),
+execution (0),
+execution_max (0)
+{
+}
+
+rai::rpc_executor::rpc_executor (rai::rpc_config const & config_a) :
+expensive_active (0),
+expensive_concurrency (config_a.expensive_concurrency),
+queue_max (config_a.queue_max),
+rejected (0),
+stopped (false)
+{
+	for (unsigned i (0); i < config_a.worker_threads; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+rai::rpc_executor::~rpc_executor ()
+{
+	stop ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
+}
+
+bool rai::rpc_executor::add (rai::rpc_cost cost_a, std::function<void()> const & action_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto & queue (cost_a == rai::rpc_cost::expensive ? expensive : cheap);
+	auto result (stopped || queue.size () >= queue_max);
+	if (!result)
+	{
+		queue.push_back (action_a);
+		condition.notify_one ();
+	}
+	else
+	{
+		++rejected;
+	}
+	return result;
+}
+
+void rai::rpc_executor::record (std::string const & action_a, std::chrono::microseconds queue_wait_a, std::chrono::microseconds execution_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto & stats_l (stats[action_a]);
+	++stats_l.count;
+	stats_l.queue_wait += queue_wait_a;
+	stats_l.queue_wait_max = std::max (stats_l.queue_wait_max, queue_wait_a);
+	stats_l.execution += execution_a;
+	stats_l.execution_max = std::max (stats_l.execution_max, execution_a);
+}
+
+void rai::rpc_executor::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	condition.notify_all ();
+}
+
+void rai::rpc_executor::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!expensive.empty () && expensive_active < expensive_concurrency)
+		{
+			auto action (expensive.front ());
+			expensive.pop_front ();
+			++expensive_active;
+			lock.unlock ();
+			action ();
+			lock.lock ();
+			--expensive_active;
+			// A thread may be waiting only because the concurrency limit was reached
+			condition.notify_all ();
+		}
+		else if (!cheap.empty ())
+		{
+			auto action (cheap.front ());
+			cheap.pop_front ();
+			lock.unlock ();
+			action ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+namespace
+{
+class rpc_action
+{
+public:
+	std::function<void(rai::rpc_handler &)> handler;
+	rai::rpc_cost cost;
+};
+
+void history (rai::rpc_handler & handler_a)
+{
+	handler_a.request.put ("head", handler_a.request.get<std::string> ("hash"));
+	handler_a.account_history ();
+}
+
+void processed_before_logging (rai::rpc_handler &)
+{
+}
+
+// Built once so dispatch is a single hash lookup instead of a chain of string comparisons
+std::unordered_map<std::string, rpc_action> const & rpc_actions ()
+{
+	static std::unordered_map<std::string, rpc_action> const actions = {
+		{ "account_balance", { &rai::rpc_handler::account_balance, rai::rpc_cost::cheap } },
+		{ "account_block_count", { &rai::rpc_handler::account_block_count, rai::rpc_cost::cheap } },
+		{ "account_create", { &rai::rpc_handler::account_create, rai::rpc_cost::cheap } },
+		{ "account_get", { &rai::rpc_handler::account_get, rai::rpc_cost::cheap } },
+		{ "account_history", { &rai::rpc_handler::account_history, rai::rpc_cost::expensive } },
+		{ "account_info", { &rai::rpc_handler::account_info, rai::rpc_cost::cheap } },
+		{ "account_key", { &rai::rpc_handler::account_key, rai::rpc_cost::cheap } },
+		{ "account_list", { &rai::rpc_handler::account_list, rai::rpc_cost::cheap } },
+		{ "account_move", { &rai::rpc_handler::account_move, rai::rpc_cost::cheap } },
+		{ "account_remove", { &rai::rpc_handler::account_remove, rai::rpc_cost::cheap } },
+		{ "account_representative", { &rai::rpc_handler::account_representative, rai::rpc_cost::cheap } },
+		{ "account_representative_set", { &rai::rpc_handler::account_representative_set, rai::rpc_cost::cheap } },
+		{ "account_weight", { &rai::rpc_handler::account_weight, rai::rpc_cost::cheap } },
+		{ "accounts_balances", { &rai::rpc_handler::accounts_balances, rai::rpc_cost::cheap } },
+		{ "accounts_create", { &rai::rpc_handler::accounts_create, rai::rpc_cost::cheap } },
+		{ "accounts_frontiers", { &rai::rpc_handler::accounts_frontiers, rai::rpc_cost::cheap } },
+		{ "accounts_pending", { &rai::rpc_handler::accounts_pending, rai::rpc_cost::expensive } },
+		{ "active_stats", { &rai::rpc_handler::active_stats, rai::rpc_cost::cheap } },
+		{ "available_supply", { &rai::rpc_handler::available_supply, rai::rpc_cost::cheap } },
+		{ "block", { &rai::rpc_handler::block, rai::rpc_cost::cheap } },
+		{ "block_account", { &rai::rpc_handler::block_account, rai::rpc_cost::cheap } },
+		{ "block_count", { &rai::rpc_handler::block_count, rai::rpc_cost::cheap } },
+		{ "block_count_type", { &rai::rpc_handler::block_count_type, rai::rpc_cost::cheap } },
+		{ "block_create", { &rai::rpc_handler::block_create, rai::rpc_cost::cheap } },
+		{ "block_processor_stats", { &rai::rpc_handler::block_processor_stats, rai::rpc_cost::cheap } },
+		{ "blocks", { &rai::rpc_handler::blocks, rai::rpc_cost::cheap } },
+		{ "blocks_info", { &rai::rpc_handler::blocks_info, rai::rpc_cost::cheap } },
+		{ "bootstrap", { &rai::rpc_handler::bootstrap, rai::rpc_cost::cheap } },
+		{ "bootstrap_any", { &rai::rpc_handler::bootstrap_any, rai::rpc_cost::cheap } },
+		{ "callback_stats", { &rai::rpc_handler::callback_stats, rai::rpc_cost::cheap } },
+		{ "chain", { &rai::rpc_handler::chain, rai::rpc_cost::cheap } },
+		{ "delegators", { &rai::rpc_handler::delegators, rai::rpc_cost::expensive } },
+		{ "delegators_count", { &rai::rpc_handler::delegators_count, rai::rpc_cost::cheap } },
+		{ "deterministic_key", { &rai::rpc_handler::deterministic_key, rai::rpc_cost::cheap } },
+		{ "frontier_count", { &rai::rpc_handler::frontier_count, rai::rpc_cost::cheap } },
+		{ "frontiers", { &rai::rpc_handler::frontiers, rai::rpc_cost::expensive } },
+		{ "history", { history, rai::rpc_cost::expensive } },
+		{ "keepalive", { &rai::rpc_handler::keepalive, rai::rpc_cost::cheap } },
+		{ "key_create", { &rai::rpc_handler::key_create, rai::rpc_cost::cheap } },
+		{ "key_expand", { &rai::rpc_handler::key_expand, rai::rpc_cost::cheap } },
+		{ "krai_from_raw", { &rai::rpc_handler::krai_from_raw, rai::rpc_cost::cheap } },
+		{ "krai_to_raw", { &rai::rpc_handler::krai_to_raw, rai::rpc_cost::cheap } },
+		{ "ledger", { &rai::rpc_handler::ledger, rai::rpc_cost::expensive } },
+		{ "mrai_from_raw", { &rai::rpc_handler::mrai_from_raw, rai::rpc_cost::cheap } },
+		{ "mrai_to_raw", { &rai::rpc_handler::mrai_to_raw, rai::rpc_cost::cheap } },
+		{ "password_change", { processed_before_logging, rai::rpc_cost::cheap } },
+		{ "password_enter", { processed_before_logging, rai::rpc_cost::cheap } },
+		{ "password_valid", { [](rai::rpc_handler & handler_a) { handler_a.password_valid (false); }, rai::rpc_cost::cheap } },
+		{ "payment_begin", { &rai::rpc_handler::payment_begin, rai::rpc_cost::cheap } },
+		{ "payment_end", { &rai::rpc_handler::payment_end, rai::rpc_cost::cheap } },
+		{ "payment_init", { &rai::rpc_handler::payment_init, rai::rpc_cost::cheap } },
+		{ "payment_wait", { &rai::rpc_handler::payment_wait, rai::rpc_cost::cheap } },
+		{ "peers", { &rai::rpc_handler::peers, rai::rpc_cost::cheap } },
+		{ "pending", { &rai::rpc_handler::pending, rai::rpc_cost::cheap } },
+		{ "pending_exists", { &rai::rpc_handler::pending_exists, rai::rpc_cost::cheap } },
+		{ "process", { &rai::rpc_handler::process, rai::rpc_cost::cheap } },
+		{ "rai_from_raw", { &rai::rpc_handler::rai_from_raw, rai::rpc_cost::cheap } },
+		{ "rai_to_raw", { &rai::rpc_handler::rai_to_raw, rai::rpc_cost::cheap } },
+		{ "receive", { &rai::rpc_handler::receive, rai::rpc_cost::cheap } },
+		{ "receive_minimum", { &rai::rpc_handler::receive_minimum, rai::rpc_cost::cheap } },
+		{ "receive_minimum_set", { &rai::rpc_handler::receive_minimum_set, rai::rpc_cost::cheap } },
+		{ "representatives", { &rai::rpc_handler::representatives, rai::rpc_cost::expensive } },
+		{ "republish", { &rai::rpc_handler::republish, rai::rpc_cost::cheap } },
+		{ "rpc_stats", { &rai::rpc_handler::rpc_stats, rai::rpc_cost::cheap } },
+		{ "search_pending", { &rai::rpc_handler::search_pending, rai::rpc_cost::cheap } },
+		{ "search_pending_all", { &rai::rpc_handler::search_pending_all, rai::rpc_cost::expensive } },
+		{ "send", { &rai::rpc_handler::send, rai::rpc_cost::cheap } },
+		{ "stop", { &rai::rpc_handler::stop, rai::rpc_cost::cheap } },
+		{ "successors", { &rai::rpc_handler::successors, rai::rpc_cost::cheap } },
+		{ "unchecked", { &rai::rpc_handler::unchecked, rai::rpc_cost::expensive } },
+		{ "unchecked_clear", { &rai::rpc_handler::unchecked_clear, rai::rpc_cost::cheap } },
+		{ "unchecked_drain_status", { &rai::rpc_handler::unchecked_drain_status, rai::rpc_cost::cheap } },
+		{ "unchecked_get", { &rai::rpc_handler::unchecked_get, rai::rpc_cost::cheap } },
+		{ "unchecked_keys", { &rai::rpc_handler::unchecked_keys, rai::rpc_cost::expensive } },
+		{ "unchecked_stats", { &rai::rpc_handler::unchecked_stats, rai::rpc_cost::cheap } },
+		{ "validate_account_number", { &rai::rpc_handler::validate_account_number, rai::rpc_cost::cheap } },
+		{ "version", { &rai::rpc_handler::version, rai::rpc_cost::cheap } },
+		{ "wallet_action_queue", { &rai::rpc_handler::wallet_action_queue, rai::rpc_cost::cheap } },
+		{ "wallet_add", { &rai::rpc_handler::wallet_add, rai::rpc_cost::cheap } },
+		{ "wallet_add_watch", { &rai::rpc_handler::wallet_add_watch, rai::rpc_cost::cheap } },
+		{ "wallet_balance_total", { &rai::rpc_handler::wallet_balance_total, rai::rpc_cost::expensive } },
+		{ "wallet_balances", { &rai::rpc_handler::wallet_balances, rai::rpc_cost::expensive } },
+		{ "wallet_change_seed", { &rai::rpc_handler::wallet_change_seed, rai::rpc_cost::cheap } },
+		{ "wallet_contains", { &rai::rpc_handler::wallet_contains, rai::rpc_cost::cheap } },
+		{ "wallet_create", { &rai::rpc_handler::wallet_create, rai::rpc_cost::cheap } },
+		{ "wallet_destroy", { &rai::rpc_handler::wallet_destroy, rai::rpc_cost::cheap } },
+		{ "wallet_export", { &rai::rpc_handler::wallet_export, rai::rpc_cost::cheap } },
+		{ "wallet_frontiers", { &rai::rpc_handler::wallet_frontiers, rai::rpc_cost::expensive } },
+		{ "wallet_key_valid", { &rai::rpc_handler::wallet_key_valid, rai::rpc_cost::cheap } },
+		{ "wallet_ledger", { &rai::rpc_handler::wallet_ledger, rai::rpc_cost::expensive } },
+		{ "wallet_lock", { &rai::rpc_handler::wallet_lock, rai::rpc_cost::cheap } },
+		{ "wallet_locked", { [](rai::rpc_handler & handler_a) { handler_a.password_valid (true); }, rai::rpc_cost::cheap } },
+		{ "wallet_pending", { &rai::rpc_handler::wallet_pending, rai::rpc_cost::expensive } },
+		{ "wallet_representative", { &rai::rpc_handler::wallet_representative, rai::rpc_cost::cheap } },
+		{ "wallet_representative_set", { &rai::rpc_handler::wallet_representative_set, rai::rpc_cost::cheap } },
+		{ "wallet_republish", { &rai::rpc_handler::wallet_republish, rai::rpc_cost::expensive } },
+		{ "wallet_unlock", { processed_before_logging, rai::rpc_cost::cheap } },
+		{ "wallet_work_get", { &rai::rpc_handler::wallet_work_get, rai::rpc_cost::cheap } },
+		{ "work_cache_stats", { &rai::rpc_handler::work_cache_stats, rai::rpc_cost::cheap } },
+		{ "work_cancel", { &rai::rpc_handler::work_cancel, rai::rpc_cost::cheap } },
+		{ "work_generate", { &rai::rpc_handler::work_generate, rai::rpc_cost::cheap } },
+		{ "work_get", { &rai::rpc_handler::work_get, rai::rpc_cost::cheap } },
+		{ "work_peer_add", { &rai::rpc_handler::work_peer_add, rai::rpc_cost::cheap } },
+		{ "work_peers", { &rai::rpc_handler::work_peers, rai::rpc_cost::cheap } },
+		{ "work_peers_clear", { &rai::rpc_handler::work_peers_clear, rai::rpc_cost::cheap } },
+		{ "work_set", { &rai::rpc_handler::work_set, rai::rpc_cost::cheap } },
+		{ "work_validate", { &rai::rpc_handler::work_validate, rai::rpc_cost::cheap } }
+	};
+	return actions;
+}
+}
+
+rai::rpc_cost rai::rpc_executor::cost (std::string const & action_a)
+{
+	auto existing (rpc_actions ().find (action_a));
+	return existing != rpc_actions ().end () ? existing->second.cost : rai::rpc_cost::cheap;
+}
+
+rai::rpc_cache_stats::rpc_cache_stats () :
+hits (0),
+misses (0)
+{
+}
+
+namespace
+{
+// Children of objects are ordered by key so equivalent requests produce the same text, lengths are prefixed so values can't run together
+void normalize (boost::property_tree::ptree const & tree_a, std::string & result_a)
+{
+	result_a += std::to_string (tree_a.data ().size ());
+	result_a += ':';
+	result_a += tree_a.data ();
+	if (!tree_a.empty ())
+	{
+		std::vector<std::pair<std::string const *, boost::property_tree::ptree const *>> children;
+		for (auto & i : tree_a)
+		{
+			children.push_back (std::make_pair (&i.first, &i.second));
+		}
+		std::stable_sort (children.begin (), children.end (), [](std::pair<std::string const *, boost::property_tree::ptree const *> const & lhs, std::pair<std::string const *, boost::property_tree::ptree const *> const & rhs) {
+			return *lhs.first < *rhs.first;
+		});
+		result_a += '{';
+		for (auto & i : children)
+		{
+			result_a += std::to_string (i.first->size ());
+			result_a += ':';
+			result_a += *i.first;
+			normalize (*i.second, result_a);
+		}
+		result_a += '}';
+	}
+}
+
+// Read-only actions that may be cached, flagged when the response only depends on the "account" argument
+std::unordered_map<std::string, bool> const & cache_scopes ()
+{
+	static std::unordered_map<std::string, bool> const scopes = {
+		{ "account_balance", true },
+		{ "account_block_count", true },
+		{ "account_info", true },
+		{ "account_representative", true },
+		{ "account_weight", false },
+		{ "available_supply", false },
+		{ "block_count", false },
+		{ "block_count_type", false },
+		{ "delegators_count", false },
+		{ "frontier_count", false },
+		{ "representatives", false }
+	};
+	return scopes;
+}
+}
+
+rai::rpc_cache::rpc_cache (rai::rpc_config const & config_a) :
+generation (0),
+ttl (config_a.cache_ttl),
+max (config_a.cache_max)
+{
+}
+
+bool rai::rpc_cache::cacheable (std::string const & action_a, boost::property_tree::ptree const & request_a, std::string & key_a, boost::optional<rai::account> & account_a)
+{
+	auto scope (cache_scopes ().find (action_a));
+	auto result (scope != cache_scopes ().end () && ttl.find (action_a) != ttl.end ());
+	if (result)
+	{
+		// Weight depends on every account delegating to this one
+		if (scope->second && !request_a.get<bool> ("weight", false))
+		{
+			rai::account account;
+			result = !account.decode_account (request_a.get<std::string> ("account", ""));
+			account_a = account;
+		}
+		key_a.clear ();
+		normalize (request_a, key_a);
+	}
+	return result;
+}
+
+bool rai::rpc_cache::get (std::string const & action_a, std::string const & key_a, boost::property_tree::ptree & response_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (false);
+	auto existing (entries.find (key_a));
+	if (existing != entries.end ())
+	{
+		if (existing->second.expiry > std::chrono::steady_clock::now () && (existing->second.account || existing->second.generation == generation))
+		{
+			response_a = existing->second.response;
+			result = true;
+		}
+		else
+		{
+			if (existing->second.account)
+			{
+				accounts[*existing->second.account].erase (key_a);
+			}
+			entries.erase (existing);
+		}
+	}
+	auto & stats_l (stats[action_a]);
+	result ? ++stats_l.hits : ++stats_l.misses;
+	return result;
+}
+
+void rai::rpc_cache::put (std::string const & action_a, std::string const & key_a, uint64_t generation_a, boost::optional<rai::account> const & account_a, boost::property_tree::ptree const & response_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto ttl_l (ttl.find (action_a));
+	if (generation_a == generation && ttl_l != ttl.end ())
+	{
+		if (entries.size () >= max)
+		{
+			entries.clear ();
+			accounts.clear ();
+		}
+		auto & entry (entries[key_a]);
+		entry.response = response_a;
+		entry.expiry = std::chrono::steady_clock::now () + ttl_l->second;
+		entry.generation = generation_a;
+		entry.account = account_a;
+		if (account_a)
+		{
+			accounts[*account_a].insert (key_a);
+		}
+	}
+}
+
+void rai::rpc_cache::ledger_changed (rai::account const & account_a, rai::account const & pending_account_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	++generation;
+	for (auto & account : { account_a, pending_account_a })
+	{
+		auto existing (accounts.find (account));
+		if (existing != accounts.end ())
+		{
+			for (auto & i : existing->second)
+			{
+				entries.erase (i);
+			}
+			accounts.erase (existing);
+		}
+	}
+}
+
+uint64_t rai::rpc_cache::current ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return generation;
+}
+
 rai::rpc::rpc (boost::asio::io_service & service_a, rai::node & node_a, rai::rpc_config const & config_a) :
 acceptor (service_a),
 config (config_a),
-node (node_a)
+node (node_a),
+executor (config),
+cache (config),
+websocket (std::make_shared<rai::websocket_server> (node_a, config_a.websocket_queue_max, config_a.max_connections)),
+connections (0)
 {
 }
 
@@ -143,7 +598,9 @@ void rai::rpc::start ()
 	acceptor.listen ();
 	node.observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::process_return const & result_a) {
 		observer_action (result_a.account);
+		cache.ledger_changed (result_a.account, result_a.pending_account);
 	});
+	websocket->start ();
 
 	accept ();
 }
@@ -155,7 +612,17 @@ void rai::rpc::accept ()
 		if (!ec)
 		{
 			accept ();
-			connection->parse_connection ();
+			connection->counted = true;
+			if (++connections <= config.max_connections)
+			{
+				connection->parse_connection ();
+			}
+			else
+			{
+				BOOST_LOG (this->node.log) << boost::str (boost::format ("Closing RPC connection, limit of %1% connections reached") % config.max_connections);
+				boost::system::error_code ignored;
+				connection->socket.close (ignored);
+			}
 		}
 		else
 		{
@@ -167,12 +634,14 @@ void rai::rpc::accept ()
 void rai::rpc::stop ()
 {
 	acceptor.close ();
+	websocket->stop ();
 }
 
 rai::rpc_handler::rpc_handler (rai::node & node_a, rai::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
 body (body_a),
 node (node_a),
 rpc (rpc_a),
+arrival (std::chrono::steady_clock::now ()),
 response (response_a)
 {
 }
@@ -201,111 +670,622 @@ void rai::error_response (std::function<void(boost::property_tree::ptree const &
 	response_a (response_l);
 }
 
-namespace
+constexpr size_t rai::json_writer::chunk_size_default;
+constexpr std::chrono::seconds rai::rpc_connection::chunk_timeout;
+
+rai::json_writer::json_writer (std::function<bool(std::string &, bool)> const & sink_a, size_t chunk_size_a) :
+sink (sink_a),
+aborted (false),
+chunk_size (chunk_size_a)
 {
-bool decode_unsigned (std::string const & text, uint64_t & number)
+	buffer.reserve (chunk_size + chunk_size / 4);
+}
+
+void rai::json_writer::begin_object ()
 {
-	bool result;
-	size_t end;
-	try
+	separator ();
+	open.push_back ('{');
+	first.push_back (true);
+}
+
+void rai::json_writer::begin_object (std::string const & key_a)
+{
+	key (key_a);
+	open.push_back ('{');
+	first.push_back (true);
+}
+
+void rai::json_writer::end_object ()
+{
+	close ('}');
+}
+
+void rai::json_writer::begin_array (std::string const & key_a)
+{
+	key (key_a);
+	open.push_back ('[');
+	first.push_back (true);
+}
+
+void rai::json_writer::end_array ()
+{
+	close (']');
+}
+
+void rai::json_writer::close (char close_a)
+{
+	assert (!first.empty ());
+	auto empty (first.back ());
+	first.pop_back ();
+	open.pop_back ();
+	if (!empty)
 	{
-		number = std::stoull (text, &end);
-		result = false;
+		buffer.push_back ('\n');
+		indent (first.size ());
+		buffer.push_back (close_a);
 	}
-	catch (std::invalid_argument const &)
+	else if (!first.empty ())
 	{
-		result = true;
+		// write_json has no empty containers, below the root they're written as an empty string
+		buffer.append ("\"\"");
 	}
-	catch (std::out_of_range const &)
+	else
 	{
-		result = true;
+		buffer.append ("{\n}");
 	}
-	result = result || end != text.size ();
-	return result;
+	flush ();
 }
+
+void rai::json_writer::put (std::string const & key_a, std::string const & value_a)
+{
+	key (key_a);
+	string (value_a);
+	flush ();
 }
 
-void rai::rpc_handler::account_balance ()
+void rai::json_writer::put (std::string const & value_a)
 {
-	std::string account_text (request.get<std::string> ("account"));
-	rai::uint256_union account;
-	auto error (account.decode_account (account_text));
-	if (!error)
-	{
-		auto balance (node.balance_pending (account));
-		boost::property_tree::ptree response_l;
-		response_l.put ("balance", balance.first.convert_to<std::string> ());
-		response_l.put ("pending", balance.second.convert_to<std::string> ());
-		response (response_l);
-	}
-	else
+	separator ();
+	string (value_a);
+	flush ();
+}
+
+void rai::json_writer::put_child (std::string const & key_a, boost::property_tree::ptree const & tree_a)
+{
+	key (key_a);
+	tree (tree_a);
+	flush ();
+}
+
+void rai::json_writer::put_child (boost::property_tree::ptree const & tree_a)
+{
+	separator ();
+	tree (tree_a);
+	flush ();
+}
+
+void rai::json_writer::finish ()
+{
+	assert (first.empty ());
+	buffer.push_back ('\n');
+	if (!aborted)
 	{
-		error_response (response, "Bad account number");
+		aborted = sink (buffer, true);
 	}
+	buffer.clear ();
 }
 
-void rai::rpc_handler::account_block_count ()
+void rai::json_writer::separator ()
 {
-	std::string account_text (request.get<std::string> ("account"));
-	rai::uint256_union account;
-	auto error (account.decode_account (account_text));
-	if (!error)
+	if (!first.empty ())
 	{
-		rai::transaction transaction (node.store.environment, nullptr, false);
-		rai::account_info info;
-		if (!node.store.account_get (transaction, account, info))
+		if (first.back ())
 		{
-			boost::property_tree::ptree response_l;
-			response_l.put ("block_count", std::to_string (info.block_count));
-			response (response_l);
+			// Containers are opened with their first member so empty ones can be written the way write_json does
+			buffer.push_back (open.back ());
 		}
 		else
 		{
-			error_response (response, "Account not found");
+			buffer.push_back (',');
 		}
-	}
-	else
-	{
-		error_response (response, "Bad account number");
+		buffer.push_back ('\n');
+		first.back () = false;
+		indent (first.size ());
 	}
 }
 
-void rai::rpc_handler::account_create ()
+void rai::json_writer::key (std::string const & key_a)
 {
-	if (rpc.config.enable_control)
+	separator ();
+	string (key_a);
+	buffer.append (": ");
+}
+
+void rai::json_writer::indent (size_t depth_a)
+{
+	buffer.append (4 * depth_a, ' ');
+}
+
+void rai::json_writer::string (std::string const & value_a)
+{
+	buffer.push_back ('"');
+	for (auto i : value_a)
 	{
-		std::string wallet_text (request.get<std::string> ("wallet"));
-		rai::uint256_union wallet;
-		auto error (wallet.decode_hex (wallet_text));
-		if (!error)
+		switch (i)
 		{
-			auto existing (node.wallets.items.find (wallet));
-			if (existing != node.wallets.items.end ())
-			{
-				const bool generate_work = request.get<bool> ("work", true);
-				rai::account new_key (existing->second->deterministic_insert (generate_work));
-				if (!new_key.is_zero ())
+			case '"':
+				buffer.append ("\\\"");
+				break;
+			case '\\':
+				buffer.append ("\\\\");
+				break;
+			case '/':
+				buffer.append ("\\/");
+				break;
+			case '\b':
+				buffer.append ("\\b");
+				break;
+			case '\f':
+				buffer.append ("\\f");
+				break;
+			case '\n':
+				buffer.append ("\\n");
+				break;
+			case '\r':
+				buffer.append ("\\r");
+				break;
+			case '\t':
+				buffer.append ("\\t");
+				break;
+			default:
+				if (static_cast<unsigned char> (i) < 0x20)
 				{
-					boost::property_tree::ptree response_l;
-					response_l.put ("account", new_key.to_account ());
-					response (response_l);
+					buffer.append (boost::str (boost::format ("\\u%04X") % static_cast<unsigned> (i)));
 				}
 				else
 				{
-					error_response (response, "Wallet is locked");
+					buffer.push_back (i);
 				}
+				break;
+		}
+	}
+	buffer.push_back ('"');
+}
+
+void rai::json_writer::tree (boost::property_tree::ptree const & tree_a)
+{
+	if (tree_a.empty ())
+	{
+		string (tree_a.data ());
+	}
+	else
+	{
+		// Like write_json, a tree whose children are all unnamed is an array
+		auto array (std::all_of (tree_a.begin (), tree_a.end (), [](boost::property_tree::ptree::value_type const & i) { return i.first.empty (); }));
+		open.push_back (array ? '[' : '{');
+		first.push_back (true);
+		for (auto & i : tree_a)
+		{
+			if (array)
+			{
+				separator ();
 			}
 			else
 			{
-				error_response (response, "Wallet not found");
+				key (i.first);
 			}
+			tree (i.second);
 		}
-		else
-		{
-			error_response (response, "Bad wallet number");
-		}
+		close (array ? ']' : '}');
 	}
-	else
+}
+
+void rai::json_writer::flush ()
+{
+	if (buffer.size () >= chunk_size)
+	{
+		if (!aborted)
+		{
+			aborted = sink (buffer, false);
+		}
+		buffer.clear ();
+	}
+}
+
+namespace
+{
+class json_parser
+{
+public:
+	json_parser (std::string const & text_a) :
+	text (text_a),
+	position (0)
+	{
+	}
+	bool parse (boost::property_tree::ptree & tree_a)
+	{
+		auto result (value (tree_a));
+		whitespace ();
+		return result || position != text.size ();
+	}
+	bool value (boost::property_tree::ptree & tree_a)
+	{
+		auto result (false);
+		whitespace ();
+		if (position < text.size ())
+		{
+			switch (text[position])
+			{
+				case '{':
+					result = object (tree_a);
+					break;
+				case '[':
+					result = array (tree_a);
+					break;
+				case '"':
+					result = string (tree_a.data ());
+					break;
+				default:
+					result = literal (tree_a.data ());
+					break;
+			}
+		}
+		else
+		{
+			result = true;
+		}
+		return result;
+	}
+	bool object (boost::property_tree::ptree & tree_a)
+	{
+		++position;
+		whitespace ();
+		auto result (false);
+		if (!consume ('}'))
+		{
+			auto done (false);
+			while (!result && !done)
+			{
+				whitespace ();
+				std::string key;
+				result = position >= text.size () || text[position] != '"' || string (key);
+				if (!result)
+				{
+					whitespace ();
+					result = !consume (':');
+					if (!result)
+					{
+						auto & child (tree_a.push_back (std::make_pair (key, boost::property_tree::ptree ()))->second);
+						result = value (child);
+						if (!result)
+						{
+							whitespace ();
+							if (!consume (','))
+							{
+								result = !consume ('}');
+								done = true;
+							}
+						}
+					}
+				}
+			}
+		}
+		return result;
+	}
+	bool array (boost::property_tree::ptree & tree_a)
+	{
+		++position;
+		whitespace ();
+		auto result (false);
+		if (!consume (']'))
+		{
+			auto done (false);
+			while (!result && !done)
+			{
+				auto & child (tree_a.push_back (std::make_pair (std::string (), boost::property_tree::ptree ()))->second);
+				result = value (child);
+				if (!result)
+				{
+					whitespace ();
+					if (!consume (','))
+					{
+						result = !consume (']');
+						done = true;
+					}
+				}
+			}
+		}
+		return result;
+	}
+	bool string (std::string & result_a)
+	{
+		++position;
+		auto result (false);
+		auto done (false);
+		while (!result && !done)
+		{
+			// Copy runs without escapes in one step
+			auto begin (position);
+			while (position < text.size () && text[position] != '"' && text[position] != '\\' && static_cast<unsigned char> (text[position]) >= 0x20)
+			{
+				++position;
+			}
+			result_a.append (text, begin, position - begin);
+			if (position >= text.size () || static_cast<unsigned char> (text[position]) < 0x20)
+			{
+				result = true;
+			}
+			else if (text[position] == '"')
+			{
+				++position;
+				done = true;
+			}
+			else
+			{
+				result = escape (result_a);
+			}
+		}
+		return result;
+	}
+	bool escape (std::string & result_a)
+	{
+		++position;
+		auto result (position >= text.size ());
+		if (!result)
+		{
+			switch (text[position++])
+			{
+				case '"':
+					result_a.push_back ('"');
+					break;
+				case '\\':
+					result_a.push_back ('\\');
+					break;
+				case '/':
+					result_a.push_back ('/');
+					break;
+				case 'b':
+					result_a.push_back ('\b');
+					break;
+				case 'f':
+					result_a.push_back ('\f');
+					break;
+				case 'n':
+					result_a.push_back ('\n');
+					break;
+				case 'r':
+					result_a.push_back ('\r');
+					break;
+				case 't':
+					result_a.push_back ('\t');
+					break;
+				case 'u':
+				{
+					unsigned code;
+					result = hex (code);
+					if (!result && code >= 0xd800 && code < 0xdc00)
+					{
+						unsigned low;
+						result = !consume ('\\') || !consume ('u') || hex (low) || low < 0xdc00 || low >= 0xe000;
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					}
+					if (!result)
+					{
+						utf8 (code, result_a);
+					}
+					break;
+				}
+				default:
+					result = true;
+					break;
+			}
+		}
+		return result;
+	}
+	bool hex (unsigned & code_a)
+	{
+		auto result (position + 4 > text.size ());
+		code_a = 0;
+		for (auto i (0); i < 4 && !result; ++i)
+		{
+			auto digit (text[position++]);
+			code_a <<= 4;
+			if (digit >= '0' && digit <= '9')
+			{
+				code_a |= digit - '0';
+			}
+			else if (digit >= 'a' && digit <= 'f')
+			{
+				code_a |= digit - 'a' + 10;
+			}
+			else if (digit >= 'A' && digit <= 'F')
+			{
+				code_a |= digit - 'A' + 10;
+			}
+			else
+			{
+				result = true;
+			}
+		}
+		return result;
+	}
+	void utf8 (unsigned code_a, std::string & result_a)
+	{
+		if (code_a < 0x80)
+		{
+			result_a.push_back (static_cast<char> (code_a));
+		}
+		else if (code_a < 0x800)
+		{
+			result_a.push_back (static_cast<char> (0xc0 | (code_a >> 6)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+		else if (code_a < 0x10000)
+		{
+			result_a.push_back (static_cast<char> (0xe0 | (code_a >> 12)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 6) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+		else
+		{
+			result_a.push_back (static_cast<char> (0xf0 | (code_a >> 18)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 12) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 6) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+	}
+	// Numbers, true, false and null are kept as their text like read_json does
+	bool literal (std::string & result_a)
+	{
+		auto begin (position);
+		while (position < text.size () && (std::isalnum (static_cast<unsigned char> (text[position])) || text[position] == '-' || text[position] == '+' || text[position] == '.'))
+		{
+			++position;
+		}
+		result_a.assign (text, begin, position - begin);
+		auto result (result_a.empty ());
+		if (!result && result_a != "true" && result_a != "false" && result_a != "null")
+		{
+			result = result_a[0] != '-' && !std::isdigit (static_cast<unsigned char> (result_a[0]));
+			for (auto i (result_a.begin ()), n (result_a.end ()); i != n && !result; ++i)
+			{
+				result = !std::isdigit (static_cast<unsigned char> (*i)) && *i != '-' && *i != '+' && *i != '.' && *i != 'e' && *i != 'E';
+			}
+		}
+		return result;
+	}
+	void whitespace ()
+	{
+		while (position < text.size () && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+		{
+			++position;
+		}
+	}
+	bool consume (char char_a)
+	{
+		auto result (position < text.size () && text[position] == char_a);
+		if (result)
+		{
+			++position;
+		}
+		return result;
+	}
+	std::string const & text;
+	size_t position;
+};
+}
+
+bool rai::parse_json (std::string const & text_a, boost::property_tree::ptree & tree_a)
+{
+	json_parser parser (text_a);
+	return parser.parse (tree_a);
+}
+
+namespace
+{
+bool decode_unsigned (std::string const & text, uint64_t & number)
+{
+	bool result;
+	size_t end;
+	try
+	{
+		number = std::stoull (text, &end);
+		result = false;
+	}
+	catch (std::invalid_argument const &)
+	{
+		result = true;
+	}
+	catch (std::out_of_range const &)
+	{
+		result = true;
+	}
+	result = result || end != text.size ();
+	return result;
+}
+}
+
+void rai::rpc_handler::account_balance ()
+{
+	std::string account_text (request.get<std::string> ("account"));
+	rai::uint256_union account;
+	auto error (account.decode_account (account_text));
+	if (!error)
+	{
+		auto balance (node.balance_pending (account));
+		boost::property_tree::ptree response_l;
+		response_l.put ("balance", balance.first.convert_to<std::string> ());
+		response_l.put ("pending", balance.second.convert_to<std::string> ());
+		response (response_l);
+	}
+	else
+	{
+		error_response (response, "Bad account number");
+	}
+}
+
+void rai::rpc_handler::account_block_count ()
+{
+	std::string account_text (request.get<std::string> ("account"));
+	rai::uint256_union account;
+	auto error (account.decode_account (account_text));
+	if (!error)
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		rai::account_info info;
+		if (!node.store.account_get (transaction, account, info))
+		{
+			boost::property_tree::ptree response_l;
+			response_l.put ("block_count", std::to_string (info.block_count));
+			response (response_l);
+		}
+		else
+		{
+			error_response (response, "Account not found");
+		}
+	}
+	else
+	{
+		error_response (response, "Bad account number");
+	}
+}
+
+void rai::rpc_handler::account_create ()
+{
+	if (rpc.config.enable_control)
+	{
+		std::string wallet_text (request.get<std::string> ("wallet"));
+		rai::uint256_union wallet;
+		auto error (wallet.decode_hex (wallet_text));
+		if (!error)
+		{
+			auto existing (node.wallets.items.find (wallet));
+			if (existing != node.wallets.items.end ())
+			{
+				const bool generate_work = request.get<bool> ("work", true);
+				rai::account new_key (existing->second->deterministic_insert (generate_work));
+				if (!new_key.is_zero ())
+				{
+					boost::property_tree::ptree response_l;
+					response_l.put ("account", new_key.to_account ());
+					response (response_l);
+				}
+				else
+				{
+					error_response (response, "Wallet is locked");
+				}
+			}
+			else
+			{
+				error_response (response, "Wallet not found");
+			}
+		}
+		else
+		{
+			error_response (response, "Bad wallet number");
+		}
+	}
+	else
 	{
 		error_response (response, "RPC control is disabled");
 	}
@@ -364,8 +1344,9 @@ void rai::rpc_handler::account_info ()
 			}
 			if (pending)
 			{
-				auto account_pending (node.ledger.account_pending (transaction, account));
-				response_l.put ("pending", account_pending.convert_to<std::string> ());
+				auto summary (node.store.pending_summary_get (transaction, account));
+				response_l.put ("pending", summary.amount.number ().convert_to<std::string> ());
+				response_l.put ("pending_count", std::to_string (summary.count));
 			}
 			response (response_l);
 		}
@@ -859,6 +1840,32 @@ void rai::rpc_handler::accounts_pending ()
 	response (response_l);
 }
 
+void rai::rpc_handler::active_stats ()
+{
+	boost::property_tree::ptree response_l;
+	{
+		std::lock_guard<std::mutex> lock (node.active.mutex);
+		response_l.put ("active", std::to_string (node.active.roots.size ()));
+		response_l.put ("finished", std::to_string (node.active.elections_finished));
+		response_l.put ("elections_per_second", std::to_string (node.active.elections_rate));
+		boost::property_tree::ptree durations;
+		for (auto i (0); i < node.active.durations.size (); ++i)
+		{
+			auto label (i + 1 < node.active.durations.size () ? "<" + std::to_string (1 << i) + "s" : ">=" + std::to_string (1 << (i - 1)) + "s");
+			durations.put (label, std::to_string (node.active.durations[i]));
+		}
+		response_l.add_child ("durations", durations);
+	}
+	{
+		std::lock_guard<std::mutex> lock (node.request_aggregator.mutex);
+		response_l.put ("confirm_req_requested", std::to_string (node.request_aggregator.requested));
+		response_l.put ("confirm_req_messages", std::to_string (node.request_aggregator.messages));
+	}
+	response_l.put ("confirm_req_dropped_unknown", std::to_string (node.network.confirm_req_unknown));
+	response_l.put ("confirm_req_dropped_limited", std::to_string (node.network.confirm_req_limited));
+	response (response_l);
+}
+
 void rai::rpc_handler::available_supply ()
 {
 	auto genesis_balance (node.balance (rai::genesis_account)); // Cold storage genesis
@@ -1394,6 +2401,18 @@ void rai::rpc_handler::bootstrap ()
 	}
 }
 
+void rai::rpc_handler::block_processor_stats ()
+{
+	boost::property_tree::ptree response_l;
+	response_l.put ("queued", std::to_string (node.block_processor.size ()));
+	response_l.put ("batches", std::to_string (node.block_processor.batches));
+	uint64_t transactions (node.store.environment.write_transactions);
+	uint64_t wait (node.store.environment.write_wait);
+	response_l.put ("write_transactions", std::to_string (transactions));
+	response_l.put ("write_wait_average", std::to_string (transactions > 0 ? wait / transactions : 0));
+	response (response_l);
+}
+
 void rai::rpc_handler::bootstrap_any ()
 {
 	node.bootstrap_initiator.bootstrap ();
@@ -1402,6 +2421,24 @@ void rai::rpc_handler::bootstrap_any ()
 	response (response_l);
 }
 
+void rai::rpc_handler::callback_stats ()
+{
+	boost::property_tree::ptree response_l;
+	{
+		std::lock_guard<std::mutex> lock (node.callback.mutex);
+		response_l.put ("queued", std::to_string (node.callback.queue.size ()));
+		response_l.put ("connections", std::to_string (node.callback.connections));
+		response_l.put ("delivered", std::to_string (node.callback.delivered));
+		response_l.put ("batches", std::to_string (node.callback.batches));
+		response_l.put ("failed", std::to_string (node.callback.failed));
+		response_l.put ("dropped", std::to_string (node.callback.dropped));
+		response_l.put ("retries", std::to_string (node.callback.retries));
+		response_l.put ("latency_average", std::to_string (node.callback.delivered > 0 ? node.callback.latency_total.count () / node.callback.delivered : 0));
+		response_l.put ("latency_max", std::to_string (node.callback.latency_max.count ()));
+	}
+	response (response_l);
+}
+
 void rai::rpc_handler::chain ()
 {
 	std::string block_text (request.get<std::string> ("block"));
@@ -1454,17 +2491,15 @@ void rai::rpc_handler::delegators ()
 		boost::property_tree::ptree response_l;
 		boost::property_tree::ptree delegators;
 		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
+		for (auto i (node.store.delegators_begin (transaction, account)), n (node.store.delegators_end ()); i != n; i.next_dup ())
 		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
-			{
-				std::string balance;
-				rai::uint128_union (info.balance).encode_dec (balance);
-				delegators.put (rai::account (i->first.uint256 ()).to_account (), balance);
-			}
+			rai::account delegator (i->second.uint256 ());
+			rai::account_info info;
+			auto error (node.store.account_get (transaction, delegator, info));
+			assert (!error);
+			std::string balance;
+			rai::uint128_union (info.balance).encode_dec (balance);
+			delegators.put (delegator.to_account (), balance);
 		}
 		response_l.add_child ("delegators", delegators);
 		response (response_l);
@@ -1482,18 +2517,8 @@ void rai::rpc_handler::delegators_count ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		uint64_t count (0);
 		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
-		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
-			{
-				++count;
-			}
-		}
+		auto count (node.store.delegators_count (transaction, account));
 		boost::property_tree::ptree response_l;
 		response_l.put ("count", std::to_string (count));
 		response (response_l);
@@ -1551,15 +2576,18 @@ void rai::rpc_handler::frontiers ()
 		uint64_t count;
 		if (!decode_unsigned (count_text, count))
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree frontiers;
+			auto writer (stream ());
+			writer->begin_object ();
+			writer->begin_object ("frontiers");
+			uint64_t written (0);
 			rai::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && frontiers.size () < count; ++i)
+			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && written < count && !writer->aborted; ++i, ++written)
 			{
-				frontiers.put (rai::account (i->first.uint256 ()).to_account (), rai::account_info (i->second).head.to_string ());
+				writer->put (rai::account (i->first.uint256 ()).to_account (), rai::account_info (i->second).head.to_string ());
 			}
-			response_l.add_child ("frontiers", frontiers);
-			response (response_l);
+			writer->end_object ();
+			writer->end_object ();
+			writer->finish ();
 		}
 		else
 		{
@@ -1747,12 +2775,13 @@ void rai::rpc_handler::account_history ()
 			auto offset_text (request.get_optional<std::string> ("offset"));
 			if (!offset_text || !decode_unsigned (*offset_text, offset))
 			{
-				boost::property_tree::ptree response_l;
-				boost::property_tree::ptree history;
 				if (!error)
 				{
+					auto writer (stream ());
+					writer->begin_object ();
+					writer->begin_array ("history");
 					auto block (node.store.block_get (transaction, hash));
-					while (block != nullptr && count > 0)
+					while (block != nullptr && count > 0 && !writer->aborted)
 					{
 						if (offset > 0)
 						{
@@ -1766,19 +2795,20 @@ void rai::rpc_handler::account_history ()
 							if (!entry.empty ())
 							{
 								entry.put ("hash", hash.to_string ());
-								history.push_back (std::make_pair ("", entry));
+								writer->put_child (entry);
 							}
 							--count;
 						}
 						hash = block->previous ();
 						block = node.store.block_get (transaction, hash);
 					}
-					response_l.add_child ("history", history);
+					writer->end_array ();
 					if (!hash.is_zero ())
 					{
-						response_l.put ("previous", hash.to_string ());
+						writer->put ("previous", hash.to_string ());
 					}
-					response (response_l);
+					writer->end_object ();
+					writer->finish ();
 				}
 				else
 				{
@@ -1856,125 +2886,126 @@ void rai::rpc_handler::ledger ()
 {
 	if (rpc.config.enable_control)
 	{
+		auto error (false);
 		rai::account start (0);
 		uint64_t count (std::numeric_limits<uint64_t>::max ());
 		boost::optional<std::string> account_text (request.get_optional<std::string> ("account"));
 		if (account_text.is_initialized ())
 		{
-			auto error (start.decode_account (account_text.get ()));
+			error = start.decode_account (account_text.get ());
 			if (error)
 			{
 				error_response (response, "Invalid starting account");
 			}
 		}
 		boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
-		if (count_text.is_initialized ())
+		if (!error && count_text.is_initialized ())
 		{
-			auto error_count (decode_unsigned (count_text.get (), count));
-			if (error_count)
+			error = decode_unsigned (count_text.get (), count);
+			if (error)
 			{
 				error_response (response, "Invalid count limit");
 			}
 		}
-		uint64_t modified_since (0);
-		boost::optional<std::string> modified_since_text (request.get_optional<std::string> ("modified_since"));
-		if (modified_since_text.is_initialized ())
-		{
-			modified_since = strtoul (modified_since_text.get ().c_str (), NULL, 10);
-		}
-		const bool sorting = request.get<bool> ("sorting", false);
-		const bool representative = request.get<bool> ("representative", false);
-		const bool weight = request.get<bool> ("weight", false);
-		const bool pending = request.get<bool> ("pending", false);
-		boost::property_tree::ptree response_a;
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree accounts;
-		rai::transaction transaction (node.store.environment, nullptr, false);
-		if (!sorting) // Simple
+		if (!error)
 		{
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && accounts.size () < count; ++i)
+			uint64_t modified_since (0);
+			boost::optional<std::string> modified_since_text (request.get_optional<std::string> ("modified_since"));
+			if (modified_since_text.is_initialized ())
 			{
-				rai::account_info info (i->second);
-				if (info.modified >= modified_since)
+				modified_since = strtoul (modified_since_text.get ().c_str (), NULL, 10);
+			}
+			const bool sorting = request.get<bool> ("sorting", false);
+			const bool representative = request.get<bool> ("representative", false);
+			const bool weight = request.get<bool> ("weight", false);
+			const bool pending = request.get<bool> ("pending", false);
+			auto writer (stream ());
+			writer->begin_object ();
+			writer->begin_object ("accounts");
+			uint64_t written (0);
+			rai::transaction transaction (node.store.environment, nullptr, false);
+			auto write_account ([&](rai::account const & account_a, rai::account_info const & info_a) {
+				writer->begin_object (account_a.to_account ());
+				writer->put ("frontier", info_a.head.to_string ());
+				writer->put ("open_block", info_a.open_block.to_string ());
+				writer->put ("representative_block", info_a.rep_block.to_string ());
+				std::string balance;
+				rai::uint128_union (info_a.balance).encode_dec (balance);
+				writer->put ("balance", balance);
+				writer->put ("modified_timestamp", std::to_string (info_a.modified));
+				writer->put ("block_count", std::to_string (info_a.block_count));
+				if (representative)
 				{
-					rai::account account (i->first.uint256 ());
-					boost::property_tree::ptree response_l;
-					response_l.put ("frontier", info.head.to_string ());
-					response_l.put ("open_block", info.open_block.to_string ());
-					response_l.put ("representative_block", info.rep_block.to_string ());
-					std::string balance;
-					rai::uint128_union (info.balance).encode_dec (balance);
-					response_l.put ("balance", balance);
-					response_l.put ("modified_timestamp", std::to_string (info.modified));
-					response_l.put ("block_count", std::to_string (info.block_count));
-					if (representative)
-					{
-						auto block (node.store.block_get (transaction, info.rep_block));
-						assert (block != nullptr);
-						response_l.put ("representative", block->representative ().to_account ());
-					}
-					if (weight)
-					{
-						auto account_weight (node.ledger.weight (transaction, account));
-						response_l.put ("weight", account_weight.convert_to<std::string> ());
-					}
-					if (pending)
+					auto block (node.store.block_get (transaction, info_a.rep_block));
+					assert (block != nullptr);
+					writer->put ("representative", block->representative ().to_account ());
+				}
+				if (weight)
+				{
+					auto account_weight (node.ledger.weight (transaction, account_a));
+					writer->put ("weight", account_weight.convert_to<std::string> ());
+				}
+				if (pending)
+				{
+					auto account_pending (node.ledger.account_pending (transaction, account_a));
+					writer->put ("pending", account_pending.convert_to<std::string> ());
+				}
+				writer->end_object ();
+				++written;
+			});
+			if (!sorting) // Simple
+			{
+				for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && written < count && !writer->aborted; ++i)
+				{
+					rai::account_info info (i->second);
+					if (info.modified >= modified_since)
 					{
-						auto account_pending (node.ledger.account_pending (transaction, account));
-						response_l.put ("pending", account_pending.convert_to<std::string> ());
+						write_account (rai::account (i->first.uint256 ()), info);
 					}
-					accounts.push_back (std::make_pair (account.to_account (), response_l));
 				}
 			}
-		}
-		else // Sorting
-		{
-			std::vector<std::pair<rai::uint128_union, rai::account>> ledger_l;
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
+			else if (node.store.sorted_indexes) // Sorting with the balance index
 			{
-				rai::account_info info (i->second);
-				rai::uint128_union balance (info.balance);
-				if (info.modified >= modified_since)
+				rai::account_info info;
+				for (auto i (node.store.balances_begin (transaction)), n (node.store.balances_end ()); i != n && written < count && !writer->aborted; ++i)
 				{
-					ledger_l.push_back (std::make_pair (balance, rai::account (i->first.uint256 ())));
+					rai::amount_key key (i->first);
+					if (!(key.account < start))
+					{
+						auto error (node.store.account_get (transaction, key.account, info));
+						assert (!error);
+						if (info.modified >= modified_since)
+						{
+							write_account (key.account, info);
+						}
+					}
 				}
 			}
-			std::sort (ledger_l.begin (), ledger_l.end ());
-			std::reverse (ledger_l.begin (), ledger_l.end ());
-			rai::account_info info;
-			for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && accounts.size () < count; ++i)
+			else // Sorting
 			{
-				node.store.account_get (transaction, i->second, info);
-				rai::account account (i->second);
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
-				std::string balance;
-				(i->first).encode_dec (balance);
-				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
-				if (representative)
-				{
-					auto block (node.store.block_get (transaction, info.rep_block));
-					assert (block != nullptr);
-					response_l.put ("representative", block->representative ().to_account ());
-				}
-				if (weight)
+				std::vector<std::pair<rai::uint128_union, rai::account>> ledger_l;
+				for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
 				{
-					auto account_weight (node.ledger.weight (transaction, account));
-					response_l.put ("weight", account_weight.convert_to<std::string> ());
+					rai::account_info info (i->second);
+					rai::uint128_union balance (info.balance);
+					if (info.modified >= modified_since)
+					{
+						ledger_l.push_back (std::make_pair (balance, rai::account (i->first.uint256 ())));
+					}
 				}
-				if (pending)
+				std::sort (ledger_l.begin (), ledger_l.end ());
+				std::reverse (ledger_l.begin (), ledger_l.end ());
+				rai::account_info info;
+				for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && written < count && !writer->aborted; ++i)
 				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
-					response_l.put ("pending", account_pending.convert_to<std::string> ());
+					node.store.account_get (transaction, i->second, info);
+					write_account (i->second, info);
 				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
 			}
+			writer->end_object ();
+			writer->end_object ();
+			writer->finish ();
 		}
-		response_a.add_child ("accounts", accounts);
-		response (response_a);
 	}
 	else
 	{
@@ -2487,77 +3518,79 @@ void rai::rpc_handler::process ()
 			node.block_arrival.add (hash);
 			rai::process_return result;
 			std::shared_ptr<rai::block> block_a (std::move (block));
+			if (!node.block_processor.process_one (rai::block_processor_item (block_a), result))
 			{
-				rai::transaction transaction (node.store.environment, nullptr, true);
-				result = node.block_processor.process_receive_one (transaction, block_a);
-			}
-			switch (result.code)
-			{
-				case rai::process_result::progress:
-				{
-					node.observers.blocks (block_a, result);
-					boost::property_tree::ptree response_l;
-					response_l.put ("hash", hash.to_string ());
-					response (response_l);
-					break;
-				}
-				case rai::process_result::gap_previous:
-				{
-					error_response (response, "Gap previous block");
-					break;
-				}
-				case rai::process_result::gap_source:
-				{
-					error_response (response, "Gap source block");
-					break;
-				}
-				case rai::process_result::state_block_disabled:
-				{
-					error_response (response, "State blocks are disabled");
-					break;
-				}
-				case rai::process_result::old:
-				{
-					error_response (response, "Old block");
-					break;
-				}
-				case rai::process_result::bad_signature:
-				{
-					error_response (response, "Bad signature");
-					break;
-				}
-				case rai::process_result::negative_spend:
-				{
-					// TODO once we get RPC versioning, this should be changed to "negative spend"
-					error_response (response, "Overspend");
-					break;
-				}
-				case rai::process_result::unreceivable:
-				{
-					error_response (response, "Unreceivable");
-					break;
-				}
-				case rai::process_result::not_receive_from_send:
+				switch (result.code)
 				{
-					error_response (response, "Not receive from send");
-					break;
-				}
-				case rai::process_result::fork:
-				{
-					error_response (response, "Fork");
-					break;
-				}
-				case rai::process_result::account_mismatch:
-				{
-					error_response (response, "Account mismatch");
-					break;
-				}
-				default:
-				{
-					error_response (response, "Error processing block");
-					break;
+					case rai::process_result::progress:
+					{
+						boost::property_tree::ptree response_l;
+						response_l.put ("hash", hash.to_string ());
+						response (response_l);
+						break;
+					}
+					case rai::process_result::gap_previous:
+					{
+						error_response (response, "Gap previous block");
+						break;
+					}
+					case rai::process_result::gap_source:
+					{
+						error_response (response, "Gap source block");
+						break;
+					}
+					case rai::process_result::state_block_disabled:
+					{
+						error_response (response, "State blocks are disabled");
+						break;
+					}
+					case rai::process_result::old:
+					{
+						error_response (response, "Old block");
+						break;
+					}
+					case rai::process_result::bad_signature:
+					{
+						error_response (response, "Bad signature");
+						break;
+					}
+					case rai::process_result::negative_spend:
+					{
+						// TODO once we get RPC versioning, this should be changed to "negative spend"
+						error_response (response, "Overspend");
+						break;
+					}
+					case rai::process_result::unreceivable:
+					{
+						error_response (response, "Unreceivable");
+						break;
+					}
+					case rai::process_result::not_receive_from_send:
+					{
+						error_response (response, "Not receive from send");
+						break;
+					}
+					case rai::process_result::fork:
+					{
+						error_response (response, "Fork");
+						break;
+					}
+					case rai::process_result::account_mismatch:
+					{
+						error_response (response, "Account mismatch");
+						break;
+					}
+					default:
+					{
+						error_response (response, "Error processing block");
+						break;
+					}
 				}
 			}
+			else
+			{
+				error_response (response, "Node is stopping");
+			}
 		}
 		else
 		{
@@ -2779,32 +3812,54 @@ void rai::rpc_handler::representatives ()
 		}
 	}
 	const bool sorting = request.get<bool> ("sorting", false);
+	const bool delegators = request.get<bool> ("delegators", false);
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree representatives;
 	rai::transaction transaction (node.store.environment, nullptr, false);
+	auto put ([&](rai::account const & account_a, rai::uint128_t const & amount_a) {
+		if (!delegators)
+		{
+			representatives.put (account_a.to_account (), amount_a.convert_to<std::string> ());
+		}
+		else
+		{
+			boost::property_tree::ptree entry;
+			entry.put ("weight", amount_a.convert_to<std::string> ());
+			entry.put ("delegators", std::to_string (node.store.delegators_count (transaction, account_a)));
+			representatives.push_back (std::make_pair (account_a.to_account (), entry));
+		}
+	});
 	if (!sorting) // Simple
 	{
 		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n && representatives.size () < count; ++i)
 		{
 			rai::account account (i->first.uint256 ());
 			auto amount (node.store.representation_get (transaction, account));
-			representatives.put (account.to_account (), amount.convert_to<std::string> ());
+			put (account, amount);
+		}
+	}
+	else if (node.store.sorted_indexes) // Sorting with the weight index
+	{
+		for (auto i (node.store.weights_begin (transaction)), n (node.store.weights_end ()); i != n && representatives.size () < count; ++i)
+		{
+			rai::amount_key key (i->first);
+			put (key.account, key.amount ().number ());
 		}
 	}
 	else // Sorting
 	{
-		std::vector<std::pair<rai::uint128_union, std::string>> representation;
+		std::vector<std::pair<rai::uint128_union, rai::account>> representation;
 		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n; ++i)
 		{
 			rai::account account (i->first.uint256 ());
 			auto amount (node.store.representation_get (transaction, account));
-			representation.push_back (std::make_pair (amount, account.to_account ()));
+			representation.push_back (std::make_pair (amount, account));
 		}
 		std::sort (representation.begin (), representation.end ());
 		std::reverse (representation.begin (), representation.end ());
 		for (auto i (representation.begin ()), n (representation.end ()); i != n && representatives.size () < count; ++i)
 		{
-			representatives.put (i->second, (i->first).number ().convert_to<std::string> ());
+			put (i->second, i->first.number ());
 		}
 	}
 	response_l.add_child ("representatives", representatives);
@@ -2935,6 +3990,53 @@ void rai::rpc_handler::republish ()
 	}
 }
 
+void rai::rpc_handler::rpc_stats ()
+{
+	boost::property_tree::ptree response_l;
+	boost::property_tree::ptree actions;
+	{
+		std::lock_guard<std::mutex> lock (rpc.executor.mutex);
+		response_l.put ("threads", std::to_string (rpc.executor.threads.size ()));
+		response_l.put ("cheap_queued", std::to_string (rpc.executor.cheap.size ()));
+		response_l.put ("expensive_queued", std::to_string (rpc.executor.expensive.size ()));
+		response_l.put ("expensive_active", std::to_string (rpc.executor.expensive_active));
+		response_l.put ("rejected", std::to_string (rpc.executor.rejected));
+		for (auto & i : rpc.executor.stats)
+		{
+			boost::property_tree::ptree entry;
+			entry.put ("count", std::to_string (i.second.count));
+			entry.put ("queue_wait_average", std::to_string (i.second.queue_wait.count () / i.second.count));
+			entry.put ("queue_wait_max", std::to_string (i.second.queue_wait_max.count ()));
+			entry.put ("execution_average", std::to_string (i.second.execution.count () / i.second.count));
+			entry.put ("execution_max", std::to_string (i.second.execution_max.count ()));
+			actions.add_child (i.first, entry);
+		}
+	}
+	response_l.add_child ("actions", actions);
+	boost::property_tree::ptree cache;
+	{
+		std::lock_guard<std::mutex> lock (rpc.cache.mutex);
+		cache.put ("entries", std::to_string (rpc.cache.entries.size ()));
+		for (auto & i : rpc.cache.stats)
+		{
+			boost::property_tree::ptree entry;
+			entry.put ("hits", std::to_string (i.second.hits));
+			entry.put ("misses", std::to_string (i.second.misses));
+			cache.add_child (i.first, entry);
+		}
+	}
+	response_l.add_child ("cache", cache);
+	boost::property_tree::ptree websocket;
+	{
+		std::lock_guard<std::mutex> lock (rpc.websocket->mutex);
+		websocket.put ("sessions", std::to_string (rpc.websocket->sessions.size ()));
+	}
+	websocket.put ("sent", std::to_string (rpc.websocket->sent));
+	websocket.put ("dropped", std::to_string (rpc.websocket->dropped));
+	response_l.add_child ("websocket", websocket);
+	response (response_l);
+}
+
 void rai::rpc_handler::search_pending ()
 {
 	if (rpc.config.enable_control)
@@ -3115,28 +4217,35 @@ void rai::rpc_handler::stop ()
 void rai::rpc_handler::unchecked ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree unchecked;
-	rai::transaction transaction (node.store.environment, nullptr, false);
-	for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
+	if (!error)
 	{
-		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (rai::deserialize_block (stream));
-		std::string contents;
-		block->serialize_json (contents);
-		unchecked.put (block->hash ().to_string (), contents);
+		auto writer (stream ());
+		writer->begin_object ();
+		writer->begin_object ("blocks");
+		uint64_t written (0);
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && written < count && !writer->aborted; ++i, ++written)
+		{
+			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+			auto block (rai::deserialize_block (stream));
+			std::string contents;
+			block->serialize_json (contents);
+			writer->put (block->hash ().to_string (), contents);
+		}
+		writer->end_object ();
+		writer->end_object ();
+		writer->finish ();
 	}
-	response_l.add_child ("blocks", unchecked);
-	response (response_l);
 }
 
 void rai::rpc_handler::unchecked_clear ()
@@ -3155,6 +4264,20 @@ void rai::rpc_handler::unchecked_clear ()
 	}
 }
 
+void rai::rpc_handler::unchecked_drain_status ()
+{
+	auto & drainer (node.block_processor.drainer);
+	boost::property_tree::ptree response_l;
+	response_l.put ("batches", std::to_string (drainer.batches));
+	response_l.put ("collected", std::to_string (drainer.collected));
+	response_l.put ("verified", std::to_string (drainer.verified));
+	response_l.put ("unverified", std::to_string (drainer.unverified));
+	response_l.put ("rejected", std::to_string (drainer.rejected));
+	rai::transaction transaction (node.store.environment, nullptr, false);
+	response_l.put ("unchecked", std::to_string (node.store.unchecked_count (transaction)));
+	response (response_l);
+}
+
 void rai::rpc_handler::unchecked_get ()
 {
 	std::string hash_text (request.get<std::string> ("hash"));
@@ -3232,6 +4355,19 @@ void rai::rpc_handler::unchecked_keys ()
 	response (response_l);
 }
 
+void rai::rpc_handler::unchecked_stats ()
+{
+	boost::property_tree::ptree response_l;
+	{
+		std::lock_guard<std::mutex> lock (node.store.cache_mutex);
+		response_l.put ("count", std::to_string (node.store.unchecked_index.entries.size ()));
+		response_l.put ("bytes", std::to_string (node.store.unchecked_index.bytes));
+		response_l.put ("evictions", std::to_string (node.store.unchecked_index.evictions));
+		response_l.put ("cached", std::to_string (node.store.unchecked_cache.size ()));
+	}
+	response (response_l);
+}
+
 void rai::rpc_handler::version ()
 {
 	boost::property_tree::ptree response_l;
@@ -3251,6 +4387,21 @@ void rai::rpc_handler::validate_account_number ()
 	response (response_l);
 }
 
+void rai::rpc_handler::wallet_action_queue ()
+{
+	boost::property_tree::ptree response_l;
+	for (auto priority : { "generate", "high", "normal" })
+	{
+		response_l.put (priority, "0");
+	}
+	for (auto & i : node.wallets.queue_depth ())
+	{
+		response_l.put (i.first, std::to_string (i.second));
+	}
+	response_l.put ("threads", std::to_string (node.wallets.threads.size ()));
+	response (response_l);
+}
+
 void rai::rpc_handler::wallet_add ()
 {
 	if (rpc.config.enable_control)
@@ -3800,79 +4951,38 @@ void rai::rpc_handler::wallet_pending ()
 {
 	std::string wallet_text (request.get<std::string> ("wallet"));
 	rai::uint256_union wallet;
+	uint64_t count (std::numeric_limits<uint64_t>::max ());
+	rai::uint128_union threshold (0);
+	std::shared_ptr<rai::wallet> wallet_l;
 	auto error (wallet.decode_hex (wallet_text));
 	if (!error)
 	{
 		auto existing (node.wallets.items.find (wallet));
 		if (existing != node.wallets.items.end ())
 		{
-			uint64_t count (std::numeric_limits<uint64_t>::max ());
-			rai::uint128_union threshold (0);
+			wallet_l = existing->second;
 			boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 			if (count_text.is_initialized ())
 			{
-				auto error (decode_unsigned (count_text.get (), count));
+				error = decode_unsigned (count_text.get (), count);
 				if (error)
 				{
 					error_response (response, "Invalid count limit");
 				}
 			}
 			boost::optional<std::string> threshold_text (request.get_optional<std::string> ("threshold"));
-			if (threshold_text.is_initialized ())
+			if (!error && threshold_text.is_initialized ())
 			{
-				auto error_threshold (threshold.decode_dec (threshold_text.get ()));
-				if (error_threshold)
+				error = threshold.decode_dec (threshold_text.get ());
+				if (error)
 				{
 					error_response (response, "Bad threshold number");
 				}
 			}
-			const bool source = request.get<bool> ("source", false);
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree pending;
-			rai::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
-			{
-				rai::account account (i->first.uint256 ());
-				boost::property_tree::ptree peers_l;
-				rai::account end (account.number () + 1);
-				for (auto ii (node.store.pending_begin (transaction, rai::pending_key (account, 0))), nn (node.store.pending_begin (transaction, rai::pending_key (end, 0))); ii != nn && peers_l.size () < count; ++ii)
-				{
-					rai::pending_key key (ii->first);
-					if (threshold.is_zero () && !source)
-					{
-						boost::property_tree::ptree entry;
-						entry.put ("", key.hash.to_string ());
-						peers_l.push_back (std::make_pair ("", entry));
-					}
-					else
-					{
-						rai::pending_info info (ii->second);
-						if (info.amount.number () >= threshold.number ())
-						{
-							if (source)
-							{
-								boost::property_tree::ptree pending_tree;
-								pending_tree.put ("amount", info.amount.number ().convert_to<std::string> ());
-								pending_tree.put ("source", info.source.to_account ());
-								peers_l.add_child (key.hash.to_string (), pending_tree);
-							}
-							else
-							{
-								peers_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
-							}
-						}
-					}
-				}
-				if (!peers_l.empty ())
-				{
-					pending.add_child (account.to_account (), peers_l);
-				}
-			}
-			response_l.add_child ("blocks", pending);
-			response (response_l);
 		}
 		else
 		{
+			error = true;
 			error_response (response, "Wallet not found");
 		}
 	}
@@ -3880,6 +4990,56 @@ void rai::rpc_handler::wallet_pending ()
 	{
 		error_response (response, "Bad wallet number");
 	}
+	if (!error)
+	{
+		const bool source = request.get<bool> ("source", false);
+		auto writer (stream ());
+		writer->begin_object ();
+		writer->begin_object ("blocks");
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		for (auto i (wallet_l->store.begin (transaction)), n (wallet_l->store.end ()); i != n && !writer->aborted; ++i)
+		{
+			rai::account account (i->first.uint256 ());
+			boost::property_tree::ptree peers_l;
+			rai::account end (account.number () + 1);
+			for (auto ii (node.store.pending_begin (transaction, rai::pending_key (account, 0))), nn (node.store.pending_begin (transaction, rai::pending_key (end, 0))); ii != nn && peers_l.size () < count; ++ii)
+			{
+				rai::pending_key key (ii->first);
+				if (threshold.is_zero () && !source)
+				{
+					boost::property_tree::ptree entry;
+					entry.put ("", key.hash.to_string ());
+					peers_l.push_back (std::make_pair ("", entry));
+				}
+				else
+				{
+					rai::pending_info info (ii->second);
+					if (info.amount.number () >= threshold.number ())
+					{
+						if (source)
+						{
+							boost::property_tree::ptree pending_tree;
+							pending_tree.put ("amount", info.amount.number ().convert_to<std::string> ());
+							pending_tree.put ("source", info.source.to_account ());
+							peers_l.add_child (key.hash.to_string (), pending_tree);
+						}
+						else
+						{
+							peers_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+						}
+					}
+				}
+			}
+			// Entries for one account are bounded by count, only the accounts are streamed
+			if (!peers_l.empty ())
+			{
+				writer->put_child (account.to_account (), peers_l);
+			}
+		}
+		writer->end_object ();
+		writer->end_object ();
+		writer->finish ();
+	}
 }
 
 void rai::rpc_handler::wallet_representative ()
@@ -4094,6 +5254,20 @@ void rai::rpc_handler::work_generate ()
 	}
 }
 
+void rai::rpc_handler::work_cache_stats ()
+{
+	boost::property_tree::ptree response_l;
+	auto & stats (node.wallets.work_stats);
+	std::lock_guard<std::mutex> lock (stats.mutex);
+	response_l.put ("hits", std::to_string (stats.hits));
+	response_l.put ("misses", std::to_string (stats.misses));
+	response_l.put ("precomputed", std::to_string (stats.precomputed));
+	response_l.put ("sends", std::to_string (stats.sends));
+	response_l.put ("send_time_average", std::to_string (stats.sends > 0 ? stats.send_time_total.count () / stats.sends : 0));
+	response_l.put ("send_time_max", std::to_string (stats.send_time_max.count ()));
+	response (response_l);
+}
+
 void rai::rpc_handler::work_cancel ()
 {
 	if (rpc.config.enable_control)
@@ -4334,11 +5508,155 @@ void rai::rpc_handler::work_peers_clear ()
 rai::rpc_connection::rpc_connection (rai::node & node_a, rai::rpc & rpc_a) :
 node (node_a.shared ()),
 rpc (rpc_a),
-socket (node_a.service)
+socket (node_a.service),
+idle (node_a.service),
+counted (false),
+keep_alive (false),
+chunk_writing (false),
+chunk_header_written (false),
+chunk_error (false)
 {
 	responded.clear ();
 }
 
+rai::rpc_connection::~rpc_connection ()
+{
+	if (counted)
+	{
+		--rpc.connections;
+	}
+}
+
+void rai::rpc_connection::reset ()
+{
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	res = boost::beast::http::response<boost::beast::http::string_body> ();
+	keep_alive = false;
+	chunk_header_written = false;
+	chunk_serializer.reset ();
+	responded.clear ();
+}
+
+bool rai::rpc_connection::write_chunk (std::string & chunk_a, bool last_a)
+{
+	std::unique_lock<std::mutex> lock (chunks_mutex);
+	auto deadline (std::chrono::steady_clock::now () + chunk_timeout);
+	while (chunks.size () >= chunks_max && !chunk_error)
+	{
+		if (chunks_condition.wait_until (lock, deadline) == std::cv_status::timeout && chunks.size () >= chunks_max)
+		{
+			chunk_error = true;
+			chunks.clear ();
+			if (node->config.logging.log_rpc ())
+			{
+				BOOST_LOG (node->log) << "RPC client stopped reading a streamed response, closing the connection";
+			}
+			// Pending writes fail once the socket is closed
+			auto this_l (shared_from_this ());
+			node->service.post ([this_l]() {
+				boost::system::error_code ignored;
+				this_l->socket.close (ignored);
+			});
+		}
+	}
+	if (!chunk_error)
+	{
+		// A streamed response replaces write_result
+		responded.test_and_set ();
+		chunks.push_back (std::make_pair (std::move (chunk_a), last_a));
+		if (!chunk_writing)
+		{
+			chunk_writing = true;
+			auto this_l (shared_from_this ());
+			node->service.post ([this_l]() { this_l->write_next (); });
+		}
+	}
+	return chunk_error;
+}
+
+void rai::rpc_connection::write_next ()
+{
+	auto this_l (shared_from_this ());
+	std::unique_lock<std::mutex> lock (chunks_mutex);
+	if (!chunk_header_written)
+	{
+		chunk_header_written = true;
+		lock.unlock ();
+		chunk_header = boost::beast::http::response<boost::beast::http::empty_body> ();
+		chunk_header.set ("Content-Type", "application/json");
+		chunk_header.set ("Access-Control-Allow-Origin", "*");
+		chunk_header.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+		chunk_header.result (boost::beast::http::status::ok);
+		chunk_header.version (request.version ());
+		chunk_header.keep_alive (keep_alive);
+		chunk_header.chunked (true);
+		chunk_serializer.reset (new boost::beast::http::response_serializer<boost::beast::http::empty_body> (chunk_header));
+		boost::beast::http::async_write_header (socket, *chunk_serializer, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+			if (!ec)
+			{
+				this_l->write_next ();
+			}
+			else
+			{
+				this_l->write_failed ();
+			}
+		});
+	}
+	else if (!chunks.empty ())
+	{
+		chunk = std::move (chunks.front ().first);
+		auto last (chunks.front ().second);
+		chunks.pop_front ();
+		chunks_condition.notify_all ();
+		lock.unlock ();
+		auto done ([this_l, last](boost::system::error_code const & ec, size_t bytes_transferred) {
+			if (ec)
+			{
+				this_l->write_failed ();
+			}
+			else if (!last)
+			{
+				this_l->write_next ();
+			}
+			else
+			{
+				boost::asio::async_write (this_l->socket, boost::beast::http::make_chunk_last (), [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+					if (!ec && this_l->keep_alive)
+					{
+						{
+							std::lock_guard<std::mutex> lock (this_l->chunks_mutex);
+							this_l->chunk_writing = false;
+						}
+						this_l->reset ();
+						this_l->read ();
+					}
+				});
+			}
+		});
+		if (!chunk.empty ())
+		{
+			boost::asio::async_write (socket, boost::beast::http::make_chunk (boost::asio::buffer (chunk)), done);
+		}
+		else
+		{
+			// An empty chunk would be read as the end of the body
+			done (boost::system::error_code (), 0);
+		}
+	}
+	else
+	{
+		chunk_writing = false;
+	}
+}
+
+void rai::rpc_connection::write_failed ()
+{
+	std::lock_guard<std::mutex> lock (chunks_mutex);
+	chunk_error = true;
+	chunks.clear ();
+	chunks_condition.notify_all ();
+}
+
 void rai::rpc_connection::parse_connection ()
 {
 	read ();
@@ -4351,10 +5669,10 @@ void rai::rpc_connection::write_result (std::string body, unsigned version)
 		res.set ("Content-Type", "application/json");
 		res.set ("Access-Control-Allow-Origin", "*");
 		res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
-		res.set ("Connection", "close");
 		res.result (boost::beast::http::status::ok);
 		res.body () = body;
 		res.version (version);
+		res.keep_alive (keep_alive);
 		res.prepare_payload ();
 	}
 	else
@@ -4367,39 +5685,69 @@ void rai::rpc_connection::write_result (std::string body, unsigned version)
 void rai::rpc_connection::read ()
 {
 	auto this_l (shared_from_this ());
+	if (rpc.config.idle_timeout.count () > 0)
+	{
+		std::weak_ptr<rai::rpc_connection> this_w (this_l);
+		idle.expires_from_now (boost::posix_time::seconds (rpc.config.idle_timeout.count ()));
+		idle.async_wait ([this_w](boost::system::error_code const & ec) {
+			if (!ec)
+			{
+				if (auto this_l = this_w.lock ())
+				{
+					boost::system::error_code ignored;
+					this_l->socket.close (ignored);
+				}
+			}
+		});
+	}
 	boost::beast::http::async_read (socket, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->idle.cancel ();
 		if (!ec)
 		{
-			this_l->node->background ([this_l]() {
-				auto start (std::chrono::steady_clock::now ());
-				auto version (this_l->request.version ());
-				auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
-
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-					});
-
-					if (this_l->node->config.logging.log_rpc ())
+			this_l->keep_alive = this_l->request.keep_alive () && this_l->rpc.config.idle_timeout.count () > 0;
+			auto start (std::chrono::steady_clock::now ());
+			auto version (this_l->request.version ());
+			auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
+
+				std::stringstream ostream;
+				boost::property_tree::write_json (ostream, tree_a);
+				ostream.flush ();
+				auto body (ostream.str ());
+				this_l->write_result (body, version);
+				boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+					if (!ec && this_l->keep_alive)
 					{
-						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
+						this_l->reset ();
+						this_l->read ();
 					}
 				});
-				if (this_l->request.method () == boost::beast::http::verb::post)
+
+				if (this_l->node->config.logging.log_rpc ())
 				{
-					auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
-					handler->process_request ();
+					BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
 				}
-				else
+			});
+			if (boost::beast::websocket::is_upgrade (this_l->request))
+			{
+				this_l->rpc.websocket->accept (std::move (this_l->socket), std::move (this_l->request));
+			}
+			else if (this_l->request.method () == boost::beast::http::verb::post)
+			{
+				auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
+				handler->chunk = [this_l](std::string & chunk_a, bool last_a) {
+					return this_l->write_chunk (chunk_a, last_a);
+				};
+				if (this_l->rpc.executor.add (rai::rpc_cost::cheap, [handler]() { handler->process_request (); }))
 				{
-					error_response (response_handler, "Can only POST requests");
+					error_response (response_handler, "RPC queue is full");
 				}
-			});
+			}
+			else
+			{
+				error_response (response_handler, "Can only POST requests");
+			}
 		}
-		else
+		else if (ec != boost::beast::http::error::end_of_stream && ec != boost::asio::error::operation_aborted)
 		{
 			BOOST_LOG (this_l->node->log) << "RPC read error: " << ec.message ();
 		}
@@ -4420,8 +5768,10 @@ void rai::rpc_handler::process_request ()
 {
 	try
 	{
-		std::stringstream istream (body);
-		boost::property_tree::read_json (istream, request);
+		if (rai::parse_json (body, request))
+		{
+			throw std::runtime_error ("Unable to parse JSON");
+		}
 		std::string action (request.get<std::string> ("action"));
 		if (action == "password_enter")
 		{
@@ -4445,406 +5795,42 @@ void rai::rpc_handler::process_request ()
 		{
 			BOOST_LOG (node.log) << body;
 		}
-		if (action == "account_balance")
-		{
-			account_balance ();
-		}
-		else if (action == "account_block_count")
-		{
-			account_block_count ();
-		}
-		else if (action == "account_create")
-		{
-			account_create ();
-		}
-		else if (action == "account_get")
-		{
-			account_get ();
-		}
-		else if (action == "account_history")
-		{
-			account_history ();
-		}
-		else if (action == "account_info")
-		{
-			account_info ();
-		}
-		else if (action == "account_key")
-		{
-			account_key ();
-		}
-		else if (action == "account_list")
-		{
-			account_list ();
-		}
-		else if (action == "account_move")
-		{
-			account_move ();
-		}
-		else if (action == "account_remove")
-		{
-			account_remove ();
-		}
-		else if (action == "account_representative")
-		{
-			account_representative ();
-		}
-		else if (action == "account_representative_set")
-		{
-			account_representative_set ();
-		}
-		else if (action == "account_weight")
-		{
-			account_weight ();
-		}
-		else if (action == "accounts_balances")
-		{
-			accounts_balances ();
-		}
-		else if (action == "accounts_create")
-		{
-			accounts_create ();
-		}
-		else if (action == "accounts_frontiers")
-		{
-			accounts_frontiers ();
-		}
-		else if (action == "accounts_pending")
-		{
-			accounts_pending ();
-		}
-		else if (action == "available_supply")
-		{
-			available_supply ();
-		}
-		else if (action == "block")
-		{
-			block ();
-		}
-		else if (action == "blocks")
-		{
-			blocks ();
-		}
-		else if (action == "blocks_info")
-		{
-			blocks_info ();
-		}
-		else if (action == "block_account")
-		{
-			block_account ();
-		}
-		else if (action == "block_count")
-		{
-			block_count ();
-		}
-		else if (action == "block_count_type")
-		{
-			block_count_type ();
-		}
-		else if (action == "block_create")
-		{
-			block_create ();
-		}
-		else if (action == "successors")
-		{
-			successors ();
-		}
-		else if (action == "bootstrap")
-		{
-			bootstrap ();
-		}
-		else if (action == "bootstrap_any")
+		std::string cache_key;
+		boost::optional<rai::account> cache_account;
+		boost::property_tree::ptree cached;
+		auto cacheable (rpc.cache.cacheable (action, request, cache_key, cache_account));
+		if (cacheable && rpc.cache.get (action, cache_key, cached))
 		{
-			bootstrap_any ();
-		}
-		else if (action == "chain")
-		{
-			chain ();
-		}
-		else if (action == "delegators")
-		{
-			delegators ();
-		}
-		else if (action == "delegators_count")
-		{
-			delegators_count ();
-		}
-		else if (action == "deterministic_key")
-		{
-			deterministic_key ();
-		}
-		else if (action == "frontiers")
-		{
-			frontiers ();
-		}
-		else if (action == "frontier_count")
-		{
-			frontier_count ();
-		}
-		else if (action == "history")
-		{
-			request.put ("head", request.get<std::string> ("hash"));
-			account_history ();
-		}
-		else if (action == "keepalive")
-		{
-			keepalive ();
-		}
-		else if (action == "key_create")
-		{
-			key_create ();
-		}
-		else if (action == "key_expand")
-		{
-			key_expand ();
-		}
-		else if (action == "krai_from_raw")
-		{
-			krai_from_raw ();
-		}
-		else if (action == "krai_to_raw")
-		{
-			krai_to_raw ();
-		}
-		else if (action == "ledger")
-		{
-			ledger ();
-		}
-		else if (action == "mrai_from_raw")
-		{
-			mrai_from_raw ();
-		}
-		else if (action == "mrai_to_raw")
-		{
-			mrai_to_raw ();
-		}
-		else if (action == "password_change")
-		{
-			// Processed before logging
-		}
-		else if (action == "password_enter")
-		{
-			// Processed before logging
-		}
-		else if (action == "password_valid")
-		{
-			password_valid ();
-		}
-		else if (action == "payment_begin")
-		{
-			payment_begin ();
-		}
-		else if (action == "payment_init")
-		{
-			payment_init ();
-		}
-		else if (action == "payment_end")
-		{
-			payment_end ();
-		}
-		else if (action == "payment_wait")
-		{
-			payment_wait ();
-		}
-		else if (action == "peers")
-		{
-			peers ();
-		}
-		else if (action == "pending")
-		{
-			pending ();
-		}
-		else if (action == "pending_exists")
-		{
-			pending_exists ();
-		}
-		else if (action == "process")
-		{
-			process ();
-		}
-		else if (action == "rai_from_raw")
-		{
-			rai_from_raw ();
-		}
-		else if (action == "rai_to_raw")
-		{
-			rai_to_raw ();
-		}
-		else if (action == "receive")
-		{
-			receive ();
-		}
-		else if (action == "receive_minimum")
-		{
-			receive_minimum ();
-		}
-		else if (action == "receive_minimum_set")
-		{
-			receive_minimum_set ();
-		}
-		else if (action == "representatives")
-		{
-			representatives ();
-		}
-		else if (action == "republish")
-		{
-			republish ();
-		}
-		else if (action == "search_pending")
-		{
-			search_pending ();
-		}
-		else if (action == "search_pending_all")
-		{
-			search_pending_all ();
-		}
-		else if (action == "send")
-		{
-			send ();
-		}
-		else if (action == "stop")
-		{
-			stop ();
-		}
-		else if (action == "unchecked")
-		{
-			unchecked ();
-		}
-		else if (action == "unchecked_clear")
-		{
-			unchecked_clear ();
-		}
-		else if (action == "unchecked_get")
-		{
-			unchecked_get ();
-		}
-		else if (action == "unchecked_keys")
-		{
-			unchecked_keys ();
-		}
-		else if (action == "validate_account_number")
-		{
-			validate_account_number ();
-		}
-		else if (action == "version")
-		{
-			version ();
-		}
-		else if (action == "wallet_add")
-		{
-			wallet_add ();
-		}
-		else if (action == "wallet_add_watch")
-		{
-			wallet_add_watch ();
-		}
-		else if (action == "wallet_balance_total")
-		{
-			wallet_balance_total ();
-		}
-		else if (action == "wallet_balances")
-		{
-			wallet_balances ();
-		}
-		else if (action == "wallet_change_seed")
-		{
-			wallet_change_seed ();
-		}
-		else if (action == "wallet_contains")
-		{
-			wallet_contains ();
-		}
-		else if (action == "wallet_create")
-		{
-			wallet_create ();
-		}
-		else if (action == "wallet_destroy")
-		{
-			wallet_destroy ();
-		}
-		else if (action == "wallet_export")
-		{
-			wallet_export ();
-		}
-		else if (action == "wallet_frontiers")
-		{
-			wallet_frontiers ();
-		}
-		else if (action == "wallet_key_valid")
-		{
-			wallet_key_valid ();
-		}
-		else if (action == "wallet_ledger")
-		{
-			wallet_ledger ();
-		}
-		else if (action == "wallet_lock")
-		{
-			wallet_lock ();
-		}
-		else if (action == "wallet_locked")
-		{
-			password_valid (true);
-		}
-		else if (action == "wallet_pending")
-		{
-			wallet_pending ();
-		}
-		else if (action == "wallet_representative")
-		{
-			wallet_representative ();
-		}
-		else if (action == "wallet_representative_set")
-		{
-			wallet_representative_set ();
-		}
-		else if (action == "wallet_republish")
-		{
-			wallet_republish ();
-		}
-		else if (action == "wallet_unlock")
-		{
-			// Processed before logging
-		}
-		else if (action == "wallet_work_get")
-		{
-			wallet_work_get ();
-		}
-		else if (action == "work_generate")
-		{
-			work_generate ();
-		}
-		else if (action == "work_cancel")
-		{
-			work_cancel ();
-		}
-		else if (action == "work_get")
-		{
-			work_get ();
-		}
-		else if (action == "work_set")
-		{
-			work_set ();
-		}
-		else if (action == "work_validate")
-		{
-			work_validate ();
-		}
-		else if (action == "work_peer_add")
-		{
-			work_peer_add ();
-		}
-		else if (action == "work_peers")
-		{
-			work_peers ();
-		}
-		else if (action == "work_peers_clear")
-		{
-			work_peers_clear ();
+			response (cached);
 		}
 		else
 		{
-			error_response (response, "Unknown command");
+			if (cacheable)
+			{
+				// Responses are only stored if the ledger didn't change while they were computed
+				auto generation (rpc.cache.current ());
+				auto & cache_l (rpc.cache);
+				auto response_l (response);
+				response = [&cache_l, action, cache_key, generation, cache_account, response_l](boost::property_tree::ptree const & tree_a) {
+					if (!tree_a.get_child_optional ("error"))
+					{
+						cache_l.put (action, cache_key, generation, cache_account, tree_a);
+					}
+					response_l (tree_a);
+				};
+			}
+			if (rai::rpc_executor::cost (action) == rai::rpc_cost::expensive)
+			{
+				auto this_l (shared_from_this ());
+				if (rpc.executor.add (rai::rpc_cost::expensive, [this_l, action]() { this_l->dispatch (action); }))
+				{
+					error_response (response, "RPC queue is full");
+				}
+			}
+			else
+			{
+				dispatch (action);
+			}
 		}
 	}
 	catch (std::runtime_error const & err)
@@ -4857,6 +5843,59 @@ void rai::rpc_handler::process_request ()
 	}
 }
 
+std::unique_ptr<rai::json_writer> rai::rpc_handler::stream ()
+{
+	std::unique_ptr<rai::json_writer> result;
+	if (chunk)
+	{
+		result.reset (new rai::json_writer (chunk));
+	}
+	else
+	{
+		auto buffered (std::make_shared<std::string> ());
+		auto response_l (response);
+		result.reset (new rai::json_writer ([buffered, response_l](std::string & chunk_a, bool last_a) {
+			buffered->append (chunk_a);
+			if (last_a)
+			{
+				boost::property_tree::ptree tree;
+				std::stringstream istream (*buffered);
+				boost::property_tree::read_json (istream, tree);
+				response_l (tree);
+			}
+			return false;
+		}));
+	}
+	return result;
+}
+
+void rai::rpc_handler::dispatch (std::string const & action)
+{
+	auto start (std::chrono::steady_clock::now ());
+	auto existing (rpc_actions ().find (action));
+	if (existing != rpc_actions ().end ())
+	{
+		try
+		{
+			existing->second.handler (*this);
+		}
+		catch (std::runtime_error const & err)
+		{
+			error_response (response, "Unable to parse JSON");
+		}
+		catch (...)
+		{
+			error_response (response, "Internal server error in RPC");
+		}
+		auto end (std::chrono::steady_clock::now ());
+		rpc.executor.record (action, std::chrono::duration_cast<std::chrono::microseconds> (start - arrival), std::chrono::duration_cast<std::chrono::microseconds> (end - start));
+	}
+	else
+	{
+		error_response (response, "Unknown command");
+	}
+}
+
 rai::payment_observer::payment_observer (std::function<void(boost::property_tree::ptree const &)> const & response_a, rai::rpc & rpc_a, rai::account const & account_a, rai::amount const & amount_a) :
 rpc (rpc_a),
 account (account_a),
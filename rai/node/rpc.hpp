@@ -5,13 +5,65 @@
 #include <boost/beast.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <deque>
 #include <rai/node/utility.hpp>
+#include <rai/node/websocket.hpp>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace rai
 {
 void error_response (std::function<void(boost::property_tree::ptree const &)> response_a, std::string const & message_a);
 class node;
+/**
+ * Writes a JSON document incrementally, handing it to a sink in chunks so large responses never exist in memory at once
+ * Values are written as strings, matching the output of property_tree
+ */
+class json_writer
+{
+public:
+	// Output matches write_json byte for byte so streamed and buffered responses are the same
+	// The sink receives each chunk and may take its contents, the flag is set on the final chunk
+	// The sink returns true once the receiver is gone, nothing more is sent after that
+	json_writer (std::function<bool(std::string &, bool)> const &, size_t = chunk_size_default);
+	// Begins an anonymous object, either the document root or an array element
+	void begin_object ();
+	void begin_object (std::string const &);
+	void end_object ();
+	void begin_array (std::string const &);
+	void end_array ();
+	void put (std::string const &, std::string const &);
+	// Writes a string array element
+	void put (std::string const &);
+	void put_child (std::string const &, boost::property_tree::ptree const &);
+	// Writes a tree as an array element
+	void put_child (boost::property_tree::ptree const &);
+	// Sends everything remaining to the sink as the final chunk
+	void finish ();
+	void separator ();
+	void key (std::string const &);
+	void indent (size_t);
+	void close (char);
+	void string (std::string const &);
+	void tree (boost::property_tree::ptree const &);
+	void flush ();
+	std::function<bool(std::string &, bool)> sink;
+	// Set once the sink gave up, producers should stop and release what they hold
+	bool aborted;
+	size_t chunk_size;
+	std::string buffer;
+	// One entry per open object or array, true until its first member is written
+	std::vector<bool> first;
+	// Opening character of each open object or array, written along with its first member
+	std::string open;
+	static size_t constexpr chunk_size_default = 64 * 1024;
+};
+/**
+ * Parses a JSON document into the same tree read_json produces without its stream and grammar overhead
+ * Returns true on error
+ */
+bool parse_json (std::string const &, boost::property_tree::ptree &);
 /** Configuration options for RPC TLS */
 class rpc_secure_config
 {
@@ -47,8 +99,106 @@ public:
 	bool enable_control;
 	uint64_t frontier_request_limit;
 	uint64_t chain_request_limit;
+	// Connections beyond this are closed as soon as they're accepted
+	unsigned max_connections;
+	// Persistent connections are closed after waiting this long for the next request, zero disables keep-alive
+	std::chrono::seconds idle_timeout;
+	// Threads servicing RPC requests, separate from the node io_service
+	unsigned worker_threads;
+	// Maximum number of expensive actions running at the same time
+	unsigned expensive_concurrency;
+	// Requests queued per cost class before new ones are rejected
+	size_t queue_max;
+	// Responses of these actions are cached for the given time, empty disables the cache
+	std::unordered_map<std::string, std::chrono::milliseconds> cache_ttl;
+	// Cached responses kept before the cache is emptied
+	size_t cache_max;
+	// Events queued for a websocket subscriber before it's disconnected as too slow
+	size_t websocket_queue_max;
 	rpc_secure_config secure;
 };
+enum class rpc_cost
+{
+	cheap, // Point lookups and conversions
+	expensive // Scans over whole tables or wallets
+};
+class rpc_action_stats
+{
+public:
+	rpc_action_stats ();
+	uint64_t count;
+	std::chrono::microseconds queue_wait;
+	std::chrono::microseconds queue_wait_max;
+	std::chrono::microseconds execution;
+	std::chrono::microseconds execution_max;
+};
+/**
+ * Thread pool running RPC requests with bounded queues per cost class
+ * Expensive actions are limited in concurrency so cheap requests keep flowing while ledger scans run
+ */
+class rpc_executor
+{
+public:
+	rpc_executor (rai::rpc_config const &);
+	~rpc_executor ();
+	// Returns true if the queue for the cost class is full and the action was rejected
+	bool add (rai::rpc_cost, std::function<void()> const &);
+	void record (std::string const &, std::chrono::microseconds, std::chrono::microseconds);
+	void stop ();
+	void run ();
+	static rai::rpc_cost cost (std::string const &);
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::function<void()>> cheap;
+	std::deque<std::function<void()>> expensive;
+	unsigned expensive_active;
+	unsigned expensive_concurrency;
+	size_t queue_max;
+	uint64_t rejected;
+	bool stopped;
+	std::unordered_map<std::string, rai::rpc_action_stats> stats;
+	std::vector<std::thread> threads;
+};
+class rpc_cache_entry
+{
+public:
+	boost::property_tree::ptree response;
+	std::chrono::steady_clock::time_point expiry;
+	// Ledger generation the response was computed at, ledger wide entries are only valid while it's current
+	uint64_t generation;
+	boost::optional<rai::account> account;
+};
+class rpc_cache_stats
+{
+public:
+	rpc_cache_stats ();
+	uint64_t hits;
+	uint64_t misses;
+};
+/**
+ * Responses to read-only actions keyed by action and normalized request
+ * Ledger wide entries are invalidated by any ledger change, account scoped entries only by blocks touching their account
+ */
+class rpc_cache
+{
+public:
+	rpc_cache (rai::rpc_config const &);
+	// Returns true if responses to the request may be cached, filling in its key and the account it depends on
+	bool cacheable (std::string const &, boost::property_tree::ptree const &, std::string &, boost::optional<rai::account> &);
+	// Returns true if a fresh response was found
+	bool get (std::string const &, std::string const &, boost::property_tree::ptree &);
+	// The response is dropped if the ledger changed after the given generation
+	void put (std::string const &, std::string const &, uint64_t, boost::optional<rai::account> const &, boost::property_tree::ptree const &);
+	void ledger_changed (rai::account const &, rai::account const &);
+	uint64_t current ();
+	std::mutex mutex;
+	uint64_t generation;
+	std::unordered_map<std::string, rai::rpc_cache_entry> entries;
+	std::unordered_map<rai::account, std::unordered_set<std::string>> accounts;
+	std::unordered_map<std::string, rai::rpc_cache_stats> stats;
+	std::unordered_map<std::string, std::chrono::milliseconds> ttl;
+	size_t max;
+};
 enum class payment_status
 {
 	not_a_status,
@@ -74,6 +224,11 @@ public:
 	std::unordered_map<rai::account, std::shared_ptr<rai::payment_observer>> payment_observers;
 	rai::rpc_config config;
 	rai::node & node;
+	rai::rpc_executor executor;
+	rai::rpc_cache cache;
+	// Connections upgraded to websockets are handed over to the server and no longer count as RPC connections
+	std::shared_ptr<rai::websocket_server> websocket;
+	std::atomic<unsigned> connections;
 	bool on;
 	static uint16_t const rpc_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7076 : 55000;
 };
@@ -81,16 +236,41 @@ class rpc_connection : public std::enable_shared_from_this<rai::rpc_connection>
 {
 public:
 	rpc_connection (rai::node &, rai::rpc &);
+	virtual ~rpc_connection ();
 	virtual void parse_connection ();
 	virtual void read ();
 	virtual void write_result (std::string body, unsigned version);
+	// Prepares for the next request on a persistent connection, pipelined requests already in the buffer are answered in order
+	void reset ();
+	// Queues a chunk of a streamed response from a worker thread, blocking while the client is behind
+	// Returns true if the response was abandoned because the client failed or stopped reading for chunk_timeout
+	bool write_chunk (std::string &, bool);
+	void write_next ();
+	void write_failed ();
 	std::shared_ptr<rai::node> node;
 	rai::rpc & rpc;
 	boost::asio::ip::tcp::socket socket;
+	boost::asio::deadline_timer idle;
 	boost::beast::flat_buffer buffer;
 	boost::beast::http::request<boost::beast::http::string_body> request;
 	boost::beast::http::response<boost::beast::http::string_body> res;
 	std::atomic_flag responded;
+	// Set when the connection was counted against rpc_config::max_connections
+	bool counted;
+	bool keep_alive;
+	std::mutex chunks_mutex;
+	std::condition_variable chunks_condition;
+	std::deque<std::pair<std::string, bool>> chunks;
+	std::string chunk;
+	bool chunk_writing;
+	bool chunk_header_written;
+	bool chunk_error;
+	boost::beast::http::response<boost::beast::http::empty_body> chunk_header;
+	std::unique_ptr<boost::beast::http::response_serializer<boost::beast::http::empty_body>> chunk_serializer;
+	// Chunks queued ahead of the socket before the producer blocks
+	static size_t constexpr chunks_max = 4;
+	// The producer holds a read transaction and a worker slot while blocked, a client that stalls this long is dropped
+	static std::chrono::seconds constexpr chunk_timeout = std::chrono::seconds (30);
 };
 class payment_observer : public std::enable_shared_from_this<rai::payment_observer>
 {
@@ -114,6 +294,9 @@ class rpc_handler : public std::enable_shared_from_this<rai::rpc_handler>
 public:
 	rpc_handler (rai::node &, rai::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &);
 	void process_request ();
+	void dispatch (std::string const &);
+	// Begins a streamed response, buffered into a property_tree response when the connection can't send chunks
+	std::unique_ptr<rai::json_writer> stream ();
 	void account_balance ();
 	void account_block_count ();
 	void account_create ();
@@ -131,6 +314,7 @@ public:
 	void accounts_create ();
 	void accounts_frontiers ();
 	void accounts_pending ();
+	void active_stats ();
 	void available_supply ();
 	void block ();
 	void blocks ();
@@ -139,8 +323,10 @@ public:
 	void block_count ();
 	void block_count_type ();
 	void block_create ();
+	void block_processor_stats ();
 	void bootstrap ();
 	void bootstrap_any ();
+	void callback_stats ();
 	void chain ();
 	void delegators ();
 	void delegators_count ();
@@ -174,6 +360,7 @@ public:
 	void receive_minimum_set ();
 	void representatives ();
 	void republish ();
+	void rpc_stats ();
 	void search_pending ();
 	void search_pending_all ();
 	void send ();
@@ -181,10 +368,13 @@ public:
 	void successors ();
 	void unchecked ();
 	void unchecked_clear ();
+	void unchecked_drain_status ();
 	void unchecked_get ();
 	void unchecked_keys ();
+	void unchecked_stats ();
 	void validate_account_number ();
 	void version ();
+	void wallet_action_queue ();
 	void wallet_add ();
 	void wallet_add_watch ();
 	void wallet_balance_total ();
@@ -211,11 +401,16 @@ public:
 	void work_peer_add ();
 	void work_peers ();
 	void work_peers_clear ();
+	void work_cache_stats ();
 	std::string body;
 	rai::node & node;
 	rai::rpc & rpc;
+	// When the request was read, queue wait is measured from here
+	std::chrono::steady_clock::time_point arrival;
 	boost::property_tree::ptree request;
 	std::function<void(boost::property_tree::ptree const &)> response;
+	// Set by connections able to send chunked responses
+	std::function<bool(std::string &, bool)> chunk;
 };
 /** Returns the correct RPC implementation based on TLS configuration */
 std::unique_ptr<rai::rpc> get_rpc (boost::asio::io_service & service_a, rai::node & node_a, rai::rpc_config const & config_a);
@@ -30,7 +30,77 @@ boost::filesystem::path rai::unique_path ()
 	return result;
 }
 
-rai::mdb_env::mdb_env (bool & error_a, boost::filesystem::path const & path_a, int max_dbs)
+rai::lmdb_config::lmdb_config () :
+map_size (1ULL * 1024 * 1024 * 1024 * 1024), // 1 Terabyte
+max_readers (126),
+write_map (false),
+no_meta_sync (false),
+no_read_ahead (false),
+map_async (false),
+sync_interval (std::chrono::seconds (5))
+{
+}
+
+void rai::lmdb_config::serialize_json (boost::property_tree::ptree & tree_a) const
+{
+	tree_a.put ("map_size", std::to_string (map_size));
+	tree_a.put ("max_readers", std::to_string (max_readers));
+	tree_a.put ("write_map", write_map);
+	tree_a.put ("no_meta_sync", no_meta_sync);
+	tree_a.put ("no_read_ahead", no_read_ahead);
+	tree_a.put ("map_async", map_async);
+	tree_a.put ("sync_interval", std::to_string (sync_interval.count ()));
+}
+
+bool rai::lmdb_config::deserialize_json (boost::property_tree::ptree & tree_a)
+{
+	auto result (false);
+	try
+	{
+		auto map_size_l (tree_a.get<std::string> ("map_size"));
+		auto max_readers_l (tree_a.get<std::string> ("max_readers"));
+		write_map = tree_a.get<bool> ("write_map");
+		no_meta_sync = tree_a.get<bool> ("no_meta_sync");
+		no_read_ahead = tree_a.get<bool> ("no_read_ahead");
+		map_async = tree_a.get<bool> ("map_async");
+		auto sync_interval_l (tree_a.get<std::string> ("sync_interval"));
+		map_size = std::stoull (map_size_l);
+		max_readers = std::stoul (max_readers_l);
+		sync_interval = std::chrono::seconds (std::stoull (sync_interval_l));
+		result |= map_size == 0;
+		result |= max_readers == 0;
+		// MDB_MAPASYNC only has an effect on a writable memory map
+		result |= map_async && !write_map;
+	}
+	catch (std::logic_error const &)
+	{
+		result = true;
+	}
+	catch (std::runtime_error const &)
+	{
+		result = true;
+	}
+	return result;
+}
+
+unsigned rai::lmdb_config::flags () const
+{
+	unsigned result (0);
+	result |= write_map ? MDB_WRITEMAP : 0;
+	result |= no_meta_sync ? MDB_NOMETASYNC : 0;
+	result |= no_read_ahead ? MDB_NORDAHEAD : 0;
+	result |= map_async ? MDB_MAPASYNC : 0;
+	return result;
+}
+
+bool rai::lmdb_config::deferred_sync () const
+{
+	return no_meta_sync || map_async;
+}
+
+rai::mdb_env::mdb_env (bool & error_a, boost::filesystem::path const & path_a, int max_dbs, rai::lmdb_config const & config_a) :
+write_transactions (0),
+write_wait (0)
 {
 	boost::system::error_code error;
 	if (path_a.has_parent_path ())
@@ -42,12 +112,14 @@ rai::mdb_env::mdb_env (bool & error_a, boost::filesystem::path const & path_a, i
 			assert (status1 == 0);
 			auto status2 (mdb_env_set_maxdbs (environment, max_dbs));
 			assert (status2 == 0);
-			auto status3 (mdb_env_set_mapsize (environment, 1ULL * 1024 * 1024 * 1024 * 1024)); // 1 Terabyte
+			auto status3 (mdb_env_set_mapsize (environment, config_a.map_size));
 			assert (status3 == 0);
+			auto status4 (mdb_env_set_maxreaders (environment, config_a.max_readers));
+			assert (status4 == 0);
 			// It seems if there's ever more threads than mdb_env_set_maxreaders has read slots available, we get failures on transaction creation unless MDB_NOTLS is specified
 			// This can happen if something like 256 io_threads are specified in the node config
-			auto status4 (mdb_env_open (environment, path_a.string ().c_str (), MDB_NOSUBDIR | MDB_NOTLS, 00600));
-			error_a = status4 != 0;
+			auto status5 (mdb_env_open (environment, path_a.string ().c_str (), MDB_NOSUBDIR | MDB_NOTLS | config_a.flags (), 00600));
+			error_a = status5 != 0;
 		}
 		else
 		{
@@ -132,8 +204,14 @@ rai::mdb_val::operator MDB_val const & () const
 rai::transaction::transaction (rai::mdb_env & environment_a, MDB_txn * parent_a, bool write) :
 environment (environment_a)
 {
+	auto begin (std::chrono::steady_clock::now ());
 	auto status (mdb_txn_begin (environment_a, parent_a, write ? 0 : MDB_RDONLY, &handle));
 	assert (status == 0);
+	if (write && parent_a == nullptr)
+	{
+		++environment.write_transactions;
+		environment.write_wait += std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - begin).count ();
+	}
 }
 
 rai::transaction::~transaction ()
@@ -2,6 +2,7 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <type_traits>
 
@@ -26,6 +27,8 @@ using vectorstream = boost::iostreams::stream_buffer<boost::iostreams::back_inse
 boost::filesystem::path working_path ();
 // Get a unique path within the home directory, used for testing
 boost::filesystem::path unique_path ();
+// OS-specific flush of a file, or of a directory's entries, to stable storage, returns true on error
+bool sync_path (boost::filesystem::path const &);
 // C++ stream are absolutely horrible so I need this helper function to do the most basic operation of creating a file if it doesn't exist or truncating it.
 void open_or_create (std::fstream &, std::string const &);
 // Reads a json object from the stream and if was changed, write the object back to the stream
@@ -98,16 +101,42 @@ bool fetch_object (T & object, boost::filesystem::path const & path_a, std::fstr
 	return error;
 }
 
+/**
+ * Tunable LMDB environment options
+ */
+class lmdb_config
+{
+public:
+	lmdb_config ();
+	void serialize_json (boost::property_tree::ptree &) const;
+	bool deserialize_json (boost::property_tree::ptree &);
+	// Flags passed to mdb_env_open in addition to MDB_NOSUBDIR | MDB_NOTLS
+	unsigned flags () const;
+	// True if commits may return before data or metadata reach the disk and a periodic mdb_env_sync is needed
+	bool deferred_sync () const;
+	uint64_t map_size;
+	unsigned max_readers;
+	bool write_map;
+	bool no_meta_sync;
+	bool no_read_ahead;
+	bool map_async;
+	// Interval between forced mdb_env_sync calls when syncing is deferred, zero disables
+	std::chrono::seconds sync_interval;
+};
+
 /**
  * RAII wrapper for MDB_env
  */
 class mdb_env
 {
 public:
-	mdb_env (bool &, boost::filesystem::path const &, int max_dbs = 128);
+	mdb_env (bool &, boost::filesystem::path const &, int max_dbs = 128, rai::lmdb_config const & = rai::lmdb_config ());
 	~mdb_env ();
 	operator MDB_env * () const;
 	MDB_env * environment;
+	// Write transactions begun and the time spent waiting for the writer lock to begin them, in microseconds
+	std::atomic<uint64_t> write_transactions;
+	std::atomic<uint64_t> write_wait;
 };
 
 /**
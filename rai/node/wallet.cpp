@@ -370,6 +370,17 @@ environment (transaction_a.environment)
 	rai::raw_key key;
 	key.data = entry_get_raw (transaction_a, rai::wallet_store::wallet_key_special).key;
 	wallet_key_mem.value_set (key);
+	if (!init_a)
+	{
+		std::lock_guard<std::mutex> lock (spendable_mutex);
+		for (auto i (begin (transaction_a)), n (end ()); i != n; ++i)
+		{
+			if (!rai::wallet_value (i->second).key.is_zero ())
+			{
+				spendable_accounts.insert (i->first.uint256 ());
+			}
+		}
+	}
 }
 
 std::vector<rai::account> rai::wallet_store::accounts (MDB_txn * transaction_a)
@@ -429,6 +440,8 @@ void rai::wallet_store::erase (MDB_txn * transaction_a, rai::public_key const &
 {
 	auto status (mdb_del (transaction_a, handle, rai::mdb_val (pub), nullptr));
 	assert (status == 0);
+	std::lock_guard<std::mutex> lock (spendable_mutex);
+	spendable_accounts.erase (pub);
 }
 
 rai::wallet_value rai::wallet_store::entry_get_raw (MDB_txn * transaction_a, rai::public_key const & pub_a)
@@ -452,6 +465,24 @@ void rai::wallet_store::entry_put_raw (MDB_txn * transaction_a, rai::public_key
 {
 	auto status (mdb_put (transaction_a, handle, rai::mdb_val (pub_a), entry_a.val (), 0));
 	assert (status == 0);
+	if (pub_a.number () >= special_count)
+	{
+		std::lock_guard<std::mutex> lock (spendable_mutex);
+		if (!entry_a.key.is_zero ())
+		{
+			spendable_accounts.insert (pub_a);
+		}
+		else
+		{
+			spendable_accounts.erase (pub_a);
+		}
+	}
+}
+
+bool rai::wallet_store::spendable (rai::public_key const & pub_a)
+{
+	std::lock_guard<std::mutex> lock (spendable_mutex);
+	return spendable_accounts.count (pub_a) > 0;
 }
 
 rai::key_type rai::wallet_store::key_type (rai::wallet_value const & value_a)
@@ -763,6 +794,7 @@ rai::public_key rai::wallet::deterministic_insert (MDB_txn * transaction_a, bool
 		{
 			work_ensure (transaction_a, key);
 		}
+		representative_insert (transaction_a, key);
 	}
 	return key;
 }
@@ -784,6 +816,7 @@ rai::public_key rai::wallet::insert_adhoc (MDB_txn * transaction_a, rai::raw_key
 		{
 			work_ensure (transaction_a, key);
 		}
+		representative_insert (transaction_a, key);
 	}
 	return key;
 }
@@ -825,6 +858,7 @@ bool rai::wallet::import (std::string const & json_a, std::string const & passwo
 	if (!error)
 	{
 		error = store.import (transaction, *temp);
+		representatives_compute (transaction);
 	}
 	temp->destroy (transaction);
 	return error;
@@ -840,6 +874,8 @@ void rai::wallet_store::destroy (MDB_txn * transaction_a)
 {
 	auto status (mdb_drop (transaction_a, handle, 1));
 	assert (status == 0);
+	std::lock_guard<std::mutex> lock (spendable_mutex);
+	spendable_accounts.clear ();
 }
 
 std::shared_ptr<rai::block> rai::wallet::receive_action (rai::block const & send_a, rai::account const & representative_a, rai::uint128_union const & amount_a, bool generate_work_a)
@@ -910,13 +946,14 @@ std::shared_ptr<rai::block> rai::wallet::receive_action (rai::block const & send
 	{
 		assert (block != nullptr);
 		node.block_arrival.add (block->hash ());
-		node.block_processor.process_receive_many (block);
+		rai::process_return result;
+		node.block_processor.process_one (rai::block_processor_item (block), result);
 		if (generate_work_a)
 		{
 			auto hash (block->hash ());
 			auto this_l (shared_from_this ());
 			auto source (account);
-			node.wallets.queue_wallet_action (rai::wallets::generate_priority, [this_l, source, hash] {
+			node.wallets.queue_wallet_action (rai::wallets::generate_priority, source, [this_l, source, hash] {
 				this_l->work_generate (source, hash);
 			});
 		}
@@ -955,12 +992,13 @@ std::shared_ptr<rai::block> rai::wallet::change_action (rai::account const & sou
 	{
 		assert (block != nullptr);
 		node.block_arrival.add (block->hash ());
-		node.block_processor.process_receive_many (block);
+		rai::process_return result;
+		node.block_processor.process_one (rai::block_processor_item (block), result);
 		if (generate_work_a)
 		{
 			auto hash (block->hash ());
 			auto this_l (shared_from_this ());
-			node.wallets.queue_wallet_action (rai::wallets::generate_priority, [this_l, source_a, hash] {
+			node.wallets.queue_wallet_action (rai::wallets::generate_priority, source_a, [this_l, source_a, hash] {
 				this_l->work_generate (source_a, hash);
 			});
 		}
@@ -970,6 +1008,7 @@ std::shared_ptr<rai::block> rai::wallet::change_action (rai::account const & sou
 
 std::shared_ptr<rai::block> rai::wallet::send_action (rai::account const & source_a, rai::account const & account_a, rai::uint128_t const & amount_a, bool generate_work_a, boost::optional<std::string> id_a)
 {
+	auto begin (std::chrono::steady_clock::now ());
 	std::shared_ptr<rai::block> block;
 	boost::optional<rai::mdb_val> id_mdb_val;
 	if (id_a)
@@ -1041,11 +1080,13 @@ std::shared_ptr<rai::block> rai::wallet::send_action (rai::account const & sourc
 	}
 	if (!error && block != nullptr && !cached_block)
 	{
+		node.wallets.work_stats.send (std::chrono::steady_clock::now () - begin);
 		node.block_arrival.add (block->hash ());
-		node.block_processor.process_receive_many (block);
+		rai::process_return result;
+		node.block_processor.process_one (rai::block_processor_item (block), result);
 		auto hash (block->hash ());
 		auto this_l (shared_from_this ());
-		node.wallets.queue_wallet_action (rai::wallets::generate_priority, [this_l, source_a, hash] {
+		node.wallets.queue_wallet_action (rai::wallets::generate_priority, source_a, [this_l, source_a, hash] {
 			this_l->work_generate (source_a, hash);
 		});
 	}
@@ -1072,7 +1113,7 @@ bool rai::wallet::change_sync (rai::account const & source_a, rai::account const
 
 void rai::wallet::change_async (rai::account const & source_a, rai::account const & representative_a, std::function<void(std::shared_ptr<rai::block>)> const & action_a, bool generate_work_a)
 {
-	node.wallets.queue_wallet_action (rai::wallets::high_priority, [this, source_a, representative_a, action_a, generate_work_a]() {
+	node.wallets.queue_wallet_action (rai::wallets::high_priority, source_a, [this, source_a, representative_a, action_a, generate_work_a]() {
 		auto block (change_action (source_a, representative_a, generate_work_a));
 		action_a (block);
 	});
@@ -1088,10 +1129,28 @@ bool rai::wallet::receive_sync (std::shared_ptr<rai::block> block_a, rai::accoun
 	return result.get_future ().get ();
 }
 
+namespace
+{
+// The account a receive is made into, receives are only made from send blocks and state blocks link to their destination
+rai::account action_account (rai::block const & send_a)
+{
+	rai::account result (0);
+	if (auto send = dynamic_cast<rai::send_block const *> (&send_a))
+	{
+		result = send->hashables.destination;
+	}
+	else if (auto state = dynamic_cast<rai::state_block const *> (&send_a))
+	{
+		result = state->hashables.link;
+	}
+	return result;
+}
+}
+
 void rai::wallet::receive_async (std::shared_ptr<rai::block> block_a, rai::account const & representative_a, rai::uint128_t const & amount_a, std::function<void(std::shared_ptr<rai::block>)> const & action_a, bool generate_work_a)
 {
 	//assert (dynamic_cast<rai::send_block *> (block_a.get ()) != nullptr);
-	node.wallets.queue_wallet_action (amount_a, [this, block_a, representative_a, amount_a, action_a, generate_work_a]() {
+	node.wallets.queue_wallet_action (amount_a, action_account (*block_a), [this, block_a, representative_a, amount_a, action_a, generate_work_a]() {
 		auto block (receive_action (*static_cast<rai::block *> (block_a.get ()), representative_a, amount_a, generate_work_a));
 		action_a (block);
 	});
@@ -1110,7 +1169,7 @@ rai::block_hash rai::wallet::send_sync (rai::account const & source_a, rai::acco
 void rai::wallet::send_async (rai::account const & source_a, rai::account const & account_a, rai::uint128_t const & amount_a, std::function<void(std::shared_ptr<rai::block>)> const & action_a, bool generate_work_a, boost::optional<std::string> id_a)
 {
 	node.background ([this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
-		this->node.wallets.queue_wallet_action (rai::wallets::high_priority, [this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
+		this->node.wallets.queue_wallet_action (rai::wallets::high_priority, source_a, [this, source_a, account_a, amount_a, action_a, generate_work_a, id_a]() {
 			auto block (send_action (source_a, account_a, amount_a, generate_work_a, id_a));
 			action_a (block);
 		});
@@ -1138,6 +1197,7 @@ uint64_t rai::wallet::work_fetch (MDB_txn * transaction_a, rai::account const &
 {
 	uint64_t result;
 	auto error (store.work_get (transaction_a, account_a, result));
+	auto hit (false);
 	if (error)
 	{
 		result = node.generate_work (root_a);
@@ -1147,10 +1207,33 @@ uint64_t rai::wallet::work_fetch (MDB_txn * transaction_a, rai::account const &
 		BOOST_LOG (node.log) << "Cached work invalid, regenerating";
 		result = node.generate_work (root_a);
 	}
-
+	else
+	{
+		hit = true;
+	}
+	std::lock_guard<std::mutex> lock (node.wallets.work_stats.mutex);
+	hit ? ++node.wallets.work_stats.hits : ++node.wallets.work_stats.misses;
 	return result;
 }
 
+void rai::wallet::work_refresh (rai::account const & account_a)
+{
+	rai::block_hash root;
+	auto valid (true);
+	{
+		rai::transaction transaction (store.environment, nullptr, false);
+		uint64_t work;
+		root = node.ledger.latest_root (transaction, account_a);
+		valid = store.exists (transaction, account_a) && !store.work_get (transaction, account_a, work) && !rai::work_validate (root, work);
+	}
+	if (!valid)
+	{
+		work_generate (account_a, root);
+		std::lock_guard<std::mutex> lock (node.wallets.work_stats.mutex);
+		++node.wallets.work_stats.precomputed;
+	}
+}
+
 void rai::wallet::work_ensure (MDB_txn * transaction_a, rai::account const & account_a)
 {
 	assert (store.exists (transaction_a, account_a));
@@ -1187,84 +1270,106 @@ public:
 	void run ()
 	{
 		BOOST_LOG (wallet->node.log) << "Beginning pending block search";
-		rai::transaction transaction (wallet->node.store.environment, nullptr, false);
-		std::unordered_set<rai::account> already_searched;
-		for (auto i (wallet->node.store.pending_begin (transaction)), n (wallet->node.store.pending_end ()); i != n; ++i)
+		auto begin (std::chrono::steady_clock::now ());
+		// Pending entries are keyed by destination so each wallet account is a range seek, accounts are split across threads
+		std::vector<rai::account> accounts (keys.begin (), keys.end ());
+		auto thread_count (std::min<size_t> (std::max<unsigned> (std::thread::hardware_concurrency (), 1), accounts.size () / accounts_per_thread + 1));
+		std::vector<std::vector<std::pair<rai::pending_key, rai::pending_info>>> found (thread_count);
+		std::vector<std::thread> threads;
+		for (size_t i (0); i < thread_count; ++i)
 		{
-			rai::pending_key key (i->first);
-			rai::pending_info pending (i->second);
-			auto existing (keys.find (key.account));
-			if (existing != keys.end ())
-			{
-				auto amount (pending.amount.number ());
-				if (wallet->node.config.receive_minimum.number () <= amount)
+			threads.push_back (std::thread ([this, &accounts, &found, i, thread_count]() {
+				rai::transaction transaction (wallet->node.store.environment, nullptr, false);
+				for (auto j (i); j < accounts.size (); j += thread_count)
 				{
-					rai::account_info info;
-					auto error (wallet->node.store.account_get (transaction, pending.source, info));
-					assert (!error);
-					BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Found a pending block %1% from account %2% with head %3%") % key.hash.to_string () % pending.source.to_account () % info.head.to_string ());
-					auto account (pending.source);
-					if (already_searched.find (account) == already_searched.end ())
+					for (auto k (wallet->node.store.pending_begin (transaction, rai::pending_key (accounts[j], 0))), n (wallet->node.store.pending_end ()); k != n && rai::pending_key (k->first).account == accounts[j]; ++k)
 					{
-						auto this_l (shared_from_this ());
-						std::shared_ptr<rai::block> block_l (wallet->node.store.block_get (transaction, info.head));
-						wallet->node.background ([this_l, account, block_l] {
-							rai::transaction transaction (this_l->wallet->node.store.environment, nullptr, true);
-							this_l->wallet->node.active.start (transaction, block_l, [this_l, account](std::shared_ptr<rai::block>, bool) {
-								// If there were any forks for this account they've been rolled back and we can receive anything remaining from this account
-								this_l->receive_all (account);
-							});
-							this_l->wallet->node.network.broadcast_confirm_req (block_l);
-						});
-						already_searched.insert (account);
+						found[i].push_back (std::make_pair (rai::pending_key (k->first), rai::pending_info (k->second)));
 					}
 				}
+			}));
+		}
+		for (auto & i : threads)
+		{
+			i.join ();
+		}
+		size_t blocks (0);
+		for (auto & i : found)
+		{
+			for (auto & j : i)
+			{
+				if (wallet->node.config.receive_minimum.number () <= j.second.amount.number ())
+				{
+					sources[j.second.source].push_back (j.first);
+					++blocks;
+				}
 				else
 				{
-					BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Not receiving block %1% due to minimum receive threshold") % key.hash.to_string ());
+					BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Not receiving block %1% due to minimum receive threshold") % j.first.hash.to_string ());
 				}
 			}
 		}
-		BOOST_LOG (wallet->node.log) << "Pending block search phase complete";
+		rai::transaction transaction (wallet->node.store.environment, nullptr, false);
+		for (auto & i : sources)
+		{
+			auto account (i.first);
+			rai::account_info info;
+			if (!wallet->node.store.account_get (transaction, account, info))
+			{
+				BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Found %1% pending blocks from account %2% with head %3%") % i.second.size () % account.to_account () % info.head.to_string ());
+				auto this_l (shared_from_this ());
+				std::shared_ptr<rai::block> block_l (wallet->node.store.block_get (transaction, info.head));
+				wallet->node.background ([this_l, account, block_l] {
+					rai::transaction transaction (this_l->wallet->node.store.environment, nullptr, true);
+					this_l->wallet->node.active.start (transaction, block_l, [this_l, account](std::shared_ptr<rai::block>, bool) {
+						// If there were any forks for this account they've been rolled back and we can receive anything remaining from this account
+						this_l->receive_all (account);
+					});
+					this_l->wallet->node.network.broadcast_confirm_req (block_l);
+				});
+			}
+		}
+		BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Pending block search phase complete, found %1% blocks from %2% accounts in %3% milliseconds") % blocks % sources.size () % std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - begin).count ());
 	}
 	void receive_all (rai::account const & account_a)
 	{
 		BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Account %1% confirmed, receiving all blocks") % account_a.to_account ());
 		rai::transaction transaction (wallet->node.store.environment, nullptr, false);
 		auto representative (wallet->store.representative (transaction));
-		for (auto i (wallet->node.store.pending_begin (transaction)), n (wallet->node.store.pending_end ()); i != n; ++i)
+		auto existing (sources.find (account_a));
+		assert (existing != sources.end ());
+		for (auto & key : existing->second)
 		{
-			rai::pending_key key (i->first);
-			rai::pending_info pending (i->second);
-			if (pending.source == account_a)
+			rai::pending_info pending;
+			// Skip entries received since the search
+			if (!wallet->node.store.pending_get (transaction, key, pending))
 			{
-				if (wallet->store.exists (transaction, key.account))
+				if (wallet->store.valid_password (transaction))
 				{
-					if (wallet->store.valid_password (transaction))
-					{
-						rai::pending_key key (i->first);
-						std::shared_ptr<rai::block> block (wallet->node.store.block_get (transaction, key.hash));
-						auto wallet_l (wallet);
-						auto amount (pending.amount.number ());
-						BOOST_LOG (wallet_l->node.log) << boost::str (boost::format ("Receiving block: %1%") % block->hash ().to_string ());
-						wallet_l->receive_async (block, representative, amount, [wallet_l, block](std::shared_ptr<rai::block> block_a) {
-							if (block_a == nullptr)
-							{
-								BOOST_LOG (wallet_l->node.log) << boost::str (boost::format ("Error receiving block %1%") % block->hash ().to_string ());
-							}
-						},
-						true);
-					}
-					else
-					{
-						BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Unable to fetch key for: %1%, stopping pending search") % key.account.to_account ());
-					}
+					std::shared_ptr<rai::block> block (wallet->node.store.block_get (transaction, key.hash));
+					auto wallet_l (wallet);
+					auto amount (pending.amount.number ());
+					BOOST_LOG (wallet_l->node.log) << boost::str (boost::format ("Receiving block: %1%") % block->hash ().to_string ());
+					wallet_l->receive_async (block, representative, amount, [wallet_l, block](std::shared_ptr<rai::block> block_a) {
+						if (block_a == nullptr)
+						{
+							BOOST_LOG (wallet_l->node.log) << boost::str (boost::format ("Error receiving block %1%") % block->hash ().to_string ());
+						}
+					},
+					true);
+				}
+				else
+				{
+					BOOST_LOG (wallet->node.log) << boost::str (boost::format ("Unable to fetch key for: %1%, stopping pending search") % key.account.to_account ());
 				}
 			}
 		}
 	}
 	std::unordered_set<rai::uint256_union> keys;
+	// Pending entries found for the wallet grouped by the account that sent them, read-only once the search phase completes
+	std::unordered_map<rai::account, std::vector<rai::pending_key>> sources;
 	std::shared_ptr<rai::wallet> wallet;
+	static size_t constexpr accounts_per_thread = 1024;
 };
 }
 
@@ -1295,6 +1400,31 @@ void rai::wallet::init_free_accounts (MDB_txn * transaction_a)
 	}
 }
 
+void rai::wallet::representatives_compute (MDB_txn * transaction_a)
+{
+	std::unordered_set<rai::account> representatives_l;
+	for (auto i (store.begin (transaction_a)), n (store.end ()); i != n; ++i)
+	{
+		rai::account account (i->first.uint256 ());
+		if (!rai::wallet_value (i->second).key.is_zero () && !node.ledger.weight (transaction_a, account).is_zero ())
+		{
+			representatives_l.insert (account);
+		}
+	}
+	std::lock_guard<std::mutex> lock (representatives_mutex);
+	representatives.swap (representatives_l);
+}
+
+void rai::wallet::representative_insert (MDB_txn * transaction_a, rai::public_key const & account_a)
+{
+	auto existing (store.find (transaction_a, account_a));
+	if (existing != store.end () && !rai::wallet_value (existing->second).key.is_zero () && !node.ledger.weight (transaction_a, account_a).is_zero ())
+	{
+		std::lock_guard<std::mutex> lock (representatives_mutex);
+		representatives.insert (account_a);
+	}
+}
+
 rai::public_key rai::wallet::change_seed (MDB_txn * transaction_a, rai::raw_key const & prv_a)
 {
 	store.seed_set (transaction_a, prv_a);
@@ -1331,6 +1461,8 @@ rai::public_key rai::wallet::change_seed (MDB_txn * transaction_a, rai::raw_key
 		// Generate work for first 4 accounts only to prevent weak CPU nodes stuck
 		account = deterministic_insert (transaction_a, i < 4);
 	}
+	// Keys of the previous seed were cleared
+	representatives_compute (transaction_a);
 
 	return account;
 }
@@ -1350,12 +1482,41 @@ void rai::wallet::work_generate (rai::account const & account_a, rai::block_hash
 	}
 }
 
+rai::work_cache_stats::work_cache_stats () :
+hits (0),
+misses (0),
+precomputed (0),
+sends (0),
+send_time_total (0),
+send_time_max (0)
+{
+}
+
+void rai::work_cache_stats::send (std::chrono::steady_clock::duration const & duration_a)
+{
+	auto duration (std::chrono::duration_cast<std::chrono::microseconds> (duration_a));
+	std::lock_guard<std::mutex> lock (mutex);
+	++sends;
+	send_time_total += duration;
+	send_time_max = std::max (send_time_max, duration);
+}
+
+rai::wallet_action_queue::wallet_action_queue () :
+running (false)
+{
+}
+
 rai::wallets::wallets (bool & error_a, rai::node & node_a) :
 observer ([](bool) {}),
+running (0),
+generating (0),
 node (node_a),
-stopped (false),
-thread ([this]() { do_wallet_actions (); })
+stopped (false)
 {
+	for (auto i (0u), n (node_a.config.wallet_action_threads); i < n; ++i)
+	{
+		threads.push_back (std::thread ([this]() { do_wallet_actions (); }));
+	}
 	if (!error_a)
 	{
 		rai::transaction transaction (node.store.environment, nullptr, true);
@@ -1377,6 +1538,7 @@ thread ([this]() { do_wallet_actions (); })
 				node_a.background ([wallet]() {
 					wallet->enter_initial_password ();
 				});
+				wallet->representatives_compute (transaction);
 				items[id] = wallet;
 			}
 			else
@@ -1390,11 +1552,15 @@ thread ([this]() { do_wallet_actions (); })
 rai::wallets::~wallets ()
 {
 	stop ();
-	thread.join ();
+	for (auto & i : threads)
+	{
+		i.join ();
+	}
 }
 
 std::shared_ptr<rai::wallet> rai::wallets::open (rai::uint256_union const & id_a)
 {
+	std::lock_guard<std::mutex> lock (mutex);
 	std::shared_ptr<rai::wallet> result;
 	auto existing (items.find (id_a));
 	if (existing != items.end ())
@@ -1415,7 +1581,10 @@ std::shared_ptr<rai::wallet> rai::wallets::create (rai::uint256_union const & id
 	}
 	if (!error)
 	{
-		items[id_a] = result;
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			items[id_a] = result;
+		}
 		node.background ([result]() {
 			result->enter_initial_password ();
 		});
@@ -1447,28 +1616,72 @@ void rai::wallets::search_pending_all ()
 void rai::wallets::destroy (rai::uint256_union const & id_a)
 {
 	rai::transaction transaction (node.store.environment, nullptr, true);
-	auto existing (items.find (id_a));
-	assert (existing != items.end ());
-	auto wallet (existing->second);
-	items.erase (existing);
+	std::shared_ptr<rai::wallet> wallet;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		auto existing (items.find (id_a));
+		assert (existing != items.end ());
+		wallet = existing->second;
+		items.erase (existing);
+	}
 	wallet->store.destroy (transaction);
 }
 
 void rai::wallets::do_wallet_actions ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
+	auto generating_max (std::max<unsigned> (node.config.wallet_action_threads, 2) - 1);
 	while (!stopped)
 	{
-		if (!actions.empty ())
+		auto next (ready.begin ());
+		if (next != ready.end () && next->first == generate_priority && generating >= generating_max)
 		{
-			auto first (actions.begin ());
+			// Generate actions sort first, skip past them to the highest priority send
+			next = ready.upper_bound (generate_priority);
+		}
+		if (next != ready.end ())
+		{
+			auto account (next->second);
+			auto generate (next->first == generate_priority);
+			ready.erase (next);
+			auto & queue (actions[account]);
+			auto first (queue.actions.begin ());
+			--depth[priority_class (first->first)];
 			auto current (std::move (first->second));
-			actions.erase (first);
+			queue.actions.erase (first);
+			queue.running = true;
+			if (generate)
+			{
+				++generating;
+			}
+			auto notify (running++ == 0);
 			lock.unlock ();
-			observer (true);
+			if (notify)
+			{
+				observer (true);
+			}
 			current ();
-			observer (false);
 			lock.lock ();
+			if (generate)
+			{
+				--generating;
+			}
+			auto & queue_l (actions[account]);
+			queue_l.running = false;
+			if (queue_l.actions.empty ())
+			{
+				actions.erase (account);
+			}
+			else
+			{
+				queue_l.ready = ready.insert (std::make_pair (queue_l.actions.begin ()->first, account));
+			}
+			if (--running == 0)
+			{
+				lock.unlock ();
+				observer (false);
+				lock.lock ();
+			}
 		}
 		else
 		{
@@ -1477,44 +1690,150 @@ void rai::wallets::do_wallet_actions ()
 	}
 }
 
-void rai::wallets::queue_wallet_action (rai::uint128_t const & amount_a, std::function<void()> const & action_a)
+void rai::wallets::queue_wallet_action (rai::uint128_t const & amount_a, rai::account const & account_a, std::function<void()> const & action_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
-	actions.insert (std::make_pair (amount_a, std::move (action_a)));
-	condition.notify_all ();
+	auto & queue (actions[account_a]);
+	auto was_ready (!queue.running && !queue.actions.empty ());
+	auto position (queue.actions.insert (std::make_pair (amount_a, std::move (action_a))));
+	++depth[priority_class (amount_a)];
+	// The account only moves in the ready order when its next action changes
+	if (!queue.running && (!was_ready || position == queue.actions.begin ()))
+	{
+		if (was_ready)
+		{
+			ready.erase (queue.ready);
+		}
+		queue.ready = ready.insert (std::make_pair (queue.actions.begin ()->first, account_a));
+		condition.notify_one ();
+	}
+}
+
+std::unordered_map<std::string, size_t> rai::wallets::queue_depth ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return depth;
+}
+
+void rai::wallets::work_precache (rai::account const & account_a)
+{
+	// Watch-only accounts can't sign so they never need work
+	for (auto & wallet : owners (account_a))
+	{
+		queue_wallet_action (generate_priority, account_a, [wallet, account_a]() {
+			wallet->work_refresh (account_a);
+		});
+	}
+}
+
+std::vector<std::shared_ptr<rai::wallet>> rai::wallets::owners (rai::account const & account_a)
+{
+	std::vector<std::shared_ptr<rai::wallet>> result;
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto & i : items)
+	{
+		if (i.second->store.spendable (account_a))
+		{
+			result.push_back (i.second);
+		}
+	}
+	return result;
+}
+
+bool rai::wallets::have_representatives ()
+{
+	auto result (false);
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto i (items.begin ()), n (items.end ()); !result && i != n; ++i)
+	{
+		std::lock_guard<std::mutex> representatives_lock (i->second->representatives_mutex);
+		result = !i->second->representatives.empty ();
+	}
+	return result;
+}
+
+std::string rai::wallets::priority_class (rai::uint128_t const & amount_a)
+{
+	return amount_a == generate_priority ? "generate" : amount_a == high_priority ? "high" : "normal";
 }
 
 void rai::wallets::foreach_representative (MDB_txn * transaction_a, std::function<void(rai::public_key const & pub_a, rai::raw_key const & prv_a)> const & action_a)
 {
-	for (auto i (items.begin ()), n (items.end ()); i != n; ++i)
+	std::vector<std::pair<rai::uint256_union, std::shared_ptr<rai::wallet>>> items_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		items_l.assign (items.begin (), items.end ());
+	}
+	for (auto i (items_l.begin ()), n (items_l.end ()); i != n; ++i)
 	{
 		auto & wallet (*i->second);
-		for (auto j (wallet.store.begin (transaction_a)), m (wallet.store.end ()); j != m; ++j)
+		std::vector<rai::account> representatives_l;
 		{
-			rai::account account (j->first.uint256 ());
-			if (!node.ledger.weight (transaction_a, account).is_zero ())
+			std::lock_guard<std::mutex> lock (wallet.representatives_mutex);
+			representatives_l.assign (wallet.representatives.begin (), wallet.representatives.end ());
+		}
+		if (!representatives_l.empty ())
+		{
+			if (wallet.store.valid_password (transaction_a))
 			{
-				if (wallet.store.valid_password (transaction_a))
-				{
-					rai::raw_key prv;
-					auto error (wallet.store.fetch (transaction_a, j->first.uint256 (), prv));
-					assert (!error);
-					action_a (j->first.uint256 (), prv);
-				}
-				else
+				for (auto & account : representatives_l)
 				{
-					static auto last_log = std::chrono::steady_clock::time_point ();
-					if (last_log < std::chrono::steady_clock::now () - std::chrono::seconds (60))
+					if (!node.ledger.weight (transaction_a, account).is_zero ())
 					{
-						last_log = std::chrono::steady_clock::now ();
-						BOOST_LOG (node.log) << boost::str (boost::format ("Representative locked inside wallet %1%") % i->first.to_string ());
+						// Only the account set is kept, keys stay encrypted and are decrypted for each use so locking the wallet takes effect immediately
+						rai::raw_key prv;
+						auto found (wallet.store.spendable (account) && !wallet.store.fetch (transaction_a, account, prv));
+						if (found)
+						{
+							action_a (account, prv);
+						}
+						else
+						{
+							// The key was removed from the wallet
+							std::lock_guard<std::mutex> lock (wallet.representatives_mutex);
+							wallet.representatives.erase (account);
+						}
 					}
 				}
 			}
+			else
+			{
+				static auto last_log = std::chrono::steady_clock::time_point ();
+				if (last_log < std::chrono::steady_clock::now () - std::chrono::seconds (60))
+				{
+					last_log = std::chrono::steady_clock::now ();
+					BOOST_LOG (node.log) << boost::str (boost::format ("Representative locked inside wallet %1%") % i->first.to_string ());
+				}
+			}
 		}
 	}
 }
 
+void rai::wallets::representative_update (rai::account const & account_a)
+{
+	std::vector<std::shared_ptr<rai::wallet>> wallets_l;
+	for (auto & wallet : owners (account_a))
+	{
+		std::lock_guard<std::mutex> lock (wallet->representatives_mutex);
+		if (wallet->representatives.count (account_a) == 0)
+		{
+			wallets_l.push_back (wallet);
+		}
+	}
+	if (!wallets_l.empty ())
+	{
+		// Checking the weight needs a transaction, which isn't opened on the block processor thread
+		auto node_l (node.shared ());
+		node.background ([node_l, wallets_l, account_a]() {
+			rai::transaction transaction (node_l->store.environment, nullptr, false);
+			for (auto & wallet : wallets_l)
+			{
+				wallet->representative_insert (transaction, account_a);
+			}
+		});
+	}
+}
+
 bool rai::wallets::exists (MDB_txn * transaction_a, rai::public_key const & account_a)
 {
 	auto result (false);
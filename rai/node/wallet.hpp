@@ -5,9 +5,11 @@
 #include <rai/node/common.hpp>
 #include <rai/node/openclwork.hpp>
 
+#include <map>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace rai
@@ -80,6 +82,8 @@ public:
 	void entry_put_raw (MDB_txn *, rai::public_key const &, rai::wallet_value const &);
 	bool fetch (MDB_txn *, rai::public_key const &, rai::raw_key &);
 	bool exists (MDB_txn *, rai::public_key const &);
+	// Returns true if the wallet holds the private key for the account, answered from memory without a transaction
+	bool spendable (rai::public_key const &);
 	void destroy (MDB_txn *);
 	rai::store_iterator find (MDB_txn *, rai::uint256_union const &);
 	rai::store_iterator begin (MDB_txn *, rai::uint256_union const &);
@@ -117,6 +121,9 @@ public:
 	rai::mdb_env & environment;
 	MDB_dbi handle;
 	std::recursive_mutex mutex;
+	// Accounts with a private key, kept in step with entry_put_raw and erase
+	std::unordered_set<rai::account> spendable_accounts;
+	std::mutex spendable_mutex;
 };
 class node;
 // A wallet is a set of account keys encrypted by a common encryption key
@@ -149,16 +156,50 @@ public:
 	void work_update (MDB_txn *, rai::account const &, rai::block_hash const &, uint64_t);
 	uint64_t work_fetch (MDB_txn *, rai::account const &, rai::block_hash const &);
 	void work_ensure (MDB_txn *, rai::account const &);
+	// Generates work for the account's current root unless the cached work is still valid
+	void work_refresh (rai::account const &);
 	bool search_pending ();
 	void init_free_accounts (MDB_txn *);
 	bool should_generate_state_block (MDB_txn *, rai::block_hash const &);
 	/** Changes the wallet seed and returns the first account */
 	rai::public_key change_seed (MDB_txn * transaction_a, rai::raw_key const & prv_a);
+	// Rebuilds the set of accounts with voting weight from every key in the wallet
+	void representatives_compute (MDB_txn *);
+	// Adds the account to the representatives if it's a spendable key in this wallet and has weight
+	void representative_insert (MDB_txn *, rai::public_key const &);
 	std::unordered_set<rai::account> free_accounts;
+	// Accounts that had voting weight, removed keys are dropped when votes find they can't be fetched
+	std::unordered_set<rai::account> representatives;
+	std::mutex representatives_mutex;
 	std::function<void(bool, bool)> lock_observer;
 	rai::wallet_store store;
 	rai::node & node;
 };
+class work_cache_stats
+{
+public:
+	work_cache_stats ();
+	void send (std::chrono::steady_clock::duration const &);
+	std::mutex mutex;
+	// Blocks created with cached work and with work generated while the action waited
+	uint64_t hits;
+	uint64_t misses;
+	// Work generated ahead of time because a wallet account's root changed
+	uint64_t precomputed;
+	uint64_t sends;
+	std::chrono::microseconds send_time_total;
+	std::chrono::microseconds send_time_max;
+};
+// Actions queued for one account, they run one at a time in priority order
+class wallet_action_queue
+{
+public:
+	wallet_action_queue ();
+	std::multimap<rai::uint128_t, std::function<void()>, std::greater<rai::uint128_t>> actions;
+	// Entry in wallets::ready while the account has actions and none is running
+	std::multimap<rai::uint128_t, rai::account, std::greater<rai::uint128_t>>::iterator ready;
+	bool running;
+};
 // The wallets set is all the wallets a node controls.  A node may contain multiple wallets independently encrypted and operated.
 class wallets
 {
@@ -171,13 +212,35 @@ public:
 	void search_pending_all ();
 	void destroy (rai::uint256_union const &);
 	void do_wallet_actions ();
-	void queue_wallet_action (rai::uint128_t const &, std::function<void()> const &);
+	// Actions for the same account are serialized, different accounts run concurrently on the action threads
+	void queue_wallet_action (rai::uint128_t const &, rai::account const &, std::function<void()> const &);
+	// Queued actions per priority class: generate, high and normal
+	std::unordered_map<std::string, size_t> queue_depth ();
+	// Called when an account's chain or balance changes, keeps cached work valid for wallet accounts
+	// Cheap for accounts outside the wallets, nothing is queued and no transaction is opened
+	void work_precache (rai::account const &);
+	// Wallets holding the private key for the account
+	std::vector<std::shared_ptr<rai::wallet>> owners (rai::account const &);
+	static std::string priority_class (rai::uint128_t const &);
+	// Visits the cached representatives of unlocked wallets that currently have weight
 	void foreach_representative (MDB_txn *, std::function<void(rai::public_key const &, rai::raw_key const &)> const &);
+	// Called with the representative of each processed block, which may have just gained weight
+	// Only accounts owned by a wallet and not yet cached are checked against the ledger in the background
+	void representative_update (rai::account const &);
+	// True if any wallet has cached a representative, checked without a transaction
+	bool have_representatives ();
 	bool exists (MDB_txn *, rai::public_key const &);
 	void stop ();
 	std::function<void(bool)> observer;
+	// Modified under mutex
 	std::unordered_map<rai::uint256_union, std::shared_ptr<rai::wallet>> items;
-	std::multimap<rai::uint128_t, std::function<void()>, std::greater<rai::uint128_t>> actions;
+	std::unordered_map<rai::account, rai::wallet_action_queue> actions;
+	// Accounts with an action ready to run, ordered by the priority of that action
+	std::multimap<rai::uint128_t, rai::account, std::greater<rai::uint128_t>> ready;
+	std::unordered_map<std::string, size_t> depth;
+	unsigned running;
+	// Work generation actions running, capped so one action thread always stays free for sends
+	unsigned generating;
 	std::mutex mutex;
 	std::condition_variable condition;
 	rai::kdf kdf;
@@ -185,7 +248,8 @@ public:
 	MDB_dbi send_action_ids;
 	rai::node & node;
 	bool stopped;
-	std::thread thread;
+	std::vector<std::thread> threads;
+	rai::work_cache_stats work_stats;
 	static rai::uint128_t const generate_priority;
 	static rai::uint128_t const high_priority;
 };
@@ -0,0 +1,449 @@
+#include <rai/node/websocket.hpp>
+
+#include <rai/node/bootstrap.hpp>
+#include <rai/node/node.hpp>
+#include <rai/node/rpc.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+constexpr std::chrono::seconds rai::websocket_server::progress_interval;
+
+namespace
+{
+std::unordered_map<std::string, rai::websocket_topic> const & websocket_topics ()
+{
+	static std::unordered_map<std::string, rai::websocket_topic> const topics = {
+		{ "confirmation", rai::websocket_topic::confirmation },
+		{ "vote", rai::websocket_topic::vote },
+		{ "block", rai::websocket_topic::block },
+		{ "bootstrap", rai::websocket_topic::bootstrap }
+	};
+	return topics;
+}
+
+std::shared_ptr<std::string const> websocket_message (boost::property_tree::ptree const & tree_a)
+{
+	std::stringstream stream;
+	boost::property_tree::write_json (stream, tree_a, false);
+	return std::make_shared<std::string const> (stream.str ());
+}
+}
+
+rai::websocket_topic rai::websocket_topic_parse (std::string const & name_a)
+{
+	auto existing (websocket_topics ().find (name_a));
+	return existing != websocket_topics ().end () ? existing->second : rai::websocket_topic::invalid;
+}
+
+std::string rai::websocket_topic_name (rai::websocket_topic topic_a)
+{
+	std::string result;
+	for (auto & i : websocket_topics ())
+	{
+		if (i.second == topic_a)
+		{
+			result = i.first;
+		}
+	}
+	return result;
+}
+
+rai::websocket_session::websocket_session (std::shared_ptr<rai::websocket_server> server_a, boost::asio::ip::tcp::socket socket_a) :
+server (server_a),
+ws (std::move (socket_a)),
+strand (server_a->node.service),
+closed (false)
+{
+}
+
+void rai::websocket_session::accept (boost::beast::http::request<boost::beast::http::string_body> request_a)
+{
+	auto this_l (shared_from_this ());
+	upgrade = std::move (request_a);
+	ws.text (true);
+	ws.read_message_max (64 * 1024);
+	strand.post ([this_l]() {
+		this_l->ws.async_accept (this_l->upgrade, this_l->strand.wrap ([this_l](boost::system::error_code const & ec) {
+			if (!ec)
+			{
+				this_l->read ();
+			}
+			else
+			{
+				BOOST_LOG (this_l->server->node.log) << "Websocket handshake error: " << ec.message ();
+			}
+		}));
+	});
+}
+
+void rai::websocket_session::read ()
+{
+	auto this_l (shared_from_this ());
+	ws.async_read (buffer, strand.wrap ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec)
+		{
+			std::string text (boost::asio::buffers_begin (this_l->buffer.data ()), boost::asio::buffers_end (this_l->buffer.data ()));
+			this_l->buffer.consume (this_l->buffer.size ());
+			this_l->handle (text);
+			this_l->read ();
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock (this_l->mutex);
+			this_l->closed = true;
+			this_l->queue.clear ();
+		}
+	}));
+}
+
+void rai::websocket_session::handle (std::string const & text_a)
+{
+	boost::property_tree::ptree request;
+	boost::property_tree::ptree response;
+	if (!rai::parse_json (text_a, request))
+	{
+		auto action (request.get<std::string> ("action", ""));
+		auto topic (rai::websocket_topic_parse (request.get<std::string> ("topic", "")));
+		if ((action == "subscribe" || action == "unsubscribe") && topic != rai::websocket_topic::invalid)
+		{
+			std::unordered_set<rai::account> accounts;
+			auto error (false);
+			auto accounts_l (request.get_child_optional ("accounts"));
+			if (accounts_l)
+			{
+				for (auto & i : accounts_l.get ())
+				{
+					rai::account account;
+					error = error || account.decode_account (i.second.data ());
+					accounts.insert (account);
+				}
+			}
+			if (!error)
+			{
+				{
+					std::lock_guard<std::mutex> lock (mutex);
+					if (action == "subscribe")
+					{
+						subscriptions[topic] = accounts;
+					}
+					else
+					{
+						subscriptions.erase (topic);
+					}
+				}
+				response.put ("ack", action);
+				response.put ("topic", rai::websocket_topic_name (topic));
+			}
+			else
+			{
+				response.put ("error", "Bad account number");
+			}
+		}
+		else
+		{
+			response.put ("error", "Unknown action or topic");
+		}
+	}
+	else
+	{
+		response.put ("error", "Unable to parse JSON");
+	}
+	send (websocket_message (response));
+}
+
+bool rai::websocket_session::subscribed (rai::websocket_topic topic_a, std::vector<rai::account> const & accounts_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (subscriptions.find (topic_a));
+	auto result (!closed && existing != subscriptions.end ());
+	if (result && !existing->second.empty ())
+	{
+		result = false;
+		for (auto i (accounts_a.begin ()), n (accounts_a.end ()); i != n && !result; ++i)
+		{
+			result = existing->second.find (*i) != existing->second.end ();
+		}
+	}
+	return result;
+}
+
+bool rai::websocket_session::send (std::shared_ptr<std::string const> message_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (false);
+	if (!closed)
+	{
+		if (queue.size () < server->queue_max)
+		{
+			queue.push_back (message_a);
+			if (writing == nullptr)
+			{
+				auto this_l (shared_from_this ());
+				strand.post ([this_l]() {
+					this_l->write_next ();
+				});
+			}
+		}
+		else
+		{
+			result = true;
+			closed = true;
+			server->dropped += queue.size () + 1;
+			queue.clear ();
+			auto this_l (shared_from_this ());
+			strand.post ([this_l]() {
+				this_l->close ();
+			});
+		}
+	}
+	return result;
+}
+
+void rai::websocket_session::write_next ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (writing == nullptr && !queue.empty ())
+	{
+		writing = queue.front ();
+		queue.pop_front ();
+		lock.unlock ();
+		auto this_l (shared_from_this ());
+		ws.async_write (boost::asio::buffer (*writing), strand.wrap ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+			{
+				std::lock_guard<std::mutex> lock (this_l->mutex);
+				this_l->writing = nullptr;
+			}
+			if (!ec)
+			{
+				++this_l->server->sent;
+				this_l->write_next ();
+			}
+			else
+			{
+				this_l->close ();
+			}
+		}));
+	}
+}
+
+void rai::websocket_session::close ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		closed = true;
+		queue.clear ();
+	}
+	// Closing the socket aborts any write in progress, a close frame would have to wait behind it
+	boost::system::error_code ignored;
+	ws.next_layer ().close (ignored);
+}
+
+rai::websocket_server::websocket_server (rai::node & node_a, size_t queue_max_a, size_t sessions_max_a) :
+node (node_a),
+queue_max (queue_max_a),
+sessions_max (sessions_max_a),
+progress_running (false),
+sent (0),
+dropped (0),
+stopped (false)
+{
+}
+
+void rai::websocket_server::start ()
+{
+	std::weak_ptr<rai::websocket_server> this_w (shared_from_this ());
+	node.observers.blocks.add ([this_w](std::shared_ptr<rai::block> block_a, rai::process_return const & result_a) {
+		auto this_l (this_w.lock ());
+		if (this_l != nullptr && this_l->subscribed (rai::websocket_topic::block))
+		{
+			boost::property_tree::ptree event;
+			event.put ("account", result_a.account.to_account ());
+			event.put ("hash", block_a->hash ().to_string ());
+			event.put ("amount", result_a.amount.to_string_dec ());
+			event.put ("is_send", result_a.state_is_send ? "true" : "false");
+			event.put ("contents", block_a->to_json ());
+			this_l->broadcast (rai::websocket_topic::block, { result_a.account, result_a.pending_account }, event);
+		}
+	});
+	node.observers.confirmed.add ([this_w](std::shared_ptr<rai::block> block_a) {
+		auto this_l (this_w.lock ());
+		if (this_l != nullptr && this_l->subscribed (rai::websocket_topic::confirmation))
+		{
+			rai::transaction transaction (this_l->node.store.environment, nullptr, false);
+			auto hash (block_a->hash ());
+			if (this_l->node.store.block_exists (transaction, hash))
+			{
+				auto account (this_l->node.ledger.account (transaction, hash));
+				boost::property_tree::ptree event;
+				event.put ("account", account.to_account ());
+				event.put ("hash", hash.to_string ());
+				event.put ("amount", this_l->node.ledger.amount (transaction, hash).convert_to<std::string> ());
+				event.put ("contents", block_a->to_json ());
+				this_l->broadcast (rai::websocket_topic::confirmation, { account }, event);
+			}
+		}
+	});
+	node.observers.vote.add ([this_w](std::shared_ptr<rai::vote> vote_a, rai::endpoint const &) {
+		auto this_l (this_w.lock ());
+		if (this_l != nullptr && this_l->subscribed (rai::websocket_topic::vote))
+		{
+			boost::property_tree::ptree event;
+			event.put ("account", vote_a->account.to_account ());
+			event.put ("sequence", std::to_string (vote_a->sequence));
+			boost::property_tree::ptree blocks;
+			for (auto & hash : vote_a->block_hashes ())
+			{
+				boost::property_tree::ptree entry;
+				entry.put ("", hash.to_string ());
+				blocks.push_back (std::make_pair ("", entry));
+			}
+			event.add_child ("blocks", blocks);
+			this_l->broadcast (rai::websocket_topic::vote, { vote_a->account }, event);
+		}
+	});
+	// Bootstrap observers are called with the initiator locked, progress is read later from the alarm thread
+	node.bootstrap_initiator.add_observer ([this_w](bool in_progress_a) {
+		auto this_l (this_w.lock ());
+		if (this_l != nullptr && this_l->subscribed (rai::websocket_topic::bootstrap))
+		{
+			boost::property_tree::ptree event;
+			event.put ("in_progress", in_progress_a ? "true" : "false");
+			this_l->broadcast (rai::websocket_topic::bootstrap, {}, event);
+			if (in_progress_a && !this_l->progress_running.exchange (true))
+			{
+				this_l->node.alarm.add (std::chrono::steady_clock::now () + progress_interval, [this_w]() {
+					if (auto this_l = this_w.lock ())
+					{
+						this_l->bootstrap_progress ();
+					}
+				});
+			}
+		}
+	});
+}
+
+void rai::websocket_server::bootstrap_progress ()
+{
+	auto attempt (node.bootstrap_initiator.current_attempt ());
+	if (attempt != nullptr && !stopped)
+	{
+		if (subscribed (rai::websocket_topic::bootstrap))
+		{
+			boost::property_tree::ptree event;
+			event.put ("in_progress", "true");
+			{
+				std::lock_guard<std::mutex> lock (attempt->mutex);
+				event.put ("pulls", std::to_string (attempt->pulls.size ()));
+			}
+			event.put ("pulling", std::to_string (attempt->pulling));
+			event.put ("connections", std::to_string (attempt->connections));
+			event.put ("accounts", std::to_string (attempt->account_count));
+			event.put ("blocks", std::to_string (attempt->total_blocks));
+			broadcast (rai::websocket_topic::bootstrap, {}, event);
+		}
+		std::weak_ptr<rai::websocket_server> this_w (shared_from_this ());
+		node.alarm.add (std::chrono::steady_clock::now () + progress_interval, [this_w]() {
+			if (auto this_l = this_w.lock ())
+			{
+				this_l->bootstrap_progress ();
+			}
+		});
+	}
+	else
+	{
+		progress_running = false;
+	}
+}
+
+void rai::websocket_server::stop ()
+{
+	std::vector<std::shared_ptr<rai::websocket_session>> sessions_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		for (auto & i : sessions)
+		{
+			if (auto session = i.lock ())
+			{
+				sessions_l.push_back (session);
+			}
+		}
+		sessions.clear ();
+	}
+	for (auto & i : sessions_l)
+	{
+		i->strand.post ([i]() {
+			i->close ();
+		});
+	}
+}
+
+void rai::websocket_server::accept (boost::asio::ip::tcp::socket socket_a, boost::beast::http::request<boost::beast::http::string_body> request_a)
+{
+	auto session (std::make_shared<rai::websocket_session> (shared_from_this (), std::move (socket_a)));
+	std::unique_lock<std::mutex> lock (mutex);
+	sessions.erase (std::remove_if (sessions.begin (), sessions.end (), [](std::weak_ptr<rai::websocket_session> const & session_a) { return session_a.expired (); }), sessions.end ());
+	if (!stopped && sessions.size () < sessions_max)
+	{
+		sessions.push_back (session);
+		lock.unlock ();
+		session->accept (std::move (request_a));
+	}
+	else
+	{
+		lock.unlock ();
+		BOOST_LOG (node.log) << boost::str (boost::format ("Closing websocket connection, limit of %1% sessions reached") % sessions_max);
+		boost::system::error_code ignored;
+		session->ws.next_layer ().close (ignored);
+	}
+}
+
+bool rai::websocket_server::subscribed (rai::websocket_topic topic_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (false);
+	for (auto i (sessions.begin ()), n (sessions.end ()); i != n && !result; ++i)
+	{
+		if (auto session = i->lock ())
+		{
+			std::lock_guard<std::mutex> session_lock (session->mutex);
+			result = !session->closed && session->subscriptions.find (topic_a) != session->subscriptions.end ();
+		}
+	}
+	return result;
+}
+
+void rai::websocket_server::broadcast (rai::websocket_topic topic_a, std::vector<rai::account> const & accounts_a, boost::property_tree::ptree const & event_a)
+{
+	std::vector<std::shared_ptr<rai::websocket_session>> targets;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		for (auto & i : sessions)
+		{
+			auto session (i.lock ());
+			if (session != nullptr && session->subscribed (topic_a, accounts_a))
+			{
+				targets.push_back (session);
+			}
+		}
+	}
+	if (!targets.empty ())
+	{
+		// Serialized once, every session queues the same immutable text
+		boost::property_tree::ptree message;
+		message.put ("topic", rai::websocket_topic_name (topic_a));
+		message.put ("time", std::to_string (std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::system_clock::now ().time_since_epoch ()).count ()));
+		message.add_child ("message", event_a);
+		auto text (websocket_message (message));
+		for (auto & i : targets)
+		{
+			if (i->send (text))
+			{
+				BOOST_LOG (node.log) << "Dropping websocket subscriber that fell behind";
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <rai/lib/numbers.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rai
+{
+class node;
+enum class websocket_topic
+{
+	invalid,
+	confirmation,
+	vote,
+	block,
+	bootstrap
+};
+// Returns websocket_topic::invalid for unknown names
+rai::websocket_topic websocket_topic_parse (std::string const &);
+std::string websocket_topic_name (rai::websocket_topic);
+class websocket_server;
+/**
+ * A client that upgraded an RPC connection, receiving events for the topics it subscribed to
+ * Messages wait in a bounded queue while the socket is busy, a client that lets it fill is disconnected
+ */
+class websocket_session : public std::enable_shared_from_this<rai::websocket_session>
+{
+public:
+	websocket_session (std::shared_ptr<rai::websocket_server>, boost::asio::ip::tcp::socket);
+	void accept (boost::beast::http::request<boost::beast::http::string_body>);
+	void read ();
+	void handle (std::string const &);
+	// Returns true if the session wants events of this topic concerning any of the accounts
+	bool subscribed (rai::websocket_topic, std::vector<rai::account> const &);
+	// Returns true if the queue was full and the session is being dropped
+	bool send (std::shared_ptr<std::string const>);
+	void write_next ();
+	void close ();
+	std::shared_ptr<rai::websocket_server> server;
+	boost::beast::websocket::stream<boost::asio::ip::tcp::socket> ws;
+	// Operations on the stream run on the strand since events are queued from any thread
+	boost::asio::io_service::strand strand;
+	boost::beast::http::request<boost::beast::http::string_body> upgrade;
+	boost::beast::flat_buffer buffer;
+	std::mutex mutex;
+	// An empty account set receives every event of the topic
+	std::unordered_map<rai::websocket_topic, std::unordered_set<rai::account>> subscriptions;
+	std::deque<std::shared_ptr<std::string const>> queue;
+	std::shared_ptr<std::string const> writing;
+	bool closed;
+};
+/**
+ * Serializes each node event once and hands the same message to every subscribed session
+ */
+class websocket_server : public std::enable_shared_from_this<rai::websocket_server>
+{
+public:
+	websocket_server (rai::node &, size_t, size_t);
+	// Registers the node observers, events are only built while someone is subscribed
+	void start ();
+	void stop ();
+	void accept (boost::asio::ip::tcp::socket, boost::beast::http::request<boost::beast::http::string_body>);
+	bool subscribed (rai::websocket_topic);
+	void broadcast (rai::websocket_topic, std::vector<rai::account> const &, boost::property_tree::ptree const &);
+	// Reports the running bootstrap attempt every interval until it finishes
+	void bootstrap_progress ();
+	rai::node & node;
+	std::mutex mutex;
+	std::vector<std::weak_ptr<rai::websocket_session>> sessions;
+	// Messages queued for a session before it's considered too slow and disconnected
+	size_t queue_max;
+	size_t sessions_max;
+	std::atomic<bool> progress_running;
+	std::atomic<uint64_t> sent;
+	std::atomic<uint64_t> dropped;
+	bool stopped;
+	static std::chrono::seconds constexpr progress_interval = std::chrono::seconds (1);
+};
+}
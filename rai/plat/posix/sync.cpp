@@ -0,0 +1,19 @@
+#include <rai/node/utility.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rai
+{
+bool sync_path (boost::filesystem::path const & path_a)
+{
+	auto result (true);
+	auto descriptor (::open (path_a.string ().c_str (), O_RDONLY));
+	if (descriptor != -1)
+	{
+		result = ::fsync (descriptor) != 0;
+		::close (descriptor);
+	}
+	return result;
+}
+}
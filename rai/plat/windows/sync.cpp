@@ -0,0 +1,23 @@
+#include <rai/node/utility.hpp>
+
+#include <windows.h>
+
+namespace rai
+{
+bool sync_path (boost::filesystem::path const & path_a)
+{
+	auto result (false);
+	// Directory entries can't be flushed on Windows, renames are written through by the file system
+	if (!boost::filesystem::is_directory (path_a))
+	{
+		result = true;
+		auto handle (CreateFileW (path_a.wstring ().c_str (), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
+		if (handle != INVALID_HANDLE_VALUE)
+		{
+			result = !FlushFileBuffers (handle);
+			CloseHandle (handle);
+		}
+	}
+	return result;
+}
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <rai/node/rpc.hpp>
 #include <rai/node/testing.hpp>
 
 #include <thread>
@@ -428,3 +429,363 @@ TEST (store, vote_load)
 		node.vote_processor.vote (vote, system.nodes[0]->network.endpoint ());
 	}
 }
+
+TEST (store, bulk_load)
+{
+	size_t count (1000000);
+	std::vector<std::pair<rai::pending_key, rai::pending_info>> entries;
+	for (size_t i (0); i < count; ++i)
+	{
+		rai::account account;
+		rai::block_hash hash;
+		rai::random_pool.GenerateBlock (account.bytes.data (), account.bytes.size ());
+		rai::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
+		entries.push_back (std::make_pair (rai::pending_key (account, hash), rai::pending_info (account, i)));
+	}
+	bool init1 (false);
+	rai::block_store store1 (init1, rai::unique_path ());
+	ASSERT_FALSE (init1);
+	auto begin (std::chrono::steady_clock::now ());
+	{
+		rai::transaction transaction (store1.environment, nullptr, true);
+		for (auto & i : entries)
+		{
+			store1.pending_put (transaction, i.first, i.second);
+		}
+	}
+	auto random (std::chrono::steady_clock::now ());
+	bool init2 (false);
+	rai::block_store store2 (init2, rai::unique_path ());
+	ASSERT_FALSE (init2);
+	{
+		rai::transaction transaction (store2.environment, nullptr, true);
+		rai::bulk_loader loader (store2.pending);
+		for (auto & i : entries)
+		{
+			loader.add (i.first.val (), i.second.val ());
+		}
+		ASSERT_FALSE (loader.commit (transaction));
+	}
+	auto end (std::chrono::steady_clock::now ());
+	std::cerr << boost::str (boost::format ("Random puts: %1%ms bulk load: %2%ms\n") % std::chrono::duration_cast<std::chrono::milliseconds> (random - begin).count () % std::chrono::duration_cast<std::chrono::milliseconds> (end - random).count ());
+}
+
+TEST (store, lmdb_modes)
+{
+	size_t count (200000);
+	std::vector<rai::block_hash> hashes;
+	for (size_t i (0); i < count; ++i)
+	{
+		rai::block_hash hash;
+		rai::random_pool.GenerateBlock (hash.bytes.data (), hash.bytes.size ());
+		hashes.push_back (hash);
+	}
+	std::vector<std::pair<std::string, rai::lmdb_config>> modes;
+	modes.push_back (std::make_pair ("default", rai::lmdb_config ()));
+	rai::lmdb_config no_read_ahead;
+	no_read_ahead.no_read_ahead = true;
+	modes.push_back (std::make_pair ("no_read_ahead", no_read_ahead));
+	rai::lmdb_config no_meta_sync;
+	no_meta_sync.no_meta_sync = true;
+	modes.push_back (std::make_pair ("no_meta_sync", no_meta_sync));
+	rai::lmdb_config write_map;
+	write_map.write_map = true;
+	modes.push_back (std::make_pair ("write_map", write_map));
+	rai::lmdb_config map_async (write_map);
+	map_async.map_async = true;
+	modes.push_back (std::make_pair ("write_map+map_async", map_async));
+	rai::lmdb_config all (map_async);
+	all.no_meta_sync = true;
+	all.no_read_ahead = true;
+	modes.push_back (std::make_pair ("all", all));
+	for (auto & mode : modes)
+	{
+		bool init (false);
+		rai::block_store store (init, rai::unique_path (), 128, mode.second);
+		ASSERT_FALSE (init);
+		auto begin (std::chrono::steady_clock::now ());
+		// Commit in small batches the way the block processor does
+		for (size_t i (0); i < count; i += 256)
+		{
+			rai::transaction transaction (store.environment, nullptr, true);
+			for (size_t j (i), n (std::min (count, i + 256)); j < n; ++j)
+			{
+				store.representation_put (transaction, hashes[j], j);
+			}
+		}
+		mdb_env_sync (store.environment, 1);
+		auto written (std::chrono::steady_clock::now ());
+		{
+			rai::transaction transaction (store.environment, nullptr, false);
+			for (size_t i (0); i < count; ++i)
+			{
+				auto index (rai::random_pool.GenerateWord32 (0, count - 1));
+				ASSERT_EQ (index, store.representation_get (transaction, hashes[index]));
+			}
+		}
+		auto read (std::chrono::steady_clock::now ());
+		std::cerr << boost::str (boost::format ("%1%: writes %2%ms random reads %3%ms\n") % mode.first % std::chrono::duration_cast<std::chrono::milliseconds> (written - begin).count () % std::chrono::duration_cast<std::chrono::milliseconds> (read - written).count ());
+	}
+}
+
+TEST (rpc, keep_alive_throughput)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	rai::thread_runner runner (system.service, system.nodes[0]->config.io_threads);
+	boost::property_tree::ptree request;
+	request.put ("action", "account_balance");
+	request.put ("account", rai::test_genesis_key.pub.to_account ());
+	std::stringstream body;
+	boost::property_tree::write_json (body, request);
+	size_t count (10000);
+	auto run ([&](bool keep_alive_a) {
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::socket sock (service);
+		boost::beast::flat_buffer buffer;
+		auto begin (std::chrono::steady_clock::now ());
+		for (size_t i (0); i < count; ++i)
+		{
+			if (!sock.is_open ())
+			{
+				sock.connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port));
+			}
+			boost::beast::http::request<boost::beast::http::string_body> req;
+			req.method (boost::beast::http::verb::post);
+			req.target ("/");
+			req.version (11);
+			req.keep_alive (keep_alive_a);
+			req.body () = body.str ();
+			req.prepare_payload ();
+			boost::beast::http::write (sock, req);
+			boost::beast::http::response<boost::beast::http::string_body> resp;
+			boost::beast::http::read (sock, buffer, resp);
+			if (!keep_alive_a)
+			{
+				sock.close ();
+				buffer.consume (buffer.size ());
+			}
+		}
+		return std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - begin).count ();
+	});
+	auto close_ms (run (false));
+	auto keep_alive_ms (run (true));
+	std::cerr << boost::str (boost::format ("%1% requests, connection per request: %2%ms keep-alive: %3%ms\n") % count % close_ms % keep_alive_ms);
+	rpc.stop ();
+	system.stop ();
+	runner.join ();
+}
+
+TEST (rpc, ledger_stream)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	size_t count (1000000);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		for (size_t i (1); i <= count; ++i)
+		{
+			rai::account_info info (i, i, i, i, 0, 1);
+			node1.store.account_put (transaction, rai::account (i), info);
+		}
+	}
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	rpc.start ();
+	rai::thread_runner runner (system.service, node1.config.io_threads);
+	boost::property_tree::ptree request;
+	request.put ("action", "ledger");
+	request.put ("count", std::to_string (count));
+	std::stringstream body;
+	boost::property_tree::write_json (body, request);
+	boost::asio::io_service service;
+	boost::asio::ip::tcp::socket sock (service);
+	sock.connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port));
+	boost::beast::http::request<boost::beast::http::string_body> req;
+	req.method (boost::beast::http::verb::post);
+	req.target ("/");
+	req.version (11);
+	req.body () = body.str ();
+	req.prepare_payload ();
+	auto begin (std::chrono::steady_clock::now ());
+	boost::beast::http::write (sock, req);
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::response_parser<boost::beast::http::string_body> parser;
+	parser.body_limit (std::numeric_limits<uint64_t>::max ());
+	boost::beast::http::read (sock, buffer, parser);
+	auto end (std::chrono::steady_clock::now ());
+	ASSERT_TRUE (parser.get ().chunked ());
+	std::cerr << boost::str (boost::format ("ledger count=%1%: %2% bytes in %3%ms\n") % count % parser.get ().body ().size () % std::chrono::duration_cast<std::chrono::milliseconds> (end - begin).count ());
+	rpc.stop ();
+	system.stop ();
+	runner.join ();
+}
+
+TEST (rpc, action_microbenchmark)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::rpc rpc (system.service, node1, rai::rpc_config (true));
+	auto genesis (rai::test_genesis_key.pub.to_account ());
+	auto head (node1.latest (rai::test_genesis_key.pub).to_string ());
+	std::vector<std::pair<std::string, std::string>> requests = {
+		{ "account_balance", "{\"action\": \"account_balance\", \"account\": \"" + genesis + "\"}" },
+		{ "account_info", "{\"action\": \"account_info\", \"account\": \"" + genesis + "\"}" },
+		{ "account_block_count", "{\"action\": \"account_block_count\", \"account\": \"" + genesis + "\"}" },
+		{ "account_key", "{\"action\": \"account_key\", \"account\": \"" + genesis + "\"}" },
+		{ "accounts_balances", "{\"action\": \"accounts_balances\", \"accounts\": [\"" + genesis + "\", \"" + genesis + "\"]}" },
+		{ "block", "{\"action\": \"block\", \"hash\": \"" + head + "\"}" },
+		{ "block_account", "{\"action\": \"block_account\", \"hash\": \"" + head + "\"}" },
+		{ "block_count", "{\"action\": \"block_count\"}" },
+		{ "pending", "{\"action\": \"pending\", \"account\": \"" + genesis + "\", \"count\": \"1\"}" },
+		{ "version", "{\"action\": \"version\"}" }
+	};
+	size_t count (100000);
+	for (auto & i : requests)
+	{
+		auto begin (std::chrono::steady_clock::now ());
+		for (size_t j (0); j < count; ++j)
+		{
+			boost::property_tree::ptree tree;
+			std::stringstream istream (i.second);
+			boost::property_tree::read_json (istream, tree);
+		}
+		auto read_json_end (std::chrono::steady_clock::now ());
+		for (size_t j (0); j < count; ++j)
+		{
+			boost::property_tree::ptree tree;
+			rai::parse_json (i.second, tree);
+		}
+		auto parse_json_end (std::chrono::steady_clock::now ());
+		size_t responses (0);
+		for (size_t j (0); j < count; ++j)
+		{
+			auto handler (std::make_shared<rai::rpc_handler> (node1, rpc, i.second, [&responses](boost::property_tree::ptree const &) { ++responses; }));
+			handler->process_request ();
+		}
+		auto end (std::chrono::steady_clock::now ());
+		ASSERT_EQ (count, responses);
+		auto per_call ([count](std::chrono::steady_clock::time_point begin_a, std::chrono::steady_clock::time_point end_a) {
+			return std::chrono::duration_cast<std::chrono::nanoseconds> (end_a - begin_a).count () / count;
+		});
+		std::cerr << boost::str (boost::format ("%1%: read_json %2%ns parse_json %3%ns process_request %4%ns\n") % i.first % per_call (begin, read_json_end) % per_call (read_json_end, parse_json_end) % per_call (parse_json_end, end));
+	}
+}
+
+TEST (vote, hash_bundle_benchmark)
+{
+	rai::keypair key;
+	size_t count (rai::vote::max_hashes * 1000);
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	for (size_t i (0); i < count; ++i)
+	{
+		blocks.push_back (std::make_shared<rai::state_block> (key.pub, i, key.pub, i, i, key.prv, key.pub, 0));
+	}
+	auto bytes ([](std::shared_ptr<rai::vote> vote_a) {
+		rai::confirm_ack confirm (vote_a);
+		std::vector<uint8_t> result;
+		{
+			rai::vectorstream stream (result);
+			confirm.serialize (stream);
+		}
+		return result.size ();
+	});
+	// One vote per block, each carrying the block
+	size_t block_bytes (0);
+	auto begin (std::chrono::steady_clock::now ());
+	for (size_t i (0); i < count; ++i)
+	{
+		auto vote (std::make_shared<rai::vote> (key.pub, key.prv, i, blocks[i]));
+		ASSERT_FALSE (rai::validate_message (vote->account, vote->hash (), vote->signature));
+		block_bytes += bytes (vote);
+	}
+	auto block_end (std::chrono::steady_clock::now ());
+	// Votes by hash, each covering max_hashes blocks
+	size_t hash_bytes (0);
+	size_t signatures (0);
+	for (size_t i (0); i < count; i += rai::vote::max_hashes)
+	{
+		std::vector<rai::block_hash> hashes;
+		for (size_t j (i); j < i + rai::vote::max_hashes; ++j)
+		{
+			hashes.push_back (blocks[j]->hash ());
+		}
+		auto vote (std::make_shared<rai::vote> (key.pub, key.prv, i, hashes));
+		ASSERT_FALSE (rai::validate_message (vote->account, vote->hash (), vote->signature));
+		hash_bytes += bytes (vote);
+		++signatures;
+	}
+	auto hash_end (std::chrono::steady_clock::now ());
+	auto per_second ([](size_t count_a, std::chrono::steady_clock::time_point begin_a, std::chrono::steady_clock::time_point end_a) {
+		return count_a * 1000000 / std::max<uint64_t> (1, std::chrono::duration_cast<std::chrono::microseconds> (end_a - begin_a).count ());
+	});
+	std::cerr << boost::str (boost::format ("Vote per block: %1% blocks/s %2% bytes/block\n") % per_second (count, begin, block_end) % (block_bytes / count));
+	std::cerr << boost::str (boost::format ("Vote by hash: %1% blocks/s %2% signatures/s %3% bytes/block\n") % per_second (count, block_end, hash_end) % per_second (signatures, block_end, hash_end) % (hash_bytes / count));
+	ASSERT_LT (hash_bytes, block_bytes);
+}
+
+TEST (node, ledger_writer_wait)
+{
+	// Local blocks either take their own write transaction alongside the block processor or are queued to it
+	auto run ([](bool direct_a) {
+		rai::system system (24000, 1);
+		auto & node1 (*system.nodes[0]);
+		rai::keypair key;
+		rai::genesis genesis;
+		size_t count (2000);
+		rai::uint128_t amount (1000000);
+		auto send (std::make_shared<rai::send_block> (genesis.hash (), key.pub, rai::genesis_amount - amount, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ())));
+		auto open (std::make_shared<rai::open_block> (send->hash (), key.pub, key.pub, key.prv, key.pub, system.work.generate (key.pub)));
+		rai::process_return result;
+		ASSERT_FALSE (node1.block_processor.process_one (rai::block_processor_item (send), result));
+		ASSERT_FALSE (node1.block_processor.process_one (rai::block_processor_item (open), result));
+		ASSERT_EQ (rai::process_result::progress, result.code);
+		std::vector<std::shared_ptr<rai::block>> network_blocks;
+		auto previous (send->hash ());
+		for (size_t i (0); i < count; ++i)
+		{
+			auto block (std::make_shared<rai::send_block> (previous, key.pub, rai::genesis_amount - amount - (i + 1), rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous)));
+			network_blocks.push_back (block);
+			previous = block->hash ();
+		}
+		std::vector<std::shared_ptr<rai::block>> local_blocks;
+		previous = open->hash ();
+		for (size_t i (0); i < count; ++i)
+		{
+			auto block (std::make_shared<rai::send_block> (previous, rai::test_genesis_key.pub, amount - (i + 1), key.prv, key.pub, system.work.generate (previous)));
+			local_blocks.push_back (block);
+			previous = block->hash ();
+		}
+		uint64_t transactions_begin (node1.store.environment.write_transactions);
+		uint64_t wait_begin (node1.store.environment.write_wait);
+		auto begin (std::chrono::steady_clock::now ());
+		std::thread network ([&node1, &network_blocks]() {
+			for (auto & i : network_blocks)
+			{
+				node1.block_processor.add (rai::block_processor_item (i));
+			}
+		});
+		for (auto & i : local_blocks)
+		{
+			if (direct_a)
+			{
+				rai::transaction transaction (node1.store.environment, nullptr, true);
+				node1.block_processor.process_receive_one (transaction, i);
+			}
+			else
+			{
+				ASSERT_FALSE (node1.block_processor.process_one (rai::block_processor_item (i), result));
+			}
+		}
+		network.join ();
+		node1.block_processor.flush ();
+		auto end (std::chrono::steady_clock::now ());
+		uint64_t transactions (node1.store.environment.write_transactions - transactions_begin);
+		uint64_t wait (node1.store.environment.write_wait - wait_begin);
+		std::cerr << boost::str (boost::format ("%1%: %2% write transactions, %3% us average writer wait, %4% ms total\n") % (direct_a ? "Direct writes" : "Block processor") % transactions % (wait / std::max<uint64_t> (1, transactions)) % std::chrono::duration_cast<std::chrono::milliseconds> (end - begin).count ());
+		ASSERT_EQ (network_blocks.back ()->hash (), node1.latest (rai::test_genesis_key.pub));
+		ASSERT_EQ (local_blocks.back ()->hash (), node1.latest (key.pub));
+	});
+	run (true);
+	run (false);
+}
@@ -0,0 +1,316 @@
+#include <rai/snapshot.hpp>
+
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <thread>
+
+rai::snapshot_chunk::snapshot_chunk (uint8_t table_a) :
+table (table_a),
+count (0)
+{
+}
+
+void rai::snapshot_chunk::add (MDB_val const & key_a, MDB_val const & value_a)
+{
+	for (auto field : { &key_a, &value_a })
+	{
+		uint32_t size (field->mv_size);
+		payload.insert (payload.end (), reinterpret_cast<uint8_t const *> (&size), reinterpret_cast<uint8_t const *> (&size) + sizeof (size));
+		payload.insert (payload.end (), reinterpret_cast<uint8_t const *> (field->mv_data), reinterpret_cast<uint8_t const *> (field->mv_data) + field->mv_size);
+	}
+	++count;
+}
+
+void rai::snapshot_chunk::seal ()
+{
+	checksum = digest ();
+}
+
+rai::uint256_union rai::snapshot_chunk::digest () const
+{
+	rai::uint256_union result;
+	blake2b_state hash;
+	blake2b_init (&hash, sizeof (result.bytes));
+	blake2b_update (&hash, &table, sizeof (table));
+	blake2b_update (&hash, reinterpret_cast<uint8_t const *> (&count), sizeof (count));
+	blake2b_update (&hash, payload.data (), payload.size ());
+	blake2b_final (&hash, result.bytes.data (), sizeof (result.bytes));
+	return result;
+}
+
+bool rai::snapshot_chunk::entries (std::vector<std::pair<MDB_val, MDB_val>> & entries_a) const
+{
+	auto error (false);
+	size_t position (0);
+	auto field ([this, &position, &error](MDB_val & value_a) {
+		uint32_t size;
+		error = error || position + sizeof (size) > payload.size ();
+		if (!error)
+		{
+			std::copy (payload.begin () + position, payload.begin () + position + sizeof (size), reinterpret_cast<uint8_t *> (&size));
+			position += sizeof (size);
+			error = position + size > payload.size ();
+			if (!error)
+			{
+				value_a.mv_size = size;
+				value_a.mv_data = const_cast<uint8_t *> (payload.data () + position);
+				position += size;
+			}
+		}
+	});
+	for (uint32_t i (0); i < count && !error; ++i)
+	{
+		std::pair<MDB_val, MDB_val> entry;
+		field (entry.first);
+		field (entry.second);
+		if (!error)
+		{
+			entries_a.push_back (entry);
+		}
+	}
+	error = error || position != payload.size ();
+	return error;
+}
+
+bool rai::snapshot_chunk::verify (rai::block_type type_a) const
+{
+	std::vector<std::pair<MDB_val, MDB_val>> entries_l;
+	auto error (digest () != checksum || entries (entries_l));
+	if (!error && type_a != rai::block_type::invalid)
+	{
+		// Block tables store the serialized block followed by its successor
+		for (auto i (entries_l.begin ()), n (entries_l.end ()); i != n && !error; ++i)
+		{
+			rai::block_hash successor;
+			error = i->first.mv_size != sizeof (rai::block_hash) || i->second.mv_size < sizeof (successor);
+			if (!error)
+			{
+				rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.mv_data), i->second.mv_size - sizeof (successor));
+				auto block (rai::deserialize_block (stream, type_a));
+				error = block == nullptr || block->hash () != rai::mdb_val (i->first).uint256 ();
+			}
+		}
+	}
+	return error;
+}
+
+void rai::snapshot_chunk::serialize (std::ostream & stream_a) const
+{
+	uint32_t size (payload.size ());
+	stream_a.write (reinterpret_cast<char const *> (&table), sizeof (table));
+	stream_a.write (reinterpret_cast<char const *> (&count), sizeof (count));
+	stream_a.write (reinterpret_cast<char const *> (&size), sizeof (size));
+	stream_a.write (reinterpret_cast<char const *> (payload.data ()), payload.size ());
+	stream_a.write (reinterpret_cast<char const *> (checksum.bytes.data ()), checksum.bytes.size ());
+}
+
+bool rai::snapshot_chunk::deserialize (std::istream & stream_a)
+{
+	uint32_t size (0);
+	stream_a.read (reinterpret_cast<char *> (&count), sizeof (count));
+	stream_a.read (reinterpret_cast<char *> (&size), sizeof (size));
+	auto result (stream_a.fail () || size > payload_max);
+	if (!result)
+	{
+		payload.resize (size);
+		stream_a.read (reinterpret_cast<char *> (payload.data ()), payload.size ());
+		stream_a.read (reinterpret_cast<char *> (checksum.bytes.data ()), checksum.bytes.size ());
+		result = stream_a.fail ();
+	}
+	return result;
+}
+
+constexpr uint32_t rai::snapshot_chunk::payload_max;
+
+std::array<uint8_t, 8> const rai::ledger_snapshot::magic = { { 'R', 'A', 'I', 'S', 'N', 'A', 'P', 0 } };
+constexpr uint32_t rai::ledger_snapshot::version;
+constexpr uint32_t rai::ledger_snapshot::chunk_entries;
+constexpr size_t rai::ledger_snapshot::batch_chunks;
+
+rai::ledger_snapshot::ledger_snapshot (rai::block_store & store_a) :
+store (store_a),
+entries (0)
+{
+}
+
+std::vector<std::pair<MDB_dbi, rai::block_type>> rai::ledger_snapshot::tables ()
+{
+	return {
+		{ store.frontiers, rai::block_type::invalid },
+		{ store.accounts, rai::block_type::invalid },
+		{ store.send_blocks, rai::block_type::send },
+		{ store.receive_blocks, rai::block_type::receive },
+		{ store.open_blocks, rai::block_type::open },
+		{ store.change_blocks, rai::block_type::change },
+		{ store.state_blocks, rai::block_type::state },
+		{ store.pending, rai::block_type::invalid },
+		{ store.blocks_info, rai::block_type::invalid },
+		{ store.representation, rai::block_type::invalid },
+		{ store.checksum, rai::block_type::invalid }
+	};
+}
+
+bool rai::ledger_snapshot::serialize (MDB_txn * transaction_a, std::ostream & stream_a)
+{
+	uint32_t store_version (store.version_get (transaction_a));
+	rai::genesis genesis;
+	stream_a.write (reinterpret_cast<char const *> (magic.data ()), magic.size ());
+	stream_a.write (reinterpret_cast<char const *> (&version), sizeof (version));
+	stream_a.write (reinterpret_cast<char const *> (&store_version), sizeof (store_version));
+	stream_a.write (reinterpret_cast<char const *> (genesis.hash ().bytes.data ()), sizeof (rai::block_hash));
+	auto tables_l (tables ());
+	for (size_t i (0), n (tables_l.size ()); i < n && !stream_a.fail (); ++i)
+	{
+		rai::snapshot_chunk chunk (i + 1);
+		for (rai::store_iterator j (transaction_a, tables_l[i].first), m (nullptr); j != m && !stream_a.fail (); ++j)
+		{
+			chunk.add (j->first, j->second);
+			if (chunk.count == chunk_entries)
+			{
+				chunk.seal ();
+				chunk.serialize (stream_a);
+				entries += chunk.count;
+				chunk = rai::snapshot_chunk (i + 1);
+			}
+		}
+		if (chunk.count > 0)
+		{
+			chunk.seal ();
+			chunk.serialize (stream_a);
+			entries += chunk.count;
+		}
+	}
+	uint8_t end (0);
+	stream_a.write (reinterpret_cast<char const *> (&end), sizeof (end));
+	stream_a.flush ();
+	return stream_a.fail ();
+}
+
+bool rai::ledger_snapshot::deserialize (std::istream & stream_a)
+{
+	std::array<uint8_t, 8> magic_l;
+	uint32_t version_l (0);
+	uint32_t store_version (0);
+	rai::block_hash genesis_hash;
+	stream_a.read (reinterpret_cast<char *> (magic_l.data ()), magic_l.size ());
+	stream_a.read (reinterpret_cast<char *> (&version_l), sizeof (version_l));
+	stream_a.read (reinterpret_cast<char *> (&store_version), sizeof (store_version));
+	stream_a.read (reinterpret_cast<char *> (genesis_hash.bytes.data ()), genesis_hash.bytes.size ());
+	auto result (stream_a.fail () || magic_l != magic || version_l != version || genesis_hash != rai::genesis ().hash ());
+	auto tables_l (tables ());
+	if (!result)
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		result = static_cast<int> (store_version) != store.version_get (transaction);
+		if (!result)
+		{
+			for (auto & i : tables_l)
+			{
+				auto status (mdb_drop (transaction, i.first, 0));
+				assert (status == 0);
+			}
+		}
+	}
+	auto done (false);
+	while (!result && !done)
+	{
+		std::vector<rai::snapshot_chunk> batch;
+		while (!result && !done && batch.size () < batch_chunks)
+		{
+			uint8_t table (0);
+			stream_a.read (reinterpret_cast<char *> (&table), sizeof (table));
+			result = stream_a.fail () || table > tables_l.size ();
+			if (!result)
+			{
+				if (table != 0)
+				{
+					batch.push_back (rai::snapshot_chunk (table));
+					result = batch.back ().deserialize (stream_a);
+				}
+				else
+				{
+					done = true;
+				}
+			}
+		}
+		if (!result && !batch.empty ())
+		{
+			std::atomic<bool> invalid (false);
+			std::vector<std::thread> threads;
+			auto thread_count (std::min<size_t> (std::max<unsigned> (std::thread::hardware_concurrency (), 1), batch.size ()));
+			for (size_t i (0); i < thread_count; ++i)
+			{
+				threads.push_back (std::thread ([&batch, &tables_l, &invalid, i, thread_count]() {
+					for (auto j (i); j < batch.size () && !invalid; j += thread_count)
+					{
+						if (batch[j].verify (tables_l[batch[j].table - 1].second))
+						{
+							invalid = true;
+						}
+					}
+				}));
+			}
+			for (auto & i : threads)
+			{
+				i.join ();
+			}
+			result = invalid;
+			if (!result)
+			{
+				// Tables arrive in key order so every put is an append
+				rai::transaction transaction (store.environment, nullptr, true);
+				for (auto i (batch.begin ()), n (batch.end ()); i != n && !result; ++i)
+				{
+					std::vector<std::pair<MDB_val, MDB_val>> entries_l;
+					i->entries (entries_l);
+					auto database (tables_l[i->table - 1].first);
+					for (auto j (entries_l.begin ()), m (entries_l.end ()); j != m && !result; ++j)
+					{
+						result = mdb_put (transaction, database, &j->first, &j->second, MDB_APPEND) != 0;
+					}
+					entries += entries_l.size ();
+				}
+			}
+		}
+	}
+	if (!result)
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		rebuild (transaction);
+	}
+	return result;
+}
+
+bool rai::ledger_snapshot::replace (MDB_txn * transaction_a, rai::block_store & source_a, MDB_txn * source_transaction_a)
+{
+	auto result (store.version_get (transaction_a) != source_a.version_get (source_transaction_a));
+	if (!result)
+	{
+		auto tables_l (tables ());
+		auto source_tables (rai::ledger_snapshot (source_a).tables ());
+		for (size_t i (0), n (tables_l.size ()); i < n; ++i)
+		{
+			auto status (mdb_drop (transaction_a, tables_l[i].first, 0));
+			assert (status == 0);
+			for (rai::store_iterator j (source_transaction_a, source_tables[i].first), m (nullptr); j != m; ++j)
+			{
+				auto status (mdb_put (transaction_a, tables_l[i].first, j->first, j->second, MDB_APPEND));
+				assert (status == 0);
+				++entries;
+			}
+		}
+		rebuild (transaction_a);
+	}
+	return result;
+}
+
+void rai::ledger_snapshot::rebuild (MDB_txn * transaction_a)
+{
+	store.delegators_rebuild (transaction_a);
+	store.pending_summary_rebuild (transaction_a);
+	if (store.sorted_indexes)
+	{
+		store.sorted_indexes_rebuild (transaction_a);
+	}
+}
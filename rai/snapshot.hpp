@@ -0,0 +1,63 @@
+#pragma once
+
+#include <rai/blockstore.hpp>
+
+#include <iosfwd>
+
+namespace rai
+{
+/**
+ * A run of key/value entries from one ledger table along with a checksum of its payload
+ */
+class snapshot_chunk
+{
+public:
+	snapshot_chunk (uint8_t);
+	void add (MDB_val const &, MDB_val const &);
+	void seal ();
+	// Returns true if the payload is malformed
+	bool entries (std::vector<std::pair<MDB_val, MDB_val>> &) const;
+	// Returns true if the checksum doesn't match or a block entry doesn't hash to its key
+	bool verify (rai::block_type) const;
+	void serialize (std::ostream &) const;
+	// Reads the chunk following the table identifier, returns true on error
+	bool deserialize (std::istream &);
+	rai::uint256_union digest () const;
+	uint8_t table;
+	uint32_t count;
+	std::vector<uint8_t> payload;
+	rai::uint256_union checksum;
+	// Larger payloads are rejected before anything is allocated, a full chunk of the largest entries is well under this
+	static uint32_t constexpr payload_max = 4 * 1024 * 1024;
+};
+
+/**
+ * Streams the ledger tables of a block store to and from a versioned snapshot
+ * Each table is written in key order so importing only appends to an empty store
+ */
+class ledger_snapshot
+{
+public:
+	ledger_snapshot (rai::block_store &);
+	// Returns true on error
+	bool serialize (MDB_txn *, std::ostream &);
+	// Returns true on error, the ledger tables of the store are replaced
+	bool deserialize (std::istream &);
+	// Replaces the ledger tables of the store with those of an imported store in a single transaction, other tables such as wallets are kept
+	// Returns true if the stores have different versions
+	bool replace (MDB_txn *, rai::block_store &, MDB_txn *);
+	// Tables in snapshot order, an entry's identifier is its position plus one
+	std::vector<std::pair<MDB_dbi, rai::block_type>> tables ();
+	rai::block_store & store;
+	uint64_t entries;
+	static std::array<uint8_t, 8> const magic;
+	static uint32_t constexpr version = 1;
+	static uint32_t constexpr chunk_entries = 4096;
+	// Chunks read ahead and verified in parallel before being written
+	static size_t constexpr batch_chunks = 64;
+
+private:
+	// Secondary indexes aren't part of the snapshot, they're derived from the imported tables
+	void rebuild (MDB_txn *);
+};
+}
@@ -0,0 +1,236 @@
+#include <rai/votestore.hpp>
+
+#include <fstream>
+#include <iterator>
+
+uint64_t constexpr rai::vote_store::sequence_margin;
+uint64_t constexpr rai::vote_store::compact_ratio;
+
+rai::vote_store::vote_store (bool & error_a, boost::filesystem::path const & path_a) :
+path (path_a),
+entries (0)
+{
+	if (!error_a)
+	{
+		error_a = load ();
+	}
+}
+
+bool rai::vote_store::load ()
+{
+	auto result (false);
+	if (boost::filesystem::exists (path))
+	{
+		std::ifstream stream (path.string (), std::ios::binary);
+		result = !stream.is_open ();
+		if (!result)
+		{
+			std::vector<uint8_t> log ((std::istreambuf_iterator<char> (stream)), std::istreambuf_iterator<char> ());
+			rai::bufferstream records (log.data (), log.size ());
+			auto torn (false);
+			uint32_t size;
+			while (!torn && !rai::read (records, size))
+			{
+				torn = static_cast<std::streamsize> (size) > records.in_avail ();
+				if (!torn)
+				{
+					std::vector<uint8_t> record (size);
+					records.sgetn (record.data (), size);
+					auto error (false);
+					rai::bufferstream vote_stream (record.data (), record.size ());
+					auto vote (std::make_shared<rai::vote> (error, vote_stream));
+					torn = error;
+					if (!error)
+					{
+						import (vote);
+						++entries;
+					}
+				}
+			}
+			// A record cut short by a crash ends the log, it's rewritten so later appends follow a complete record
+			torn = torn || records.in_avail () > 0;
+			dirty.clear ();
+			if (torn)
+			{
+				result = write (list (), true);
+			}
+		}
+	}
+	return result;
+}
+
+std::shared_ptr<rai::vote> rai::vote_store::current (rai::account const & account_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	std::shared_ptr<rai::vote> result;
+	auto existing (votes.find (account_a));
+	if (existing != votes.end ())
+	{
+		result = existing->second;
+	}
+	return result;
+}
+
+uint64_t rai::vote_store::sequence_next (rai::account const & account_a)
+{
+	assert (!mutex.try_lock ());
+	uint64_t result (1);
+	auto existing (votes.find (account_a));
+	if (existing != votes.end ())
+	{
+		result = existing->second->sequence + 1;
+		if (recovered.erase (account_a) > 0)
+		{
+			result += sequence_margin;
+		}
+	}
+	return result;
+}
+
+std::shared_ptr<rai::vote> rai::vote_store::generate (rai::account const & account_a, rai::raw_key const & key_a, std::shared_ptr<rai::block> block_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (std::make_shared<rai::vote> (account_a, key_a, sequence_next (account_a), block_a));
+	votes[account_a] = result;
+	dirty.insert (account_a);
+	return result;
+}
+
+std::shared_ptr<rai::vote> rai::vote_store::generate (rai::account const & account_a, rai::raw_key const & key_a, std::vector<rai::block_hash> const & hashes_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (std::make_shared<rai::vote> (account_a, key_a, sequence_next (account_a), hashes_a));
+	votes[account_a] = result;
+	dirty.insert (account_a);
+	return result;
+}
+
+std::shared_ptr<rai::vote> rai::vote_store::max (std::shared_ptr<rai::vote> vote_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto result (vote_a);
+	auto & existing (votes[vote_a->account]);
+	if (existing != nullptr && existing->sequence > result->sequence)
+	{
+		result = existing;
+	}
+	else if (existing != vote_a)
+	{
+		existing = vote_a;
+		dirty.insert (vote_a->account);
+	}
+	return result;
+}
+
+void rai::vote_store::import (std::shared_ptr<rai::vote> vote_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto & existing (votes[vote_a->account]);
+	if (existing == nullptr || existing->sequence < vote_a->sequence)
+	{
+		existing = vote_a;
+		dirty.insert (vote_a->account);
+	}
+	recovered.insert (vote_a->account);
+}
+
+std::vector<std::shared_ptr<rai::vote>> rai::vote_store::list ()
+{
+	std::vector<std::shared_ptr<rai::vote>> result;
+	std::lock_guard<std::mutex> lock (mutex);
+	result.reserve (votes.size ());
+	for (auto & i : votes)
+	{
+		result.push_back (i.second);
+	}
+	return result;
+}
+
+bool rai::vote_store::flush ()
+{
+	std::lock_guard<std::mutex> flush_lock (flush_mutex);
+	std::vector<std::shared_ptr<rai::vote>> changed;
+	auto compact (false);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		compact = entries + dirty.size () > compact_ratio * votes.size ();
+		if (compact)
+		{
+			for (auto & i : votes)
+			{
+				changed.push_back (i.second);
+			}
+		}
+		else
+		{
+			for (auto & i : dirty)
+			{
+				changed.push_back (votes[i]);
+			}
+		}
+		dirty.clear ();
+	}
+	auto result (false);
+	if (compact || !changed.empty ())
+	{
+		result = write (changed, compact);
+		if (result)
+		{
+			// Kept for the next attempt unless they were superseded in the meantime
+			std::lock_guard<std::mutex> lock (mutex);
+			for (auto & i : changed)
+			{
+				dirty.insert (i->account);
+			}
+		}
+	}
+	return result;
+}
+
+bool rai::vote_store::write (std::vector<std::shared_ptr<rai::vote>> const & votes_a, bool rewrite_a)
+{
+	// The whole batch is built in one buffer and written with a single call
+	std::vector<uint8_t> buffer;
+	{
+		rai::vectorstream stream (buffer);
+		std::vector<uint8_t> record;
+		for (auto & i : votes_a)
+		{
+			record.clear ();
+			{
+				rai::vectorstream record_stream (record);
+				i->serialize (record_stream);
+			}
+			rai::write (stream, static_cast<uint32_t> (record.size ()));
+			stream.sputn (record.data (), record.size ());
+		}
+	}
+	auto target (rewrite_a ? boost::filesystem::path (path.string () + ".tmp") : path);
+	std::ofstream stream (target.string (), std::ios::binary | (rewrite_a ? std::ios::trunc : std::ios::app));
+	auto result (!stream.is_open ());
+	if (!result)
+	{
+		stream.write (reinterpret_cast<char const *> (buffer.data ()), buffer.size ());
+		stream.close ();
+		// Sequences restart from whatever survives a power loss, records have to reach the disk before the log is replaced or considered written
+		result = stream.fail () || rai::sync_path (target);
+		if (!result)
+		{
+			if (rewrite_a)
+			{
+				boost::system::error_code error;
+				boost::filesystem::rename (target, path, error);
+				result = !!error || rai::sync_path (path.has_parent_path () ? path.parent_path () : boost::filesystem::path ("."));
+				if (!result)
+				{
+					entries = votes_a.size ();
+				}
+			}
+			else
+			{
+				entries += votes_a.size ();
+			}
+		}
+	}
+	return result;
+}
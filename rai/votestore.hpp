@@ -0,0 +1,53 @@
+#pragma once
+
+#include <rai/common.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace rai
+{
+/**
+ * Highest vote seen for each account, held in memory and persisted independently of ledger transactions
+ * Changed votes are appended to a log in batches, replaying the log on startup keeps the highest sequence per account
+ * Appends are synced and compaction syncs the rewritten log and its directory around the rename, so a power loss can't lose sequences already flushed
+ */
+class vote_store
+{
+public:
+	vote_store (bool &, boost::filesystem::path const &);
+	// Latest vote for the account, null if there isn't one
+	std::shared_ptr<rai::vote> current (rai::account const &);
+	// Sign a vote with the next sequence number for the account
+	std::shared_ptr<rai::vote> generate (rai::account const &, rai::raw_key const &, std::shared_ptr<rai::block>);
+	std::shared_ptr<rai::vote> generate (rai::account const &, rai::raw_key const &, std::vector<rai::block_hash> const &);
+	// Return either vote or the held vote with a higher sequence number
+	std::shared_ptr<rai::vote> max (std::shared_ptr<rai::vote>);
+	// Takes a vote persisted elsewhere, its sequence may be behind what was actually signed
+	void import (std::shared_ptr<rai::vote>);
+	// Appends votes changed since the last flush to the log and syncs it to disk, returns true on error
+	bool flush ();
+	std::vector<std::shared_ptr<rai::vote>> list ();
+	boost::filesystem::path path;
+	std::mutex mutex;
+	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> votes;
+	std::unordered_set<rai::account> dirty;
+	// Accounts whose latest vote came back from disk, the next vote signed for them skips sequence_margin
+	std::unordered_set<rai::account> recovered;
+	// Records in the log, once they outnumber the held votes compact_ratio times the log is rewritten
+	uint64_t entries;
+	// Votes signed after the last flush before a crash are never persisted, recovered sequences are bumped past them
+	static uint64_t constexpr sequence_margin = 100000;
+	static uint64_t constexpr compact_ratio = 4;
+
+private:
+	uint64_t sequence_next (rai::account const &);
+	bool load ();
+	bool write (std::vector<std::shared_ptr<rai::vote>> const &, bool);
+	// Serializes flushes so file access happens without holding mutex
+	std::mutex flush_mutex;
+};
+}